@@ -1,5 +1,6 @@
 #include "audioanalyzer.hpp"
 #include "misc/log.hpp"
+#include "misc/simd.hpp"
 #include "tmp/algorithm.hpp"
 
 // calculate dynamic audio normalization
@@ -8,6 +9,53 @@
 
 DECLARE_LOG_CONTEXT(Audio)
 
+struct AudioLevel {
+    float peak = 0.f;
+    double sum = 0.0, sum2 = 0.0; // of absolute values and squares
+};
+
+// peak, sum and sum of squares in one pass
+// partial sums are kept in float vectors only for a block to save precision
+template<class F>
+static auto measure(const float *p, int samples, AudioLevel *level) -> void
+{
+    constexpr int Block = 1024;
+    const int vectors = samples - samples % F::N;
+    auto peak = F::zero();
+    for (int i = 0; i < vectors; i += Block) {
+        const int end = qMin(vectors, i + Block);
+        auto sum = F::zero(), sum2 = F::zero();
+        for (int j = i; j < end; j += F::N) {
+            const auto v = F::load(p + j), a = F::abs(v);
+            peak = F::max(peak, a);
+            sum = F::add(sum, a);
+            sum2 = F::madd(v, v, sum2);
+        }
+        level->sum += F::sum(sum);
+        level->sum2 += F::sum(sum2);
+    }
+    float lanes[F::N];
+    F::store(lanes, peak);
+    for (float v : lanes)
+        level->peak = std::max(level->peak, v);
+    for (int i = vectors; i < samples; ++i) {
+        const float a = std::fabs(p[i]);
+        level->peak = std::max(level->peak, a);
+        level->sum += a;
+        level->sum2 += a * a;
+    }
+}
+
+#ifdef SIMD_HAS_AVX2
+SIMD_AVX2_ENTRY static auto measureAvx2(const float *p, int samples,
+                                        AudioLevel *level) -> void
+{
+    measure<Simd::Float8>(p, samples, level);
+}
+#endif
+
+using Measure = auto (*)(const float *p, int samples, AudioLevel *level) -> void;
+
 class AudioFrameChunk {
 public:
     AudioFrameChunk() { }
@@ -34,30 +82,15 @@ public:
     auto frames() const -> int { return m_frames; }
     auto targetFrames() const -> int { return m_targetFrames; }
     auto isFull() const -> bool { return m_frames >= m_targetFrames; }
-    auto max(bool *silence) const -> double
-    {
-        double max = 0.0, avg = 0.0;
-        for (auto &buffer : d) {
-            auto view = buffer->constView<float>();
-            for (float v : view) {
-                const auto a = qAbs(v);
-                max = std::max<double>(a, max);
-                avg += a;
-            }
-        }
-        avg /= m_frames * m_format.channels().num;
-        *silence = avg < 1e-4;
-        return max;
-    }
-    auto rms() const -> double
+    auto level(Measure measure, double *max, double *rms) const -> bool
     {
-        double sum2 = 0.0;
-        for (auto &buffer : d) {
-            auto view = buffer->constView<float>();
-            for (float v : view)
-                sum2 += v * v;
-        }
-        return sqrt(sum2 / (m_frames * m_format.channels().num));
+        AudioLevel level;
+        for (auto &buffer : d)
+            measure(buffer->constView<float>().plane(), buffer->samples(), &level);
+        const int samples = m_frames * m_format.channels().num;
+        *max = level.peak;
+        *rms = sqrt(level.sum2 / samples);
+        return level.sum / samples < 1e-4; // silence
     }
 private:
     AudioBufferFormat m_format;
@@ -66,6 +99,52 @@ private:
     int m_frames = 0, m_targetFrames = 0;
 };
 
+// minimum of last size values by monotonic deque in amortized O(1)
+class SlidingMin {
+public:
+    auto setSize(int size) -> void { m_size = size; clear(); }
+    auto clear() -> void { m_queue.clear(); m_count = 0; }
+    auto push(double value) -> void
+    {
+        while (!m_queue.empty() && m_queue.back().value >= value)
+            m_queue.pop_back();
+        m_queue.push_back({m_count++, value});
+        if (m_queue.front().index <= m_count - 1 - m_size)
+            m_queue.pop_front();
+    }
+    auto count() const -> qint64 { return m_count; }
+    auto isFull() const -> bool { return m_count >= m_size; }
+    auto min() const -> double { return m_queue.front().value; }
+private:
+    struct Item { qint64 index; double value; };
+    std::deque<Item> m_queue;
+    qint64 m_count = 0;
+    int m_size = 1;
+};
+
+// last size values in a ring which is stored twice
+// so that the window is always contiguous for convolution
+class RingWindow {
+public:
+    auto setSize(int size) -> void { m_size = size; clear(); }
+    auto clear() -> void { m_data.assign(m_size * 2, 0.0); m_pos = 0; m_count = 0; }
+    auto push(double value) -> void
+    {
+        m_data[m_pos] = m_data[m_pos + m_size] = value;
+        if (++m_pos >= m_size)
+            m_pos = 0;
+        ++m_count;
+    }
+    auto count() const -> qint64 { return m_count; }
+    auto isFull() const -> bool { return m_count >= m_size; }
+    auto begin() const -> const double* { return m_data.data() + m_pos; }
+    auto end() const -> const double* { return begin() + m_size; }
+private:
+    std::vector<double> m_data;
+    int m_size = 1, m_pos = 0;
+    qint64 m_count = 0;
+};
+
 struct AudioAnalyzer::Data {
     AudioAnalyzer *p = nullptr;
     AudioBufferFormat format;
@@ -74,29 +153,35 @@ struct AudioAnalyzer::Data {
     double scale = 1.0;
     bool normalizer = false;
     struct {
-        std::deque<double> orig, min, smooth;
+        SlidingMin orig;
+        RingWindow min;
+        std::deque<double> smooth;
         double prev = 1.0, current = 1.0;
         auto clear() { prev = current = 1.0; orig.clear(); min.clear(); smooth.clear(); }
     } history;
     std::deque<AudioFrameChunk> inputs, outputs;
     AudioFrameChunk filling;
     Gaussian gaussian;
+    Measure measure = nullptr;
 
     auto chunk() const -> AudioFrameChunk { return { format, p, frames }; }
 
     auto update(float gain) -> void
     {
-        if((int)history.orig.size() < gaussian.radius()) {
+        // both windows are filled up to radius with the first gain
+        if (!history.orig.count()) {
             history.current = history.prev = gain;
-            history.orig.insert(history.orig.end(), gaussian.radius(), history.prev);
-            history.min.insert(history.min.end(), gaussian.radius(), history.prev);
+            for (int i = 0; i < gaussian.radius(); ++i) {
+                history.orig.push(history.prev);
+                history.min.push(history.prev);
+            }
         }
-        history.orig.push_back(gain);
-#define PUSH_POP(from, to, filter) while((int)from.size() >= gaussian.size()) \
-            { to.push_back(filter(from)); from.pop_front(); }
-        PUSH_POP(history.orig, history.min, tmp::min);
-        PUSH_POP(history.min, history.smooth, gaussian.apply);
-#undef PUSH_POP
+        history.orig.push(gain);
+        if (!history.orig.isFull())
+            return;
+        history.min.push(history.orig.min());
+        if (history.min.isFull())
+            history.smooth.push_back(gaussian.apply(history.min.begin(), history.min.end()));
     }
 };
 
@@ -104,6 +189,17 @@ AudioAnalyzer::AudioAnalyzer()
     : d(new Data)
 {
     d->p = this;
+#ifdef SIMD_HAS_SSE2
+    d->measure = measure<Simd::Float4>;
+#else
+    d->measure = measure<Simd::Float1>;
+#endif
+#ifdef SIMD_HAS_AVX2
+    if (Simd::isa() == Simd::Avx2)
+        d->measure = measureAvx2;
+#endif
+    d->history.orig.setSize(d->gaussian.size());
+    d->history.min.setSize(d->gaussian.size());
 }
 
 AudioAnalyzer::~AudioAnalyzer()
@@ -169,6 +265,8 @@ auto AudioAnalyzer::setNormalizerOption(const AudioNormalizerOption &opt) -> voi
     d->option.target    = std::min(0.95, opt.target);
 
     d->gaussian.setRadius(d->option.smoothing);
+    d->history.orig.setSize(d->gaussian.size());
+    d->history.min.setSize(d->gaussian.size());
     d->history.clear();
     reset();
 }
@@ -203,14 +301,13 @@ auto AudioAnalyzer::pull(bool eof) -> AudioBufferPtr
         return flush();
     while (!d->inputs.empty()) {
         auto chunk = tmp::take_front(d->inputs);
-        double gain = d->history.prev;
-        bool silence = false;
-        const auto max = chunk.max(&silence);
+        double gain = d->history.prev, max = 0.0, rms = 0.0;
+        const bool silence = chunk.level(d->measure, &max, &rms);
         if (!silence) {
             if (d->option.use_rms) {
                 const double peak = 0.95 / max;
-                const double rms = d->option.target / chunk.rms();
-                gain = std::min(peak, rms);
+                const double rms_gain = d->option.target / rms;
+                gain = std::min(peak, rms_gain);
             } else
                 gain = d->option.target / max;
         }
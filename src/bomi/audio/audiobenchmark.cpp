@@ -0,0 +1,343 @@
+#include "audioconverter.hpp"
+#include "audioscaler.hpp"
+#include "audiocorrelation.hpp"
+#include "audiocontroller.hpp"
+#include "audioequalizer.hpp"
+#include "audionormalizeroption.hpp"
+#include "misc/benchmark.hpp"
+#include "tmp/type_traits.hpp"
+extern "C" {
+#include <audio/format.h>
+#include <audio/audio.h>
+#include <audio/chmap.h>
+#include <audio/filter/af.h>
+}
+
+// per-sample conversion which AudioConverter used before
+namespace Reference {
+
+static auto softclip(float p) -> float
+{
+    return (p >= M_PI*0.5) ? 1.0 : ((p <= -M_PI*0.5) ? -1.0 : std::sin(p));
+}
+
+static auto hardclip(float p) -> float
+{
+    return qBound(-1.0f, p, 1.0f);
+}
+
+template<class T>
+static auto convert(uchar *dst, float src) -> void
+{
+    auto value = (T*)dst;
+    if (tmp::is_floating_point<T>())
+        *value = src;
+    else
+        *value = src * _Max<T>() + 0.5;
+}
+
+static auto run(AudioBuffer *dest, const AudioBuffer *in, bool soft) -> void
+{
+    auto clip = soft ? softclip : hardclip;
+    auto conv = [&] () -> auto (*)(uchar*, float) -> void {
+        switch (dest->type()) {
+        case AF_FORMAT_S16: case AF_FORMAT_S16P:
+            return convert<qint16>;
+        case AF_FORMAT_S32: case AF_FORMAT_S32P:
+            return convert<qint32>;
+        case AF_FORMAT_DOUBLE: case AF_FORMAT_DOUBLEP:
+            return convert<double>;
+        default:
+            return convert<float>;
+        }
+    }();
+    auto sview = in->constView<float>();
+    if (dest->isPlanar()) {
+        for (int ch = 0; ch < dest->channels(); ++ch) {
+            const float *src = sview.plane() + ch;
+            uchar *dst = dest->data()[ch];
+            for (int i = 0; i < in->frames(); ++i) {
+                conv(dst, clip(*src));
+                src += dest->channels();
+                dst += dest->bps();
+            }
+        }
+    } else {
+        uchar *dst = dest->data()[0];
+        for (auto it = sview.begin(); it != sview.end(); ++it) {
+            conv(dst, clip(*it));
+            dst += dest->bps();
+        }
+    }
+}
+
+}
+
+auto benchmarkAudioConverter() -> void
+{
+    const Benchmark bm(u"audio-converter"_q);
+    constexpr int fps = 48000, frames = 4800;
+    mp_chmap chmap;
+    mp_chmap_from_channels(&chmap, 8);
+    AudioBufferArena arena;
+    const AudioBufferFormat fmt_in(AF_FORMAT_FLOAT, chmap, fps);
+    auto in = arena.get(fmt_in, frames);
+    auto view = in->view<float>();
+    for (int i = 0; i < in->samples(); ++i)
+        view.plane()[i] = 1.2f * std::sin(i * 0.01f + (i % 8));
+    const auto source = std::vector<float>(view.begin(), view.end());
+
+    const struct { af_format type; const char *name; } formats[] = {
+        { AF_FORMAT_S16, "s16" },       { AF_FORMAT_S16P, "s16p" },
+        { AF_FORMAT_S32, "s32" },       { AF_FORMAT_S32P, "s32p" },
+        { AF_FORMAT_FLOAT, "float" },   { AF_FORMAT_FLOATP, "floatp" },
+        { AF_FORMAT_DOUBLE, "double" }, { AF_FORMAT_DOUBLEP, "doublep" }
+    };
+    for (auto soft : { false, true }) {
+        for (auto &f : formats) {
+            const AudioBufferFormat fmt_out(f.type, chmap, fps);
+            auto dest = arena.get(fmt_out, frames);
+            const auto old = Benchmark::measure([&] () {
+                Reference::run(dest.data(), in.data(), soft);
+            });
+            AudioConverter converter;
+            converter.setArena(&arena);
+            converter.setFormat(fmt_out);
+            converter.setSoftClip(soft);
+            // float output is clipped in place but it takes the same time
+            const auto now = Benchmark::measure([&] () { converter.run(in); });
+            std::copy(source.begin(), source.end(), view.begin());
+            const QString name = _L(f.name) % (soft ? "/soft"_a : "/hard"_a);
+            bm.report(name % " old"_a, old, in->samples(), u"sample"_q);
+            bm.report(name % " new"_a, now, in->samples(), u"sample"_q);
+            if (f.type == AF_FORMAT_S16 && !soft) {
+                converter.setDithering(true);
+                const auto dither = Benchmark::measure([&] () { converter.run(in); });
+                bm.report(name % " new+dither"_a, dither, in->samples(), u"sample"_q);
+            }
+        }
+    }
+}
+
+auto benchmarkAudioScaler() -> void
+{
+    const Benchmark bm(u"audio-scaler"_q);
+    constexpr int fps = 48000, frames = 4800;
+    AudioBufferArena arena;
+    for (int nch : { 2, 8 }) {
+        mp_chmap chmap;
+        mp_chmap_from_channels(&chmap, nch);
+        const AudioBufferFormat format(AF_FORMAT_FLOAT, chmap, fps);
+        auto in = arena.get(format, frames);
+        auto view = in->view<float>();
+        for (int i = 0; i < in->samples(); ++i)
+            view.plane()[i] = 0.5f * std::sin(i * 0.003f) + 0.3f * std::sin(i * 0.071f + (i % nch));
+        const QString chs = QString::number(nch) % "ch"_a;
+
+        // search of one stride at 48kHz
+        const int stride = fps * 60 / 1000, overlap = stride / 5, search = fps * 14 / 1000;
+        const int samples = (overlap - 1) * nch;
+        for (auto method : { AudioCorrelation::Direct, AudioCorrelation::Fft }) {
+            for (auto coarse : { false, true }) {
+                AudioCorrelation corr;
+                corr.setMethod(method);
+                corr.setCoarse(coarse);
+                corr.setup(samples, search, nch);
+                const auto nsec = Benchmark::measure([&] () {
+                    corr.search(view.plane(), view.plane() + nch);
+                });
+                const QString name = chs % (method == AudioCorrelation::Fft ? " fft"_a : " direct"_a)
+                                     % (coarse ? "+coarse"_a : ""_a);
+                bm.report(name, nsec, search, u"offset"_q);
+            }
+        }
+
+        for (auto scale : { 0.5, 1.5, 2.0, 3.0, 4.0 }) {
+            for (auto coarse : { false, true }) {
+                AudioScaler scaler;
+                scaler.setArena(&arena);
+                scaler.setFormat(format);
+                scaler.setCoarseSearch(coarse);
+                scaler.setScale(scale);
+                scaler.setActive(true);
+                const auto nsec = Benchmark::measure([&] () { scaler.run(in); });
+                const QString name = chs % " x"_a % QString::number(scale, 'f', 1)
+                                     % (coarse ? " coarse"_a : ""_a);
+                bm.reportRealtime(name, nsec, frames / double(fps));
+            }
+        }
+    }
+}
+
+// tones per channel with a little noise
+static auto makeSource(mp_audio_pool *pool, int type, int nch, int fps,
+                       int frames) -> mp_audio*
+{
+    mp_audio config;
+    memset(&config, 0, sizeof(config));
+    mp_audio_set_format(&config, type);
+    mp_chmap chmap;
+    mp_chmap_from_channels(&chmap, nch);
+    mp_audio_set_channels(&config, &chmap);
+    config.rate = fps;
+    auto audio = mp_audio_pool_get(pool, &config, frames);
+    const bool s16 = af_fmt_from_planar(type) == AF_FORMAT_S16;
+    quint32 seed = 1;
+    for (int i = 0; i < frames; ++i) {
+        for (int c = 0; c < nch; ++c) {
+            seed = seed * 1664525u + 1013904223u;
+            const float noise = (seed >> 8) / float(1 << 24) - 0.5f;
+            const float v = 0.4f * std::sin(2 * M_PI * 220 * (c + 1) * i / fps) + 0.1f * noise;
+            const int plane = audio->num_planes > 1 ? c : 0;
+            const int index = audio->num_planes > 1 ? i : i * nch + c;
+            if (s16)
+                static_cast<qint16*>(audio->planes[plane])[index] = v * 32767;
+            else
+                static_cast<float*>(audio->planes[plane])[index] = v;
+        }
+    }
+    return audio;
+}
+
+// drives AudioController without mpv
+class AudioChainRunner {
+public:
+    AudioChainRunner(AudioController *ac, bool scaler, bool normalizer)
+        : m_ac(ac)
+    {
+        m_af = talloc_zero(nullptr, af_instance);
+        m_af->data = talloc_zero(m_af, mp_audio);
+        m_af->out_pool = mp_audio_pool_create(m_af);
+        AudioController::attach(m_af, ac, scaler, normalizer);
+    }
+    ~AudioChainRunner()
+    {
+        m_af->uninit(m_af);
+        talloc_free(m_af);
+    }
+    // zero format/rate or null channels keep those of input
+    auto configure(const mp_audio *in, int format, int rate,
+                   const mp_chmap *channels) -> bool
+    {
+        if (format)
+            m_af->control(m_af, AF_CONTROL_SET_FORMAT, &format);
+        if (rate)
+            m_af->control(m_af, AF_CONTROL_SET_RESAMPLE_RATE, &rate);
+        if (channels)
+            m_af->control(m_af, AF_CONTROL_SET_CHANNELS, const_cast<mp_chmap*>(channels));
+        mp_audio fmt_in;
+        memset(&fmt_in, 0, sizeof(fmt_in));
+        mp_audio_copy_config(&fmt_in, in);
+        m_af->fmt_in = fmt_in;
+        if (m_af->control(m_af, AF_CONTROL_REINIT, &fmt_in) != AF_OK)
+            return false;
+        m_af->fmt_out = *m_af->data;
+        return true;
+    }
+    auto setSpeed(double speed) -> void
+        { m_af->control(m_af, AF_CONTROL_SET_PLAYBACK_SPEED, &speed); }
+    auto setProfiling(bool on) -> void { m_ac->setProfiling(on); }
+    auto stages() const -> QVector<AudioStageTime> { return m_ac->stageTimes(); }
+    // takes in and calls output for every frame filtered; null in drains
+    auto run(mp_audio *in, const std::function<void(const mp_audio*)> &output) -> void
+    {
+        m_af->filter_frame(m_af, in);
+        for (;;) {
+            const int queued = m_af->num_out_queued;
+            m_af->filter_out(m_af);
+            if (m_af->num_out_queued == queued)
+                break;
+        }
+        for (int i = 0; i < m_af->num_out_queued; ++i) {
+            output(m_af->out_queued[i]);
+            talloc_free(m_af->out_queued[i]);
+        }
+        m_af->num_out_queued = 0;
+    }
+private:
+    AudioController *m_ac = nullptr;
+    af_instance *m_af = nullptr;
+};
+
+auto benchmarkAudioChain() -> void
+{
+    Benchmark bm(u"audio-chain"_q);
+    constexpr int chunk = 1024, chunks = 47; // about 1 sec at 48kHz
+    const struct {
+        const char *name;
+        int type, nch, fps, out_type, out_nch, out_fps;
+        double speed;
+        AudioEqualizer::Preset eq;
+        bool normalizer;
+    } cases[] = {
+        { "s16 2ch 48k > s16",           AF_FORMAT_S16,    2, 48000, AF_FORMAT_S16,  2, 0, 1.0, AudioEqualizer::Flat, false },
+        { "float 2ch 44.1k > 48k float", AF_FORMAT_FLOAT,  2, 44100, AF_FORMAT_FLOAT, 2, 48000, 1.0, AudioEqualizer::Flat, false },
+        { "floatp 6ch 48k > 2ch s16",    AF_FORMAT_FLOATP, 6, 48000, AF_FORMAT_S16,  2, 0, 1.0, AudioEqualizer::Flat, false },
+        { "floatp 8ch 48k > s32",        AF_FORMAT_FLOATP, 8, 48000, AF_FORMAT_S32,  8, 0, 1.0, AudioEqualizer::Flat, false },
+        { "s16 2ch 48k eq rock",         AF_FORMAT_S16,    2, 48000, AF_FORMAT_S16,  2, 0, 1.0, AudioEqualizer::Rock, false },
+        { "s16 2ch 48k normalizer",      AF_FORMAT_S16,    2, 48000, AF_FORMAT_S16,  2, 0, 1.0, AudioEqualizer::Flat, true },
+        { "float 2ch 48k x0.5",          AF_FORMAT_FLOAT,  2, 48000, AF_FORMAT_FLOAT, 2, 0, 0.5, AudioEqualizer::Flat, false },
+        { "float 2ch 48k x1.5",          AF_FORMAT_FLOAT,  2, 48000, AF_FORMAT_FLOAT, 2, 0, 1.5, AudioEqualizer::Flat, false },
+        { "float 2ch 48k x2.0",          AF_FORMAT_FLOAT,  2, 48000, AF_FORMAT_FLOAT, 2, 0, 2.0, AudioEqualizer::Flat, false },
+        { "floatp 6ch 48k x2.0 all",     AF_FORMAT_FLOATP, 6, 48000, AF_FORMAT_S16,  2, 0, 2.0, AudioEqualizer::Pop, true },
+    };
+    auto pool = mp_audio_pool_create(nullptr);
+    for (auto &c : cases) {
+        const QString name = _L(c.name);
+        auto source = makeSource(pool, c.type, c.nch, c.fps, chunk);
+        mp_chmap out;
+        mp_chmap_from_channels(&out, c.out_nch);
+        // setup for chain in steady state
+        auto prepare = [&] (AudioController &ac, AudioChainRunner &runner) -> bool {
+            ac.setEqualizer(AudioEqualizer(c.eq));
+            if (c.normalizer)
+                ac.setNormalizerOption(AudioNormalizerOption::default_());
+            if (!runner.configure(source, c.out_type, c.out_fps, &out))
+                return false;
+            runner.setSpeed(c.speed);
+            return true;
+        };
+        auto feed = [&] (AudioChainRunner &runner, const std::function<void(const mp_audio*)> &output) {
+            runner.run(mp_audio_pool_new_copy(pool, source), output);
+        };
+
+        // checksum of output from fresh chain
+        {
+            AudioController ac;
+            AudioChainRunner runner(&ac, c.speed != 1.0, c.normalizer);
+            if (!prepare(ac, runner)) {
+                qDebug().nospace().noquote() << "  " << name << ": not supported";
+                talloc_free(source);
+                continue;
+            }
+            quint64 hash = 0xcbf29ce484222325ull;
+            auto output = [&] (const mp_audio *audio) {
+                for (int i = 0; i < audio->num_planes; ++i)
+                    hash = Benchmark::checksum(audio->planes[i], audio->samples * audio->sstride, hash);
+            };
+            for (int i = 0; i < chunks; ++i)
+                feed(runner, output);
+            runner.run(nullptr, output);
+            bm.check(name, hash);
+        }
+
+        AudioController ac;
+        AudioChainRunner runner(&ac, c.speed != 1.0, c.normalizer);
+        prepare(ac, runner);
+        auto discard = [] (const mp_audio*) { };
+        const auto nsec = Benchmark::measure([&] () { feed(runner, discard); });
+        bm.reportRealtime(name, nsec, chunk / double(c.fps));
+
+        runner.setProfiling(true);
+        for (int i = 0; i < chunks; ++i)
+            feed(runner, discard);
+        runner.setProfiling(false);
+        for (auto &stage : runner.stages()) {
+            if (stage.frames > 0)
+                bm.report("  "_a % stage.name, stage.nsec / double(chunks),
+                          stage.frames / double(chunks), u"frame"_q);
+        }
+        talloc_free(source);
+    }
+    talloc_free(pool);
+}
@@ -1,29 +1,187 @@
 #include "audiobuffer.hpp"
+extern "C" {
+#include <libavutil/buffer.h>
+}
+
+static constexpr int Align = 64;
+
+static auto unrefPlanes(void *ptr) -> void
+{
+    auto audio = static_cast<mp_audio*>(ptr);
+    for (auto &block : audio->allocated)
+        av_buffer_unref(&block);
+}
+
+AudioBuffer::AudioBuffer(AudioBufferArena *arena)
+    : m_arena(arena)
+{
+    memset(&m_frame, 0, sizeof(m_frame));
+    m_audio = &m_frame;
+}
+
+AudioBuffer::~AudioBuffer()
+{
+    release();
+    unrefPlanes(&m_frame);
+}
+
+auto AudioBuffer::release() -> void
+{
+    if (isWrapped())
+        talloc_free(m_audio);
+    m_audio = &m_frame;
+}
+
+auto AudioBuffer::detach() -> void
+{
+    if (m_writable)
+        return;
+    mp_audio_make_writeable(m_audio);
+    m_writable = true;
+    ++m_arena->m_allocations;
+}
+
+// each plane is a block in m_frame.allocated as in mp_audio_pool
+auto AudioBuffer::layout() -> void
+{
+    const int planes = m_frame.num_planes, stride = m_frame.sstride;
+    int pbytes = planes ? INT_MAX : 0;
+    for (int i = 0; i < MP_NUM_CHANNELS; ++i) {
+        const auto block = m_frame.allocated[i];
+        m_frame.planes[i] = i < planes && block ? block->data : nullptr;
+        if (i < planes)
+            pbytes = block ? qMin(pbytes, block->size) : 0;
+    }
+    m_capacity = stride ? pbytes / stride : 0;
+}
+
+// blocks still referenced by mpv are replaced rather than overwritten
+auto AudioBuffer::reserve(int frames, bool keep) -> void
+{
+    if (frames > m_capacity || !mp_audio_is_writeable(&m_frame)) {
+        const int planes = m_frame.num_planes, stride = m_frame.sstride;
+        const int samples = m_frame.samples;
+        // leave some room for varying frames
+        const int capacity = frames > m_capacity ? frames + frames/2 : m_capacity;
+        const int pbytes = (capacity * stride + Align - 1) / Align * Align;
+        for (int i = 0; i < MP_NUM_CHANNELS; ++i) {
+            auto block = i < planes ? av_buffer_alloc(pbytes) : nullptr;
+            if (i < planes && !block)
+                abort(); // oom
+            if (block && keep)
+                memcpy(block->data, m_frame.planes[i], samples * stride);
+            av_buffer_unref(&m_frame.allocated[i]);
+            m_frame.allocated[i] = block;
+        }
+        layout();
+        ++m_arena->m_allocations;
+    }
+    m_frame.samples = frames;
+}
 
 auto AudioBuffer::expand(int frames) -> void
 {
     if (this->frames() == frames)
         return;
-    detach();
-    if (frames > m_audio->samples)
-        mp_audio_realloc_min(m_audio, frames);
-    m_audio->samples = frames;
+    if (isWrapped()) {
+        detach();
+        if (frames > m_audio->samples)
+            mp_audio_realloc_min(m_audio, frames);
+        m_audio->samples = frames;
+    } else
+        reserve(frames, true);
     makeEnds();
 }
 
 auto AudioBuffer::makeEnds() -> void
 {
     const int bytes = pstride();
-    m_ends.resize(planes());
     for (int i = 0; i < planes(); ++i)
         m_ends[i] = (uchar*)m_audio->planes[i] + bytes;
 }
 
-auto AudioBuffer::fromMpAudio(mp_audio *mp) -> AudioBufferPtr
+/******************************************************************************/
+
+AudioBufferArena::AudioBufferArena(int size)
+{
+    m_buffers.reserve(size);
+    m_free.reserve(size);
+    for (int i = 0; i < size; ++i) {
+        m_buffers.push_back(new AudioBuffer(this));
+        m_free.push_back(m_buffers.back());
+    }
+}
+
+AudioBufferArena::~AudioBufferArena()
+{
+    Q_ASSERT(m_free.size() == m_buffers.size());
+    for (auto buffer : m_buffers)
+        delete buffer;
+}
+
+auto AudioBufferArena::acquire() -> AudioBuffer*
+{
+    if (m_free.empty()) {
+        // grow only when held buffers exceed the size, e.g., for normalizer
+        m_buffers.push_back(new AudioBuffer(this));
+        m_free.reserve(m_buffers.capacity());
+        ++m_allocations;
+        return m_buffers.back();
+    }
+    // planes lent to mpv by take() are still held until mpv drops them, so
+    // prefer the oldest buffer whose storage can be reused as is
+    auto it = std::find_if(m_free.begin(), m_free.end(), [] (AudioBuffer *buffer)
+        { return mp_audio_is_writeable(&buffer->m_frame); });
+    if (it == m_free.end())
+        it = m_free.begin();
+    auto buffer = *it;
+    m_free.erase(it);
+    return buffer;
+}
+
+auto AudioBufferArena::recycle(AudioBuffer *buffer) -> void
 {
-    auto buffer = new AudioBuffer;
-    buffer->m_audio = mp;
-    buffer->m_writable = mp_audio_is_writeable(mp);
+    buffer->release();
+    m_free.push_back(buffer);
+}
+
+auto AudioBufferArena::get(const AudioBufferFormat &format, int frames) -> AudioBufferPtr
+{
+    auto buffer = acquire();
+    if (!mp_audio_config_equals(&buffer->m_frame, &format.mpAudio())) {
+        mp_audio_copy_config(&buffer->m_frame, &format.mpAudio());
+        buffer->layout();
+    }
+    buffer->reserve(frames, false);
+    buffer->m_writable = true;
     buffer->makeEnds();
     return AudioBufferPtr(buffer);
 }
+
+auto AudioBufferArena::wrap(mp_audio *audio) -> AudioBufferPtr
+{
+    auto buffer = acquire();
+    buffer->m_audio = audio;
+    buffer->m_writable = mp_audio_is_writeable(audio);
+    buffer->makeEnds();
+    return AudioBufferPtr(buffer);
+}
+
+auto AudioBufferArena::take(AudioBufferPtr &&buffer, mp_audio_pool *pool) -> mp_audio*
+{
+    mp_audio *audio = nullptr;
+    if (buffer->isWrapped() && buffer.isUnique()) {
+        audio = buffer->m_audio;
+        buffer->m_audio = &buffer->m_frame;
+    } else if (!buffer->isWrapped() && buffer.isUnique()) {
+        // share own planes; reserve() replaces them if still held on reuse
+        audio = talloc_zero(nullptr, mp_audio);
+        *audio = buffer->m_frame;
+        for (auto &block : audio->allocated)
+            block = block ? av_buffer_ref(block) : nullptr;
+        talloc_set_destructor(audio, unrefPlanes);
+    } else
+        audio = mp_audio_pool_new_copy(pool, buffer->m_audio);
+    buffer = AudioBufferPtr();
+    return audio;
+}
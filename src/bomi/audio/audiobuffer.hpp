@@ -38,8 +38,33 @@ private:
     mp_audio m_audio;
 };
 
-class AudioBuffer;
-using AudioBufferPtr = QSharedPointer<AudioBuffer>;
+class AudioBuffer;                      class AudioBufferArena;
+
+// intrusive reference to AudioBuffer which returns the buffer to its arena
+// when the last reference is gone. buffers live on audio thread only.
+class AudioBufferPtr {
+public:
+    AudioBufferPtr() { }
+    AudioBufferPtr(const AudioBufferPtr &rhs): m_ptr(rhs.m_ptr) { ref(); }
+    AudioBufferPtr(AudioBufferPtr &&rhs): m_ptr(rhs.m_ptr) { rhs.m_ptr = nullptr; }
+    ~AudioBufferPtr() { deref(); }
+    auto operator = (const AudioBufferPtr &rhs) -> AudioBufferPtr&
+        { AudioBufferPtr tmp(rhs); std::swap(m_ptr, tmp.m_ptr); return *this; }
+    auto operator = (AudioBufferPtr &&rhs) -> AudioBufferPtr&
+        { std::swap(m_ptr, rhs.m_ptr); return *this; }
+    auto operator -> () const -> AudioBuffer* { return m_ptr; }
+    auto operator * () const -> AudioBuffer& { return *m_ptr; }
+    explicit operator bool () const { return m_ptr; }
+    auto operator ! () const -> bool { return !m_ptr; }
+    auto data() const -> AudioBuffer* { return m_ptr; }
+    auto isUnique() const -> bool;
+private:
+    AudioBufferPtr(AudioBuffer *ptr): m_ptr(ptr) { ref(); }
+    auto ref() -> void;
+    auto deref() -> void;
+    AudioBuffer *m_ptr = nullptr;
+    friend class AudioBufferArena;
+};
 
 template<class T>
 class AudioBufferConstView;
@@ -49,11 +74,9 @@ class AudioBufferView;
 
 class AudioBuffer {
 public:
-    ~AudioBuffer() { talloc_free(m_audio); }
     auto expand(int frames) -> void;
     auto isWritable() const -> bool { return m_writable; }
-    auto take() -> mp_audio* { auto p = m_audio; m_audio = nullptr; return p; }
-    auto detach() -> void { if (!m_writable) mp_audio_make_writeable(m_audio); }
+    auto detach() -> void;
     auto type() const -> af_format { return (af_format)m_audio->format; }
     auto samples() const -> int { return frames() * channels(); }
     auto frames() const -> int { return m_audio->samples; }
@@ -69,23 +92,66 @@ public:
     auto data() const -> const uchar** { return (const uchar**)m_audio->planes; }
     auto constData() const -> const uchar** { return data(); }
     auto data() -> uchar** { detach(); return (uchar**)m_audio->planes; }
+    auto mpAudio() const -> const mp_audio* { return m_audio; }
     template<class T>
     auto view() -> AudioBufferView<T>;
     template<class T>
     auto view() const -> AudioBufferConstView<T> { return constView<T>(); }
     template<class T>
     auto constView() const -> AudioBufferConstView<T>;
-    static auto fromMpAudio(mp_audio *mp) -> AudioBufferPtr;
 private:
+    AudioBuffer(AudioBufferArena *arena);
+    ~AudioBuffer();
     auto makeEnds() -> void;
-    AudioBuffer() { }
+    auto isWrapped() const -> bool { return m_audio != &m_frame; }
+    auto layout() -> void;
+    auto reserve(int frames, bool keep) -> void;
+    auto release() -> void;
     mp_audio *m_audio = nullptr;
     bool m_writable = false;
-    std::vector<void*> m_ends;
+    int m_ref = 0, m_capacity = 0;
+    AudioBufferArena *m_arena = nullptr;
+    void *m_ends[MP_NUM_CHANNELS];
+    mp_audio m_frame; // own storage which m_audio points unless wrapped
+    friend class AudioBufferPtr;
+    friend class AudioBufferArena;
     template<class T> friend class AudioBufferConstView;
     template<class T> friend class AudioBufferView;
 };
 
+// fixed set of buffers recycled for audio filters
+// storage of a buffer grows only when larger frames are requested so that
+// steady state playback does not touch heap at all
+class AudioBufferArena {
+public:
+    AudioBufferArena(int size = 32);
+    ~AudioBufferArena();
+    auto get(const AudioBufferFormat &format, int frames) -> AudioBufferPtr;
+    // wrap mp_audio from mpv which is freed when the buffer is recycled
+    auto wrap(mp_audio *audio) -> AudioBufferPtr;
+    // mp_audio to be owned by mpv; data is shared unless the buffer is still
+    // referenced elsewhere, in which case it is copied into pool
+    auto take(AudioBufferPtr &&buffer, mp_audio_pool *pool) -> mp_audio*;
+    // number of heap allocations made for buffers so far
+    auto allocations() const -> quint64 { return m_allocations.load(); }
+private:
+    auto acquire() -> AudioBuffer*;
+    auto recycle(AudioBuffer *buffer) -> void;
+    std::vector<AudioBuffer*> m_buffers, m_free; // m_free is oldest first
+    QAtomicInteger<quint64> m_allocations{0}; // read by SpeedMeasure timer on audio thread
+    friend class AudioBuffer;
+    friend class AudioBufferPtr;
+};
+
+inline auto AudioBufferPtr::ref() -> void
+{ if (m_ptr) ++m_ptr->m_ref; }
+
+inline auto AudioBufferPtr::deref() -> void
+{ if (m_ptr && !--m_ptr->m_ref) m_ptr->m_arena->recycle(m_ptr); }
+
+inline auto AudioBufferPtr::isUnique() const -> bool
+{ return m_ptr && m_ptr->m_ref == 1; }
+
 template<class T>
 class AudioBufferConstView {
 public:
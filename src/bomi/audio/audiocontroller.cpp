@@ -7,10 +7,12 @@
 #include "audioconverter.hpp"
 #include "audioresampler.hpp"
 #include "audioequalizer.hpp"
+#include "audioequalizerfilter.hpp"
 #include "player/mpv_helper.hpp"
 #include "enum/channellayout.hpp"
 #include "misc/log.hpp"
 #include "misc/speedmeasure.hpp"
+#include "misc/triplebuffer.hpp"
 extern "C" {
 #include <audio/filter/af.h>
 }
@@ -50,11 +52,37 @@ enum FilterDirty : quint32 {
     Scale = 32,
     Resample = 64,
     Clip = 128,
-    Equalizer = 256
+    Equalizer = 256,
+    Dither = 512,
+    Search = 1024
+};
+
+template<class T>
+struct Param {
+    auto set(const T &t) -> void { value = t; ++serial; }
+    T value; quint32 serial = 0;
+};
+
+// parameters from gui thread; audio thread picks up latest one without lock
+struct AudioParams {
+    Param<AudioNormalizerOption> normalizer;
+    Param<ChannelLayoutMap> map{ChannelLayoutMap::default_()};
+    Param<AudioEqualizer> eq;
+    Param<bool> softClip{false}, dither{false}, coarseSearch{false};
+};
+
+static const char *const s_stages[] = {
+    "resampler", "analyzer", "scaler", "mixer", "equalizer", "converter"
 };
 
 struct AudioController::Data {
-    quint32 dirty = 0;
+    // declared first to be destroyed after every holder of buffers
+    AudioBufferArena arena;
+    quint64 allocations = 0;
+    QElapsedTimer allocationTimer;
+    double allocationRate = 0;
+
+    quint32 dirty = 0; // for audio thread only
     int fmt_conv = AF_FORMAT_UNKNOWN, outrate = 0;
     SpeedMeasure<quint64> measure{10, 30};
     int srate = 0;
@@ -63,11 +91,11 @@ struct AudioController::Data {
     double scale = 1.0, amp = 1.0, gain = 1.0;
     mp_chmap chmap;
     af_instance *af = nullptr;
-    AudioNormalizerOption normalizerOption;
-    bool softClip = false;
-    ChannelLayoutMap map = ChannelLayoutMap::default_();
+    TripleBuffer<AudioParams> params;
+    AudioParams latest; // for writers
+    QMutex writer; // serializes writers; never taken by audio thread
+    struct { quint32 normalizer = 0, map = 0, eq = 0, softClip = 0, dither = 0, search = 0; } applied;
     ChannelLayout layout = ChannelLayoutInfo::default_();
-    AudioEqualizer eq;
     AudioFormat from, to;
     AudioVisualizer vis;
 
@@ -78,13 +106,114 @@ struct AudioController::Data {
     AudioAnalyzer analyzer;
     AudioScaler scaler;
     AudioMixer mixer;
+    AudioEqualizerFilter equalizer;
     AudioConverter converter;
     AudioBufferPtr input;
     QVector<AudioBufferPtr> forFft;
     QVector<AudioFilter*> filters;
     QVector<AudioFilter*> chain;
 
-    QMutex mutex;
+    // stages are in the order of filters; wall time is taken on every buffer
+    // and kept for the last LoadWindow buffers to get percentiles cheaply
+    static constexpr int LoadWindow = 256;
+    struct StageLog {
+        qint64 spent = -1, nsec = 0, frames = 0; // since last publish
+        std::array<qint32, LoadWindow> window;
+        int count = 0, pos = 0;
+    };
+    bool profile = false;
+    qint64 lapped = 0, outFrames = 0;
+    int outRate = 0;
+    QElapsedTimer clock, loadTimer;
+    std::array<AudioStageTime, 6> stages;
+    std::array<StageLog, 6> logs;
+    TripleBuffer<std::array<AudioStageLoad, 6>> loads;
+    auto startLap() -> void { lapped = clock.nsecsElapsed(); }
+    auto lap(int stage, int frames) -> void
+    {
+        const auto now = clock.nsecsElapsed();
+        auto &log = logs[stage];
+        log.spent = qMax<qint64>(log.spent, 0) + now - lapped;
+        log.frames += frames;
+        if (profile) {
+            stages[stage].nsec += now - lapped;
+            stages[stage].frames += frames;
+        }
+        lapped = now;
+    }
+    // called at the end of every output()
+    auto account() -> void
+    {
+        for (auto &log : logs) {
+            if (log.spent < 0)
+                continue;
+            log.nsec += log.spent;
+            log.window[log.pos] = qMin<qint64>(log.spent, _Max<qint32>());
+            log.pos = (log.pos + 1) % LoadWindow;
+            log.count = qMin(log.count + 1, LoadWindow);
+            log.spent = -1;
+        }
+    }
+    // in audio thread; returns false if nothing to publish
+    auto publish() -> bool
+    {
+        if (!outFrames || !outRate)
+            return false;
+        const double sec = outFrames / double(outRate);
+        auto &list = loads.back();
+        std::array<qint32, LoadWindow> sorted;
+        for (int i = 0; i < (int)logs.size(); ++i) {
+            auto &log = logs[i];
+            auto &load = list[i];
+            load.name = stages[i].name;
+            load.frames = log.frames;
+            load.load = log.nsec * 1e-9 / sec;
+            load.p50 = load.p99 = 0;
+            if (log.count > 0) {
+                const auto begin = sorted.begin(), end = begin + log.count;
+                std::copy_n(log.window.begin(), log.count, begin);
+                auto at = [&] (double p) {
+                    const auto it = begin + qMin<int>(log.count * p, log.count - 1);
+                    std::nth_element(begin, it, end);
+                    return *it * 1e-3;
+                };
+                load.p50 = at(0.5);
+                load.p99 = at(0.99);
+            }
+            log.nsec = log.frames = 0;
+        }
+        outFrames = 0;
+        loads.publish();
+        return true;
+    }
+
+    template<class T>
+    auto write(Param<T> AudioParams::*param, const T &t) -> void
+    {
+        QMutexLocker locker(&writer);
+        (latest.*param).set(t);
+        params.back() = latest;
+        params.publish();
+    }
+    auto read() -> const AudioParams&
+    {
+        if (params.update()) {
+            const auto &p = params.front();
+            if (_Change(applied.normalizer, p.normalizer.serial))
+                dirty |= Normalizer;
+            if (_Change(applied.map, p.map.serial))
+                dirty |= ChMap;
+            if (_Change(applied.eq, p.eq.serial))
+                dirty |= Equalizer;
+            if (_Change(applied.softClip, p.softClip.serial))
+                dirty |= Clip;
+            if (_Change(applied.dither, p.dither.serial))
+                dirty |= Dither;
+            if (_Change(applied.search, p.coarseSearch.serial))
+                dirty |= Search;
+        }
+        return params.front();
+    }
 };
 
 AudioController::AudioController(QObject *parent)
@@ -96,10 +225,28 @@ AudioController::AudioController(QObject *parent)
             emit samplerateChanged(d->srate);
         if (_Change<double>(d->gain, d->normalizerActivated ? d->analyzer.gain() : -1))
             emit gainChanged(d->gain);
+        if (d->allocationTimer.hasExpired(1000)) {
+            const auto allocations = d->arena.allocations();
+            const auto msec = d->allocationTimer.restart();
+            d->allocationRate = (allocations - d->allocations) * 1000.0 / msec;
+            d->allocations = allocations;
+            if (d->allocationRate > 0)
+                _Debug("Audio buffers allocated %% times per second.", d->allocationRate);
+        }
+        if (d->loadTimer.hasExpired(500) && d->publish()) {
+            d->loadTimer.restart();
+            emit stageLoadsChanged();
+        }
     }, 100000);
+    d->allocationTimer.start();
+    d->loadTimer.start();
+    d->clock.start();
 
-    d->chain << &d->scaler << &d->mixer << &d->converter;
+    d->chain << &d->scaler << &d->mixer << &d->equalizer << &d->converter;
     d->filters << &d->resampler << &d->analyzer << d->chain;
+    Q_ASSERT(d->filters.size() == (int)d->stages.size());
+    for (int i = 0; i < (int)d->stages.size(); ++i)
+        d->stages[i].name = _L(s_stages[i]);
 }
 
 AudioController::~AudioController()
@@ -109,8 +256,17 @@ AudioController::~AudioController()
 
 auto AudioController::setSoftClip(bool soft) -> void
 {
-    d->softClip = soft;
-    d->dirty |= Clip;
+    d->write(&AudioParams::softClip, soft);
+}
+
+auto AudioController::setDithering(bool dither) -> void
+{
+    d->write(&AudioParams::dither, dither);
+}
+
+auto AudioController::setTempoScalerSearch(bool coarse) -> void
+{
+    d->write(&AudioParams::coarseSearch, coarse);
 }
 
 auto AudioController::test(int fmt_in, int fmt_out) -> bool
@@ -200,18 +356,22 @@ auto AudioController::reinitialize(mp_audio *from) -> int
 
     d->resampler.setFormat(buf_from, buf_mixer_in);
     d->analyzer.setFormat(buf_mixer_in);
+    const auto &params = d->read();
+    d->scaler.setCoarseSearch(params.coarseSearch.value);
     d->scaler.setFormat(buf_mixer_in);
     d->mixer.setFormat(buf_mixer_in, buf_mixer_out);
-    d->mixer.setChannelLayoutMap(d->map);
-    d->mixer.setSoftClip(d->softClip);
+    d->mixer.setChannelLayoutMap(params.map.value);
+    d->equalizer.setFormat(buf_mixer_out);
     d->converter.setFormat(buf_to);
+    d->converter.setSoftClip(params.softClip.value);
+    d->converter.setDithering(params.dither.value);
 
     d->fmt_to = (af_format)to->format;
     d->dirty = 0xffffffff;
     d->eof = false;
 
     for (auto filter : d->filters) {
-        filter->setPool(d->af->out_pool);
+        filter->setArena(&d->arena);
         filter->reset();
     }
     d->vis.reset();
@@ -257,11 +417,11 @@ auto AudioController::control(int cmd, void *arg) -> int
 
 auto AudioController::filter(mp_audio *data) -> int
 {
+    const auto &params = d->read();
     if (d->dirty) {
-        d->mutex.lock();
         if (d->dirty & Normalizer) {
             d->analyzer.setNormalizerActive(d->normalizerActivated);
-            d->analyzer.setNormalizerOption(d->normalizerOption);
+            d->analyzer.setNormalizerOption(params.normalizer.value);
         }
         if (d->dirty & Scale) {
             d->scaler.setActive(d->tempoScalerActivated);
@@ -269,45 +429,60 @@ auto AudioController::filter(mp_audio *data) -> int
                 filter->setScale(d->scale);
         }
         if (d->dirty & ChMap)
-            d->mixer.setChannelLayoutMap(d->map);
+            d->mixer.setChannelLayoutMap(params.map.value);
         if (d->dirty & Clip)
-            d->mixer.setSoftClip(d->softClip);
+            d->converter.setSoftClip(params.softClip.value);
+        if (d->dirty & Dither)
+            d->converter.setDithering(params.dither.value);
+        if (d->dirty & Search)
+            d->scaler.setCoarseSearch(params.coarseSearch.value);
         if (d->dirty & Equalizer)
-            d->mixer.setEqualizer(d->eq);
+            d->equalizer.setEqualizer(params.eq.value);
         d->dirty = 0;
-        d->mutex.unlock();
     }
 
     d->eof = !data;
     if (d->eof)
         return 0;
     d->measure.push(d->samples += data->samples);
-    d->input = AudioBuffer::fromMpAudio(data);
+    d->input = d->arena.wrap(data);
     return 0;
 }
 
 auto AudioController::output() -> int
 {
+    d->startLap();
     if (d->input) {
+        const int frames = d->input->frames();
         auto buffer = d->resampler.run(d->input);
         d->input = AudioBufferPtr();
+        d->lap(0, frames);
+        const int resampled = buffer->frames(); // push() takes buffer
         d->analyzer.push(buffer);
+        d->lap(1, resampled);
     }
     do {
         auto buffer = d->analyzer.pull(d->eof);
+        d->lap(1, 0);
         if (!buffer || buffer->isEmpty())
             break;
         if (d->vis.isActive())
             d->vis.analyze(buffer);
         d->mixer.setAmplifier(d->amp * d->analyzer.gain());
-        for (auto filter : d->chain) {
-            if (!filter->passthrough(buffer))
-                buffer = filter->run(buffer);
+        d->startLap();
+        for (int i = 0; i < d->chain.size(); ++i) {
+            const int frames = buffer->frames();
+            if (!d->chain[i]->passthrough(buffer))
+                buffer = d->chain[i]->run(buffer);
+            d->lap(2 + i, frames);
         }
-        auto audio = buffer->take();
+        auto audio = d->arena.take(std::move(buffer), d->af->out_pool);
         Q_ASSERT(mp_audio_config_equals(&d->af->fmt_out, audio));
+        d->outFrames += audio->samples;
+        d->outRate = audio->rate;
         af_add_output_frame(d->af, audio);
     } while (false);
+    d->account();
 
     d->af->delay = 0;
     for (auto filter : d->filters)
@@ -315,6 +490,20 @@ auto AudioController::output() -> int
     return 0;
 }
 
+auto AudioController::allocationRate() const -> double
+{
+    return d->allocationRate;
+}
+
+auto AudioController::stageLoads() const -> QVector<AudioStageLoad>
+{
+    d->loads.update();
+    QVector<AudioStageLoad> loads;
+    for (auto &load : d->loads.front())
+        loads.push_back(load);
+    return loads;
+}
+
 auto AudioController::setAnalyzeSpectrum(bool on) -> void
 {
     d->vis.setActive(on);
@@ -348,8 +537,7 @@ auto AudioController::isTempoScalerActivated() const -> bool
 auto AudioController::setNormalizerOption(const AudioNormalizerOption &option)
 -> void
 {
-    d->normalizerOption = option;
-    d->dirty |= Normalizer;
+    d->write(&AudioParams::normalizer, option);
 }
 
 auto AudioController::isNormalizerActivated() const -> bool
@@ -359,8 +547,7 @@ auto AudioController::isNormalizerActivated() const -> bool
 
 auto AudioController::setChannelLayoutMap(const ChannelLayoutMap &map) -> void
 {
-    d->map = map;
-    d->dirty |= ChMap;
+    d->write(&AudioParams::map, map);
 }
 
 auto AudioController::setOutputChannelLayout(ChannelLayout layout) -> void
@@ -369,6 +556,35 @@ auto AudioController::setOutputChannelLayout(ChannelLayout layout) -> void
     d->dirty |= ChMap;
 }
 
+/******************************************************************************/
+
+auto AudioController::attach(af_instance *af, AudioController *ac,
+                             bool scaler, bool normalizer) -> int
+{
+    auto p = talloc_zero(af, bomi_af_priv);
+    p->address = talloc_strdup(af, address_cast<QByteArray>(ac).constData());
+    p->use_scaler = scaler;
+    p->use_normalizer = normalizer;
+    af->priv = p;
+    return open(af);
+}
+
+auto AudioController::setProfiling(bool on) -> void
+{
+    if (_Change(d->profile, on) && on) {
+        for (auto &stage : d->stages)
+            stage.nsec = stage.frames = 0;
+    }
+}
+
+auto AudioController::stageTimes() const -> QVector<AudioStageTime>
+{
+    QVector<AudioStageTime> stages;
+    for (auto &stage : d->stages)
+        stages.push_back(stage);
+    return stages;
+}
+
 af_info create_info() {
 #define MPV_OPTION_BASE bomi_af_priv
     static m_option options[] = {
@@ -392,10 +608,7 @@ af_info create_info() {
 
 auto AudioController::setEqualizer(const AudioEqualizer &eq) -> void
 {
-    d->mutex.lock();
-    d->eq = eq;
-    d->dirty |= Equalizer;
-    d->mutex.unlock();
+    d->write(&AudioParams::eq, eq);
 }
 
 auto AudioController::visualizer() const -> AudioVisualizer*
@@ -4,6 +4,7 @@
 struct af_instance;                     struct mp_audio;
 struct af_cfg;                          struct af_info;
 struct mp_chmap;                        struct AudioNormalizerOption;
+struct AudioStageLoad;                  struct AudioStageTime;
 class ChannelLayoutMap;                 class AudioFormat;
 class AudioEqualizer;                   class AudioVisualizer;
 enum class ChannelLayout;
@@ -18,6 +19,9 @@ public:
     auto isNormalizerActivated() const -> bool;
     auto setNormalizerOption(const AudioNormalizerOption &option) -> void;
     auto setSoftClip(bool soft) -> void;
+    auto setDithering(bool dither) -> void;
+    // coarse-to-fine search for overlap of tempo scaler
+    auto setTempoScalerSearch(bool coarse) -> void;
     auto setChannelLayoutMap(const ChannelLayoutMap &map) -> void;
     auto setOutputChannelLayout(ChannelLayout layout) -> void;
     auto setEqualizer(const AudioEqualizer &eq) -> void;
@@ -25,6 +29,10 @@ public:
     auto inputFormat() const -> AudioFormat;
     auto outputFormat() const -> AudioFormat;
     auto samplerate() const -> int;
+    // heap allocations per second for audio buffers; zero in steady state
+    auto allocationRate() const -> double;
+    // wall time of each filter for recent buffers; updated twice per second
+    auto stageLoads() const -> QVector<AudioStageLoad>;
     auto setAnalyzeSpectrum(bool on) -> void;
     auto visualizer() const -> AudioVisualizer*;
 signals:
@@ -32,6 +40,7 @@ signals:
     void outputFormatChanged();
     void samplerateChanged(int sr);
     void gainChanged(double gain);
+    void stageLoadsChanged();
     void spectrumObtained(const QList<qreal> &data);
 private:
     static auto open(af_instance *af) -> int;
@@ -41,9 +50,28 @@ private:
     auto output() -> int;
     auto uninit() -> void;
     auto control(int cmd, void *arg) -> int;
+    // for AudioChainRunner of audiobenchmark.cpp which drives af without mpv
+    static auto attach(af_instance *af, AudioController *ac,
+                       bool scaler, bool normalizer) -> int;
+    // wall time per filter; sums up until disabled
+    auto setProfiling(bool on) -> void;
+    auto stageTimes() const -> QVector<AudioStageTime>;
     struct Data;
     Data *d;
     friend auto create_info() -> af_info;
+    friend class AudioChainRunner;
+};
+
+struct AudioStageTime {
+    QString name;
+    qint64 nsec = 0, frames = 0;
+};
+
+struct AudioStageLoad {
+    QString name;
+    // wall time per buffer in usec and ratio of time spent to audio played
+    double p50 = 0, p99 = 0, load = 0;
+    qint64 frames = 0;
 };
 
 #endif // AUDIOCONTROLLER_HPP
@@ -1,74 +1,137 @@
 #include "audioconverter.hpp"
-
-#include "misc/tmp.hpp"
-#include "tmp/type_traits.hpp"
+#include "misc/simd.hpp"
 extern "C" {
 #include <audio/format.h>
 #include <audio/audio.h>
 }
 
+static constexpr int BlockFrames = 256;
+
+template<class F>
+SIA put(float *p, typename F::V v, AudioConverter::State *) -> void
+{ F::store(p, v); }
+
+template<class F>
+SIA put(double *p, typename F::V v, AudioConverter::State *) -> void
+{ F::storeF64(p, v); }
+
+template<class F>
+SIA put(qint16 *p, typename F::V v, AudioConverter::State *s) -> void
+{
+    v = F::mul(v, F::set1(32767.f));
+    if (s->dither) // triangular pdf in [-1, 1) lsb
+        v = F::add(v, F::add(F::random(s->seed), F::random(s->seed)));
+    F::storeS16(p, v);
+}
+
+template<class F>
+SIA put(qint32 *p, typename F::V v, AudioConverter::State *) -> void
+{ F::storeS32(p, F::mul(v, F::set1(2147483648.f))); }
+
+template<class F, class T>
+static auto convert(void *dst, const float *src, int samples,
+                    AudioConverter::State *s) -> void
+{
+    constexpr float h = M_PI * 0.5;
+    T *const p = static_cast<T*>(dst);
+    Simd::forEach<F>(samples, [&] (auto f, int i) {
+        using S = decltype(f);
+        auto v = S::load(src + i);
+        if (s->soft)
+            v = Simd::sin<S>(S::max(S::set1(-h), S::min(v, S::set1(h))));
+        put<S>(p + i, S::max(S::set1(-1.f), S::min(v, S::set1(1.f))), s);
+    });
+}
+
+#ifdef SIMD_HAS_AVX2
 template<class T>
-static auto convert(uchar *dst, float src) -> void
+SIMD_AVX2_ENTRY static auto convertAvx2(void *dst, const float *src, int samples,
+                                        AudioConverter::State *s) -> void
 {
-    auto value = (T*)dst;
-    if (tmp::is_floating_point<T>())
-        *value = src;
-    else
-        *value = src * _Max<T>() + 0.5;
+    convert<Simd::Float8, T>(dst, src, samples, s);
 }
+#endif
 
+template<class T>
+static auto kernelFor() -> AudioConverter::Convert
+{
+#ifdef SIMD_HAS_AVX2
+    if (Simd::isa() == Simd::Avx2)
+        return convertAvx2<T>;
+#endif
+#ifdef SIMD_HAS_SSE2
+    return convert<Simd::Float4, T>;
+#else
+    return convert<Simd::Float1, T>;
+#endif
+}
+
+static const struct {
+    af_format packed, planar;
+    AudioConverter::Convert (*kernel)();
+} s_table[] = {
+    { AF_FORMAT_S16,    AF_FORMAT_S16P,    kernelFor<qint16> },
+    { AF_FORMAT_S32,    AF_FORMAT_S32P,    kernelFor<qint32> },
+    { AF_FORMAT_FLOAT,  AF_FORMAT_FLOATP,  kernelFor<float>  },
+    { AF_FORMAT_DOUBLE, AF_FORMAT_DOUBLEP, kernelFor<double> }
+};
+
+AudioConverter::AudioConverter()
+{
+    for (int i = 0; i < 8; ++i)
+        m_state.seed[i] = 0x9e3779b9u * (i + 1);
+    m_block.resize(BlockFrames);
+}
+
+auto AudioConverter::kernel(af_format type) -> Convert
+{
+    for (auto &entry : s_table) {
+        if (entry.packed == type || entry.planar == type)
+            return entry.kernel();
+    }
+    return nullptr;
+}
 
 auto AudioConverter::setFormat(const AudioBufferFormat &format) -> void
 {
     if (!_Change(m_format, format))
         return;
-    m_convert = [=] () -> Convert {
-        switch (format.type()) {
-        case AF_FORMAT_S16:
-        case AF_FORMAT_S16P:
-            return convert<qint16>;
-        case AF_FORMAT_S32:
-        case AF_FORMAT_S32P:
-            return convert<qint32>;
-        case AF_FORMAT_FLOAT:
-        case AF_FORMAT_FLOATP:
-            return convert<float>;
-        case AF_FORMAT_DOUBLE:
-        case AF_FORMAT_DOUBLEP:
-            return convert<double>;
-        default:
-            return nullptr;
-        }
-    }();
+    m_convert = kernel(format.type());
     Q_ASSERT(m_convert != nullptr);
 }
 
 auto AudioConverter::passthrough(const AudioBufferPtr &/*in*/) const -> bool
 {
-    return m_format.type() == AF_FORMAT_FLOAT;
+    return false;
 }
 
 auto AudioConverter::run(AudioBufferPtr &in) -> AudioBufferPtr
 {
-    if (m_format.type() == AF_FORMAT_FLOAT)
-        return in;
-    auto dest = newBuffer(m_format, in->frames());
-    auto sview = in->constView<float>();
-    if (dest->isPlanar()) {
-        for (int ch = 0; ch < dest->channels(); ++ch) {
-            const float *src = sview.plane() + ch;
-            uchar *dst = dest->data()[ch];
-            for (int i = 0; i < in->frames(); ++i) {
-                m_convert(dst, *src);
-                src += dest->channels();
-                dst += dest->bps();
-            }
+    // clipping should follow every other stage including equalizer
+    if (m_format.type() == AF_FORMAT_FLOAT) {
+        if (!in->isEmpty()) {
+            auto view = in->view<float>();
+            m_convert(view.plane(), view.plane(), in->samples(), &m_state);
         }
-    } else {
-        uchar *dst = dest->data()[0];
-        for (auto it = sview.begin(); it != sview.end(); ++it) {
-            m_convert(dst, *it);
-            dst += dest->bps();
+        return in;
+    }
+    const int frames = in->frames();
+    auto dest = newBuffer(m_format, frames);
+    const float *src = in->constView<float>().plane();
+    if (!dest->isPlanar()) {
+        m_convert(dest->data()[0], src, in->samples(), &m_state);
+        return dest;
+    }
+    // deinterleave block by block so that each plane is converted in a row
+    const int nch = dest->channels(), bps = dest->bps();
+    auto planes = dest->data();
+    float *block = m_block.data();
+    for (int f = 0; f < frames; f += BlockFrames, src += BlockFrames * nch) {
+        const int n = qMin(BlockFrames, frames - f);
+        for (int ch = 0; ch < nch; ++ch) {
+            for (int i = 0; i < n; ++i)
+                block[i] = src[i * nch + ch];
+            m_convert(planes[ch] + f * bps, block, n, &m_state);
         }
     }
     return dest;
@@ -5,14 +5,26 @@
 
 class AudioConverter : public AudioFilter {
 public:
+    AudioConverter();
     auto setFormat(const AudioBufferFormat &format) -> void;
+    auto setSoftClip(bool soft) -> void { m_state.soft = soft; }
+    // add triangular dither before quantizing to 16-bit
+    auto setDithering(bool dither) -> void { m_state.dither = dither; }
     auto run(AudioBufferPtr &in) -> AudioBufferPtr override;
     auto format() const -> const AudioBufferFormat& { return m_format; }
     auto passthrough(const AudioBufferPtr &in) const -> bool override;
+    struct State {
+        bool soft = false, dither = false;
+        quint32 seed[8];
+    };
+    // clip and convert samples from interleaved float into dst
+    using Convert = auto (*)(void *dst, const float *src, int samples, State *s) -> void;
+    static auto kernel(af_format type) -> Convert;
 private:
     AudioBufferFormat m_format;
-    using Convert = auto (*)(uchar *dst, float src) -> void;
     Convert m_convert = nullptr;
+    State m_state;
+    std::vector<float> m_block;
 };
 
 #endif // AUDIOCONVERTER_HPP
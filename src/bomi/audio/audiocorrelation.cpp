@@ -0,0 +1,211 @@
+#include "audiocorrelation.hpp"
+#include "misc/simd.hpp"
+#include "kiss_fft/tools/kiss_fftr.h"
+#include <complex>
+
+static constexpr int CoarseStep = 4;
+// cost of FFT per size * log2(size) relative to a vector multiply-add of
+// direct method; measured with kiss_fft
+static constexpr double FftCost = 2.5;
+
+template<class F>
+static auto dot(const float *a, const float *b, int n) -> float
+{
+    auto acc0 = F::zero(), acc1 = F::zero();
+    int i = 0;
+    for (; i + 2 * F::N <= n; i += 2 * F::N) {
+        acc0 = F::madd(F::load(a + i), F::load(b + i), acc0);
+        acc1 = F::madd(F::load(a + i + F::N), F::load(b + i + F::N), acc1);
+    }
+    float sum = F::sum(F::add(acc0, acc1));
+    for (; i < n; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+#ifdef SIMD_HAS_AVX2
+SIMD_AVX2_ENTRY static auto dotAvx2(const float *a, const float *b, int n) -> float
+{
+    return dot<Simd::Float8>(a, b, n);
+}
+#endif
+
+// FFT of one length; configs are allocated in setup() only
+struct Spectrum {
+    kiss_fftr_cfg forward = nullptr, inverse = nullptr;
+    int size = 0;
+    std::vector<float> buffer;
+    std::vector<std::complex<float>> r, s;
+
+    ~Spectrum() { release(); }
+    auto release() -> void
+    {
+        kiss_fftr_free(forward);
+        kiss_fftr_free(inverse);
+        forward = inverse = nullptr;
+        size = 0;
+    }
+    auto cost(int lanes) const -> double
+        { return size ? FftCost * lanes * size * std::log2(size) : 0.0; }
+    auto allocate(int samples) -> void
+    {
+        static_assert(sizeof(std::complex<float>) == sizeof(kiss_fft_cpx), "!!!");
+        const int fast = samples > 0 ? kiss_fftr_next_fast_size_real(samples) : 0;
+        if (!_Change(size, fast))
+            return;
+        kiss_fftr_free(forward);
+        kiss_fftr_free(inverse);
+        forward = size ? kiss_fftr_alloc(size, false, nullptr, nullptr) : nullptr;
+        inverse = size ? kiss_fftr_alloc(size, true, nullptr, nullptr) : nullptr;
+        buffer.resize(size);
+        r.resize(size / 2 + 1);
+        s.resize(size / 2 + 1);
+    }
+    // takes every step-th frame of stride samples
+    auto transform(const float *src, int frames, int stride, int step,
+                   std::complex<float> *dst) -> void
+    {
+        if (step == 1)
+            memcpy(buffer.data(), src, frames * stride * sizeof(float));
+        else {
+            for (int i = 0; i < frames; ++i)
+                memcpy(buffer.data() + i * stride, src + i * step * stride,
+                       stride * sizeof(float));
+        }
+        std::fill(buffer.begin() + frames * stride, buffer.end(), 0.f);
+        kiss_fftr(forward, buffer.data(), (kiss_fft_cpx*)dst);
+    }
+    // cross-correlation of all lags at once by conj(R)*S
+    auto correlate(const float *ref, const float *signal, int frames,
+                   int offsets, int stride, int step) -> int
+    {
+        transform(ref, frames, stride, step, r.data());
+        transform(signal, frames + offsets - 1, stride, step, s.data());
+        for (int i = 0; i < (int)s.size(); ++i)
+            s[i] *= std::conj(r[i]);
+        kiss_fftri(inverse, (const kiss_fft_cpx*)s.data(), buffer.data());
+        int best = 0;
+        float max = -_Max<float>();
+        for (int off = 0; off < offsets; ++off) {
+            const float corr = buffer[off * stride];
+            if (corr > max) {
+                max = corr;
+                best = off;
+            }
+        }
+        return best;
+    }
+};
+
+struct AudioCorrelation::Data {
+    int samples = 0, offsets = 0, stride = 1, lanes = 1;
+    Method method = Auto;
+    bool coarse = false, fft = false;
+    auto (*dot)(const float *a, const float *b, int n) -> float = nullptr;
+    // coarse one correlates every CoarseStep-th frame
+    Spectrum full, decimated;
+
+    auto frames() const -> int { return samples / stride; }
+    auto coarseOffsets() const -> int { return (offsets + CoarseStep - 1) / CoarseStep; }
+    auto update() -> void
+    {
+        fft = false;
+        if (offsets > 1 && samples > 0) {
+            const auto &spectrum = coarse ? decimated : full;
+            const int refine = coarse ? 2 * CoarseStep : 0;
+            const int directs = coarse ? offsets / CoarseStep + refine : offsets;
+            fft = spectrum.size && (method == Fft || (method == Auto
+                && spectrum.cost(lanes) + double(refine) * samples < double(directs) * samples));
+        }
+    }
+    auto direct(const float *ref, const float *signal, int from, int to,
+                int step, float *max, int best) const -> int
+    {
+        for (int off = from; off < to; off += step) {
+            const float corr = dot(ref, signal + off * stride, samples);
+            if (corr > *max) {
+                *max = corr;
+                best = off;
+            }
+        }
+        return best;
+    }
+};
+
+AudioCorrelation::AudioCorrelation()
+    : d(new Data)
+{
+#ifdef SIMD_HAS_SSE2
+    d->dot = dot<Simd::Float4>;
+    d->lanes = Simd::Float4::N;
+#else
+    d->dot = dot<Simd::Float1>;
+#endif
+#ifdef SIMD_HAS_AVX2
+    if (Simd::isa() == Simd::Avx2) {
+        d->dot = dotAvx2;
+        d->lanes = Simd::Float8::N;
+    }
+#endif
+}
+
+AudioCorrelation::~AudioCorrelation()
+{
+    delete d;
+}
+
+auto AudioCorrelation::setup(int samples, int offsets, int stride) -> void
+{
+    d->samples = samples;
+    d->offsets = offsets;
+    d->stride = stride;
+    // both are allocated here so that toggling coarse never allocates
+    const bool search = offsets > 1 && samples > 0;
+    const int frames = d->frames() / CoarseStep;
+    d->full.allocate(search ? samples + (offsets - 1) * stride : 0);
+    d->decimated.allocate(search && frames > 0 ? (frames + d->coarseOffsets() - 1) * stride : 0);
+    d->update();
+}
+
+auto AudioCorrelation::setMethod(Method method) -> void
+{
+    if (_Change(d->method, method))
+        d->update();
+}
+
+auto AudioCorrelation::method() const -> Method
+{
+    return d->fft ? Fft : Direct;
+}
+
+auto AudioCorrelation::setCoarse(bool coarse) -> void
+{
+    if (_Change(d->coarse, coarse))
+        d->update();
+}
+
+auto AudioCorrelation::isCoarse() const -> bool
+{
+    return d->coarse;
+}
+
+auto AudioCorrelation::search(const float *ref, const float *signal) -> int
+{
+    if (d->offsets <= 1 || d->samples <= 0)
+        return 0;
+    if (d->fft && !d->coarse)
+        return d->full.correlate(ref, signal, d->frames(), d->offsets, d->stride, 1);
+    float max = -_Max<float>();
+    if (!d->coarse)
+        return d->direct(ref, signal, 0, d->offsets, 1, &max, 0);
+    int best = 0;
+    if (d->fft) {
+        best = d->decimated.correlate(ref, signal, d->frames() / CoarseStep,
+                                      d->coarseOffsets(), d->stride, CoarseStep) * CoarseStep;
+        max = d->dot(ref, signal + best * d->stride, d->samples);
+    } else
+        best = d->direct(ref, signal, 0, d->offsets, CoarseStep, &max, 0);
+    const int from = qMax(0, best - CoarseStep + 1);
+    const int to = qMin(d->offsets, best + CoarseStep);
+    return d->direct(ref, signal, from, to, 1, &max, best);
+}
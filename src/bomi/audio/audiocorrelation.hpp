@@ -0,0 +1,28 @@
+#ifndef AUDIOCORRELATION_HPP
+#define AUDIOCORRELATION_HPP
+
+// finds offset of signal which correlates best with reference
+// offsets are in units of stride samples, i.e., frames of interleaved audio.
+// direct products are vectorized and FFT is used for long search windows.
+
+class AudioCorrelation {
+public:
+    enum Method { Auto, Direct, Fft };
+    AudioCorrelation();
+    ~AudioCorrelation();
+    // ref has samples and signal has samples + (offsets - 1) * stride
+    auto setup(int samples, int offsets, int stride) -> void;
+    auto setMethod(Method method) -> void;
+    // Direct or Fft chosen for current setup
+    auto method() const -> Method;
+    // search every step offsets first and refine around the best;
+    // FFT correlates every step-th frame for the first pass
+    auto setCoarse(bool coarse) -> void;
+    auto isCoarse() const -> bool;
+    auto search(const float *ref, const float *signal) -> int;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // AUDIOCORRELATION_HPP
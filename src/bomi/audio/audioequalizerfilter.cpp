@@ -0,0 +1,203 @@
+#include "audioequalizerfilter.hpp"
+#include "audioequalizer.hpp"
+#include "misc/simd.hpp"
+
+static constexpr int Bands = AudioEqualizer::bands();
+
+// Every band is a band-pass biquad fed by the same input and the output is
+// the input plus sum of band outputs weighted by gain. Bands and channels do
+// not depend on each other, so the bank runs in lanes of (band, channel):
+// channels are padded to P lanes (power of 2) and each row of W lanes holds
+// W/P bands. Only bands with nonzero gain take lanes.
+
+struct AudioEqualizerFilter::Data {
+    AudioBufferFormat format;
+    AudioEqualizer eq;
+    struct { float a = 0, b = 0, c = 0, amp = 0; } coefs[Bands];
+    // history per band/channel which survives rearrangement of lanes
+    float x[MP_NUM_CHANNELS][2], y[Bands][MP_NUM_CHANNELS][2];
+
+    int N = 1, P = 1, W = 1, lanes = 0;
+    std::vector<int> bands;
+    std::vector<float> a, b, c, amp, y1, y2; // per lane
+    std::vector<float> x1, x2, xp, acc;      // per row
+
+    auto (Data::*process)(float *p, int frames) -> void = nullptr;
+
+    template<class F>
+    auto run(float *p, int frames) -> void;
+#ifdef SIMD_HAS_AVX2
+    SIMD_AVX2_ENTRY auto runAvx2(float *p, int frames) -> void
+        { run<Simd::Float8>(p, frames); }
+#endif
+    auto lane(int i, int ch) const -> int
+        { const int g = W / P; return (i / g) * W + (i % g) * P + ch; }
+    auto save() -> void
+    {
+        memset(y, 0, sizeof(y));
+        if (x1.empty())
+            return;
+        for (int ch = 0; ch < format.channels().num; ++ch) {
+            x[ch][0] = x1[ch];
+            x[ch][1] = x2[ch];
+            for (int i = 0; i < (int)bands.size(); ++i) {
+                y[bands[i]][ch][0] = y1[lane(i, ch)];
+                y[bands[i]][ch][1] = y2[lane(i, ch)];
+            }
+        }
+    }
+    auto load() -> void
+    {
+        const int nch = format.channels().num;
+        bands.clear();
+        for (int i = 0; i < Bands; ++i) {
+            if (coefs[i].amp != 0.f && coefs[i].a != 0.f)
+                bands.push_back(i);
+        }
+        for (P = 1; P < nch; P <<= 1) ;
+        W = std::max(N, P);
+        const int groups = W / P;
+        lanes = (bands.size() + groups - 1) / groups * W;
+        for (auto v : { &a, &b, &c, &amp, &y1, &y2 })
+            v->assign(lanes, 0.f);
+        for (auto v : { &x1, &x2, &xp, &acc })
+            v->assign(W, 0.f);
+        for (int j = 0; j < W; ++j) {
+            const int ch = j % P;
+            if (ch < nch) {
+                x1[j] = x[ch][0];
+                x2[j] = x[ch][1];
+            }
+        }
+        for (int i = 0; i < (int)bands.size(); ++i) {
+            const auto &coef = coefs[bands[i]];
+            for (int ch = 0; ch < nch; ++ch) {
+                const int l = lane(i, ch);
+                a[l] = coef.a; b[l] = coef.b; c[l] = coef.c; amp[l] = coef.amp;
+                y1[l] = y[bands[i]][ch][0];
+                y2[l] = y[bands[i]][ch][1];
+            }
+        }
+    }
+};
+
+template<class F>
+auto AudioEqualizerFilter::Data::run(float *p, int frames) -> void
+{
+    const int nch = format.channels().num, groups = W / P;
+    const float *const pa = a.data(), *const pb = b.data();
+    const float *const pc = c.data(), *const pamp = amp.data();
+    float *const py1 = y1.data(), *const py2 = y2.data(), *const pacc = acc.data();
+    for (int i = 0; i < frames; ++i, p += nch) {
+        float *const px = xp.data(), *const px2 = x2.data();
+        for (int j = 0; j < W; ++j) {
+            const int ch = j & (P - 1);
+            px[j] = ch < nch ? p[ch] : 0.f;
+            pacc[j] = 0.f;
+        }
+        for (int l = 0; l < lanes; l += F::N) {
+            const int o = l & (W - 1);
+            const auto dx = F::sub(F::load(px + o), F::load(px2 + o));
+            const auto last = F::load(py1 + l);
+            const auto ax = F::mul(F::load(pa + l), dx);
+            const auto by = F::mul(F::load(pb + l), last);
+            const auto out = F::add(F::add(ax, by), F::mul(F::load(pc + l), F::load(py2 + l)));
+            F::store(py2 + l, last);
+            F::store(py1 + l, out);
+            F::store(pacc + o, F::madd(F::load(pamp + l), out, F::load(pacc + o)));
+        }
+        x2.swap(x1);
+        x1.swap(xp);
+        for (int ch = 0; ch < nch; ++ch) {
+            float v = p[ch];
+            for (int g = 0; g < groups; ++g)
+                v += pacc[g * P + ch];
+            p[ch] = v;
+        }
+    }
+}
+
+AudioEqualizerFilter::AudioEqualizerFilter()
+    : d(new Data)
+{
+#ifdef SIMD_HAS_SSE2
+    d->process = &Data::run<Simd::Float4>;
+    d->N = Simd::Float4::N;
+#else
+    d->process = &Data::run<Simd::Float1>;
+    d->N = Simd::Float1::N;
+#endif
+#ifdef SIMD_HAS_AVX2
+    if (Simd::isa() == Simd::Avx2) {
+        d->process = &Data::runAvx2;
+        d->N = Simd::Float8::N;
+    }
+#endif
+    reset();
+}
+
+AudioEqualizerFilter::~AudioEqualizerFilter()
+{
+    delete d;
+}
+
+auto AudioEqualizerFilter::delay() const -> double
+{
+    // follow the estimation in af_equalizer.c of mpv
+    return d->bands.empty() ? 0.0 : 2.0 / d->format.fps();
+}
+
+auto AudioEqualizerFilter::reset() -> void
+{
+    memset(d->x, 0, sizeof(d->x));
+    memset(d->y, 0, sizeof(d->y));
+    d->x1.clear();
+    d->load();
+}
+
+auto AudioEqualizerFilter::setEqualizer(const AudioEqualizer &eq) -> void
+{
+    d->eq = eq;
+    d->save();
+    for (int i = 0; i < eq.size(); ++i) {
+        const auto db = qBound(eq.min(), eq[i], eq.max());
+        d->coefs[i].amp = std::pow(10., db / 20.) - 1.;
+    }
+    d->load();
+}
+
+auto AudioEqualizerFilter::setFormat(const AudioBufferFormat &format) -> void
+{
+    if (!_Change(d->format, format))
+        return;
+    const float fps = format.fps();
+    const float f_max = 0.5f * fps;
+    const float w_band = 1; // bandwidth in octave
+    for (int i = 0; i < Bands; ++i) {
+        const float f_center = AudioEqualizer::freqeuncy(i);
+        auto &c = d->coefs[i];
+        if (f_center < f_max) {
+            const float theta = 2.0f * M_PI * f_center / fps;
+            const float alpha = sin(theta) * sinh(log(2.0)*0.5 * w_band * theta/sin(theta));
+            c.a = alpha / (alpha + 1.f);
+            c.b = 2.0 * cos(theta) / (alpha + 1.f);
+            c.c = (alpha - 1.f) / (alpha + 1.f);
+        } else
+            c.a = c.b = c.c = 0.f;
+    }
+    reset();
+}
+
+auto AudioEqualizerFilter::passthrough(const AudioBufferPtr &in) const -> bool
+{
+    return d->bands.empty() || in->isEmpty();
+}
+
+auto AudioEqualizerFilter::run(AudioBufferPtr &in) -> AudioBufferPtr
+{
+    if (!passthrough(in)) {
+        auto view = in->view<float>();
+        (d->*d->process)(view.plane(), in->frames());
+    }
+    return in;
+}
@@ -0,0 +1,23 @@
+#ifndef AUDIOEQUALIZERFILTER_HPP
+#define AUDIOEQUALIZERFILTER_HPP
+
+#include "audiofilter.hpp"
+
+class AudioEqualizer;
+
+class AudioEqualizerFilter : public AudioFilter {
+public:
+    AudioEqualizerFilter();
+    ~AudioEqualizerFilter();
+    auto setFormat(const AudioBufferFormat &format) -> void;
+    auto setEqualizer(const AudioEqualizer &eq) -> void;
+    auto delay() const -> double override;
+    auto reset() -> void override;
+    auto run(AudioBufferPtr &in) -> AudioBufferPtr override;
+    auto passthrough(const AudioBufferPtr &in) const -> bool override;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // AUDIOEQUALIZERFILTER_HPP
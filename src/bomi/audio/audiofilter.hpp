@@ -7,16 +7,16 @@ class AudioFilter {
 public:
     AudioFilter() { }
     virtual ~AudioFilter() { }
-    auto setPool(mp_audio_pool *pool) -> void { m_pool = pool; }
+    auto setArena(AudioBufferArena *arena) -> void { m_arena = arena; }
     auto newBuffer(const AudioBufferFormat &format, int frames) const -> AudioBufferPtr
-    { return AudioBuffer::fromMpAudio(mp_audio_pool_get(m_pool, &format.mpAudio(), frames)); }
+    { return m_arena->get(format, frames); }
     virtual auto setScale(double scale) -> void;
     virtual auto reset() -> void;
     virtual auto delay() const -> double;
     virtual auto passthrough(const AudioBufferPtr &in) const -> bool = 0;
     virtual auto run(AudioBufferPtr &in) -> AudioBufferPtr = 0;
 private:
-    mp_audio_pool *m_pool = nullptr;
+    AudioBufferArena *m_arena = nullptr;
 };
 
 #endif // AUDIOFILTER_HPP
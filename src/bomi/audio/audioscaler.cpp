@@ -1,9 +1,61 @@
 #include "audioscaler.hpp"
+#include "misc/simd.hpp"
 
 static constexpr const double m_ms_stride = 60.0;
 static constexpr const double m_percent_overlap = 0.20;
 static constexpr const double m_ms_search = 14.0;
 
+// dst = o - b * (o - q)
+template<class F>
+static auto blend(float *dst, const float *o, const float *b, const float *q, int n) -> void
+{
+    Simd::forEach<F>(n, [&] (auto f, int i) {
+        using S = decltype(f);
+        const auto v = S::load(o + i);
+        S::store(dst + i, S::sub(v, S::mul(S::load(b + i), S::sub(v, S::load(q + i)))));
+    });
+}
+
+template<class F>
+static auto multiply(float *dst, const float *a, const float *b, int n) -> void
+{
+    Simd::forEach<F>(n, [&] (auto f, int i) {
+        using S = decltype(f);
+        S::store(dst + i, S::mul(S::load(a + i), S::load(b + i)));
+    });
+}
+
+#ifdef SIMD_HAS_AVX2
+SIMD_AVX2_ENTRY static auto blendAvx2(float *dst, const float *o, const float *b,
+                                      const float *q, int n) -> void
+    { blend<Simd::Float8>(dst, o, b, q, n); }
+SIMD_AVX2_ENTRY static auto multiplyAvx2(float *dst, const float *a, const float *b,
+                                         int n) -> void
+    { multiply<Simd::Float8>(dst, a, b, n); }
+#endif
+
+struct Kernels {
+    auto (*blend)(float *dst, const float *o, const float *b, const float *q, int n) -> void;
+    auto (*multiply)(float *dst, const float *a, const float *b, int n) -> void;
+};
+
+static auto kernels() -> const Kernels&
+{
+    static const Kernels k = [] () {
+#ifdef SIMD_HAS_SSE2
+        Kernels k = { blend<Simd::Float4>, multiply<Simd::Float4> };
+#else
+        Kernels k = { blend<Simd::Float1>, multiply<Simd::Float1> };
+#endif
+#ifdef SIMD_HAS_AVX2
+        if (Simd::isa() == Simd::Avx2)
+            k = { blendAvx2, multiplyAvx2 };
+#endif
+        return k;
+    }();
+    return k;
+}
+
 auto AudioScaler::expand(Vector &vec, int frames) -> void
 {
     if ((int)vec.buffer.size() < f2s(frames))
@@ -31,6 +83,7 @@ auto AudioScaler::setFormat(const AudioBufferFormat &format) -> void
     m_frames_search = 0;
     if (m_overlap.frames > 1)
         m_frames_search = frames_per_ms * m_ms_search;
+    m_correlation.setup(f2s(m_overlap.frames - 1), m_frames_search, f2s(1));
     m_frames_standing = m_frames_stride - m_overlap.frames;
     if (m_overlap.isEmpty())
         return;
@@ -110,13 +163,9 @@ auto AudioScaler::run(AudioBufferPtr &in) -> AudioBufferPtr
 
     auto output_overlap = [this, &dview](int pos, int frames_off) -> void
     {
-        const int samples = f2s(m_overlap.frames);
-        auto dit = dview.begin() + f2s(pos);
-        auto bit = _C(m_table_blend).data();
-        auto oit = _C(m_overlap).data();
-        auto qit = _C(m_queue).data() + f2s(frames_off);
-        for (int i = 0; i < samples; ++i, ++oit)
-            *dit++ = *oit - (*bit++ * (*oit - *qit++));
+        kernels().blend(dview.begin() + f2s(pos), _C(m_overlap).data(),
+                        _C(m_table_blend).data(), _C(m_queue).data() + f2s(frames_off),
+                        f2s(m_overlap.frames));
     };
 
     while (m_frames_queued >= m_queue.frames) {
@@ -161,29 +210,9 @@ auto AudioScaler::setScale(double scale) -> void
 
 auto AudioScaler::best_overlap_frames_offset() -> int
 {
-    const int samples = f2s(m_overlap.frames - 1);
-    {
-        auto cit = m_buf_pre_corr.data();
-        auto wit = m_table_window.data();
-        auto oit = m_overlap.data() + f2s(1);
-        for (int i = 0; i < samples; ++i)
-            *cit++ = *wit++ * *oit++;
-    }
-
-    int best_off = 0;
-    float best_corr = _Min<qint64>(), corr;
-    for (int off = 0; off < m_frames_search; ++off) {
-        corr = 0;
-        auto cit = _C(m_buf_pre_corr).data();
-        auto qit = _C(m_queue).data() + f2s(1 + off);
-        for (int i = 0; i < samples; ++i)
-            corr += *cit++ * *qit++;
-        if (corr > best_corr) {
-            best_corr = corr;
-            best_off  = off;
-        }
-    }
-    return best_off;
+    kernels().multiply(m_buf_pre_corr.data(), _C(m_table_window).data(),
+                       _C(m_overlap).data() + f2s(1), f2s(m_overlap.frames - 1));
+    return m_correlation.search(_C(m_buf_pre_corr).data(), _C(m_queue).data() + f2s(1));
 }
 
 auto AudioScaler::reset() -> void
@@ -2,6 +2,7 @@
 #define AUDIOSCALER_HPP
 
 #include "audiofilter.hpp"
+#include "audiocorrelation.hpp"
 
 class AudioScaler : public AudioFilter {
 public:
@@ -10,6 +11,7 @@ public:
     auto setFormat(const AudioBufferFormat &format) -> void;
     auto delay() const -> double override { return m_delay; }
     auto setScale(double scale) -> void final;
+    auto setCoarseSearch(bool coarse) -> void { m_correlation.setCoarse(coarse); }
     auto run(AudioBufferPtr &in) -> AudioBufferPtr override;
     auto reset() -> void override;
     auto passthrough(const AudioBufferPtr &in) const -> bool override;
@@ -34,6 +36,7 @@ private:
     int m_frames_search = 0, m_frames_standing = 0, m_frames_to_slide = 0;
     Vector m_table_blend, m_table_window;
     Vector m_buf_pre_corr, m_queue, m_overlap;
+    AudioCorrelation m_correlation;
     double m_delay = 0.0, m_scale = 1.0;
 };
 
@@ -1,200 +1,344 @@
 #include "visualizer.hpp"
 #include "opengl/opengltexture2d.hpp"
 #include "audiobuffer.hpp"
+#include "misc/spscring.hpp"
 #include "kiss_fft/tools/kiss_fftr.h"
+#include <QElapsedTimer>
 #include <complex>
 
 static const QEvent::Type UpdateData = QEvent::Type(QEvent::User + 1);
+static constexpr int UpdateInterval = 1000 / 60; // msec
+static constexpr int MinBins = 64, MaxBins = 32768;
+
+// af thread only copies interleaved samples into a lock-free ring and the
+// worker wakes up at every UpdateInterval to downmix them into the history.
+// Then, windowed FFT runs over the latest history so that successive
+// transforms overlap, and bins are aggregated into the bands of display.
 
 class FFT {
 public:
-    FFT() { setInputSize(10); }
     ~FFT() { kiss_fftr_free(m_kiss); }
-    auto push(const AudioBufferPtr &input) -> bool
-    {
-        if (m_pos < m_size_in) {
-            if (!input || input->isEmpty())
-                return false;
-            m_nq = input->fps() / 2;
-            auto view = input->constView<float>();
-            const float *p = view.plane();
-            const int frames = input->frames();
-            const int nch = input->channels();
-            auto dst = m_input.data() + m_pos;
-            for (int i = 0; i < frames && m_pos < m_size_in; ++i, ++m_pos) {
-                float mix = 0;
-                for (int c = 0; c < nch; ++c) {
-                    mix += *p++;
-                }
-                mix /= nch;
-                *dst++ = mix;
-            }
-        }
-        return m_pos >= m_size_in;
-    }
-    auto run() -> void { kiss_fftr(m_kiss, m_input.data(), (kiss_fft_cpx*)m_output.data()); clear(); }
-    auto output() -> const std::vector<std::complex<float>>& { return m_output; }
-    auto inputSize() const -> int { return m_size_in; }
-    auto setInputSize(int size) -> void
+    // returns true if history should be cleared
+    auto setup(int bins, AudioVisualizer::Window window) -> bool
     {
         static_assert(sizeof(std::complex<float>) == sizeof(kiss_fft_cpx), "!!!");
-        size = kiss_fftr_next_fast_size_real(size);
-        if (size != (int)m_input.size()) {
+        const int size = kiss_fftr_next_fast_size_real(bins * 2);
+        const bool resized = size != (int)m_input.size();
+        if (resized) {
             m_input.resize(size);
-            m_size_in = size;
-            m_output.resize(m_size_in / 2 + 1);
+            m_output.resize(size / 2 + 1);
+            m_magnitude.resize(size / 2 + 1);
             kiss_fftr_free(m_kiss);
-            m_kiss = kiss_fftr_alloc(m_size_in, false, nullptr, nullptr);
+            m_kiss = kiss_fftr_alloc(size, false, nullptr, nullptr);
         }
-        clear();
+        if (resized || _Change(m_type, window)) {
+            m_type = window;
+            m_window.resize(size);
+            double sum = 0.0;
+            for (int i = 0; i < size; ++i) {
+                const double x = 2.0 * M_PI * i / size;
+                if (window == AudioVisualizer::Blackman)
+                    m_window[i] = 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2.0 * x);
+                else
+                    m_window[i] = 0.5 - 0.5 * std::cos(x);
+                sum += m_window[i];
+            }
+            // full scale sine gives 1.0
+            m_scale = 2.0 / sum;
+        }
+        return resized;
+    }
+    auto size() const -> int { return m_input.size(); }
+    // history is circular and pos is the index of oldest sample
+    auto run(const float *history, int pos) -> const std::vector<float>&
+    {
+        const int size = m_input.size(), first = size - pos;
+        const float *w = m_window.data();
+        float *in = m_input.data();
+        for (int i = 0; i < first; ++i)
+            in[i] = history[pos + i] * w[i];
+        for (int i = first; i < size; ++i)
+            in[i] = history[i - first] * w[i];
+        kiss_fftr(m_kiss, in, (kiss_fft_cpx*)m_output.data());
+        for (int i = 0; i < (int)m_output.size(); ++i)
+            m_magnitude[i] = std::abs(m_output[i]) * m_scale;
+        return m_magnitude;
     }
-    auto clear() -> void { m_pos = 0; }
 private:
     kiss_fftr_cfg m_kiss = nullptr;
-    int m_size_in = 0, m_pos = 0;
-    double m_nq = 20000;
-    std::vector<float> m_input;
+    AudioVisualizer::Window m_type = AudioVisualizer::Hann;
+    float m_scale = 1.0f;
+    std::vector<float> m_input, m_window, m_magnitude;
     std::vector<std::complex<float>> m_output;
 };
 
 /******************************************************************************/
 
-struct AudioVisualizer::Data {
-    QList<qreal> data, interm, back;
+struct VisualizerOption {
+    int count = 5, bins = 2048;
     qreal min = 20, max = 20000;
+    AudioVisualizer::Scale xs = AudioVisualizer::Log;
+    AudioVisualizer::Scale ys = AudioVisualizer::Log;
+    AudioVisualizer::Window window = AudioVisualizer::Hann;
+};
+
+struct AudioVisualizer::Data {
+    class Thread : public QThread {
+    public:
+        Thread(Data *d): d(d) { }
+        auto finish() -> void;
+    private:
+        auto run() -> void final;
+        Data *d;
+    };
+    // bins in [from, to] belong to a band or interpolated at pos if empty
+    struct Band { int from, to; double pos; };
+    // states only for worker
+    struct Worker {
+        int format = 0, fps = 0, size = 0, pos = 0, fresh = 0;
+        double minLv = _Max<double>(), maxLv = 0;
+        qreal min = 0, max = 0;
+        Scale xs = Log, ys = Log;
+        FFT fft;
+        std::vector<float> buffer, history;
+        std::vector<Band> bands;
+        QList<qreal> back;
+    };
+    auto process(Worker &w, const VisualizerOption &option) -> bool;
+
+    AudioVisualizer *p = nullptr;
+    QList<qreal> data, interm;
     bool active = false, enabled = false;
-    int fps = 0, count = 0;
-    double minLv = _Max<double>(), maxLv = 0;
     Type type = None;
+    // for GUI and worker thread
     QMutex mutex;
-    FFT fft;
-    AudioVisualizer::Scale xs = AudioVisualizer::Log;
-    AudioVisualizer::Scale ys = AudioVisualizer::Log, tys = ys;
+    QWaitCondition wait;
+    VisualizerOption option;
+    bool quit = false;
+    template<class T>
+    auto set(T &t, const T &v) -> bool
+        { QMutexLocker locker(&mutex); return _Change(t, v); }
+    // for af and worker thread
+    SpscRing<float> ring{1 << 18};
+    QAtomicInt format{0}, levelReset{0};
+    Thread thread{this};
 };
 
-AudioVisualizer::AudioVisualizer(QObject *item)
-    : QObject(item), d(new Data)
+auto AudioVisualizer::Data::Thread::finish() -> void
 {
-    setCount(5);
+    d->mutex.lock();
+    d->quit = true;
+    d->wait.wakeAll();
+    d->mutex.unlock();
+    if (!wait(5000))
+        terminate();
 }
 
-AudioVisualizer::~AudioVisualizer()
+auto AudioVisualizer::Data::Thread::run() -> void
 {
-    delete d;
+    Worker w;
+    w.buffer.resize(d->ring.capacity());
+    QElapsedTimer timer;
+    timer.start();
+    qint64 next = 0;
+    forever {
+        d->mutex.lock();
+        next += UpdateInterval;
+        const qint64 left = next - timer.elapsed();
+        if (left <= 0)
+            next = timer.elapsed();
+        else if (!d->quit)
+            d->wait.wait(&d->mutex, left);
+        if (d->quit) {
+            d->mutex.unlock();
+            break;
+        }
+        const auto option = d->option;
+        d->mutex.unlock();
+        if (d->process(w, option))
+            qApp->postEvent(d->p, new QEvent(UpdateData));
+    }
 }
 
-auto AudioVisualizer::reset() -> void
+auto AudioVisualizer::Data::process(Worker &w, const VisualizerOption &option) -> bool
 {
-    d->maxLv = 0.0;
-    d->minLv = _Max<double>();
-}
+    const int format = this->format.loadAcquire();
+    if (_Change(w.format, format)) {
+        ring.clear();
+        w.history.clear();
+        return false;
+    }
+    if (!format)
+        return false;
+    const int nch = format & 15, fps = format >> 4;
+    const int n = ring.pop(w.buffer.data(), w.buffer.size() / nch * nch);
+    // samples could be in new format
+    if (this->format.loadAcquire() != format)
+        return false;
 
-//        function i2f(i, fps, n) { return i * fps * 0.5 / (n - 1); }
-auto AudioVisualizer::analyze(const QSharedPointer<AudioBuffer> &data) -> void
-{
-    if (!d->enabled)
-        return;
-    Q_ASSERT(data);
-    if (_Change(d->fps, data->fps()))
-        d->fft.setInputSize(d->fps * 0.1);
-    if (!d->fft.push(data))
-        return;
-    d->fft.run();
-    auto &cpx = d->fft.output();
+    if (w.fft.setup(option.bins, option.window) || w.history.empty()) {
+        w.history.assign(w.fft.size(), 0.f);
+        w.pos = w.fresh = 0;
+    }
+    const int size = w.history.size();
+    const float *src = w.buffer.data();
+    for (int i = 0; i < n; i += nch) {
+        float mix = 0;
+        for (int c = 0; c < nch; ++c)
+            mix += *src++;
+        w.history[w.pos] = mix / nch;
+        if (++w.pos >= size)
+            w.pos = 0;
+    }
+    w.fresh += n / nch;
+    if (!w.fresh)
+        return false;
+    w.fresh = 0;
+    const auto &mag = w.fft.run(w.history.data(), w.pos);
 
-    const int c = d->count;
-    if (d->back.size() != c) {
-        d->back.clear(); d->back.reserve(c);
+    const int c = std::max(1, option.count);
+    if ((w.bands.size() != (size_t)c) | _Change(w.fps, fps) | _Change(w.min, option.min)
+            | _Change(w.max, option.max) | _Change(w.xs, option.xs) | _Change(w.size, size)) {
+        // edges are the midpoints between centers on the scale of x
+        const double df = fps / (double)size, last = mag.size() - 1;
+        const double lmin = std::log(option.min), lmax = std::log(option.max);
+        auto freq = [&] (double i) {
+            const double r = c > 1 ? i / (c - 1) : 0.0;
+            return option.xs != Log ? option.min + (option.max - option.min) * r
+                                    : std::exp(lmin + (lmax - lmin) * r);
+        };
+        w.bands.resize(c);
+        for (int i = 0; i < c; ++i) {
+            auto &band = w.bands[i];
+            band.from = (int)qBound(0.0, std::ceil(freq(i - 0.5) / df), last);
+            band.to = (int)qBound(0.0, std::floor(freq(i + 0.5) / df), last);
+            band.pos = qBound(0.0, freq(i) / df, last);
+        }
+    }
+    // back is swapped with the list of GUI
+    if (w.back.size() != c) {
+        w.back.clear();
+        w.back.reserve(c);
         for (int i = 0; i < c; ++i)
-            d->back.push_back(0.0);
+            w.back.push_back(0.0);
     }
-    const auto nq = d->fps * 0.5;
-    auto get = [&] (double i) -> double {
-        const int left = i;
-        const int right = left + 1;
-        if (left < 0 || right >= (int)cpx.size())
-            return 0.0;
-        const float a = i - (double)left;
-        return std::abs(cpx.at(left)) * (1.0f - a) + a * std::abs(cpx.at(right));
-    };
 
-    constexpr int radius = 3;
-    static const auto gw = Gaussian::create(radius);
-
-    if (_Change(d->tys, d->ys))
-        reset();
-
-    double &min = d->minLv, &max = d->maxLv;
+    if (levelReset.fetchAndStoreRelaxed(0) | _Change(w.ys, option.ys)) {
+        w.maxLv = 0.0;
+        w.minLv = _Max<double>();
+    }
+    double &min = w.minLv, &max = w.maxLv;
     for (int i = 0; i < c; ++i) {
-        const auto f = d->xs != Log ? d->min + (d->max - d->min) * i / (c - 1)
-            : std::exp(std::log(d->min) + (std::log(d->max) - std::log(d->min)) * i / (c - 1));
-        const double idx = f * (cpx.size() - 1) / nq;
+        const auto &band = w.bands[i];
         double lv = 0.0;
-        int g = 0;
-        for (int j = -radius; j <= radius; ++j, ++g)
-            lv += get(idx + j) * gw[g];
-        if (lv < 1e-4)
+        if (band.from <= band.to) {
+            for (int j = band.from; j <= band.to; ++j)
+                lv += mag[j] * mag[j];
+            lv = std::sqrt(lv);
+        } else {
+            const int left = band.pos, right = std::min(left + 1, (int)mag.size() - 1);
+            const double a = band.pos - left;
+            lv = mag[left] * (1.0 - a) + mag[right] * a;
+        }
+        if (lv < 1e-5)
             lv = 0.0;
         else {
-            if (d->tys == Log)
+            if (w.ys == Log)
                 lv = std::log(lv);
             min = std::min(lv, min);
             max = std::max(lv, max);
         }
-        d->back[i] = lv;
+        w.back[i] = lv;
     }
-    if (d->tys != Log)
+    if (w.ys != Log)
         min = 0;
     if (min != max) {
-        for (auto &v : d->back) {
+        for (auto &v : w.back) {
             if (v != 0.0)
                 v = (v - min) / (max - min);
         }
     }
 
-    d->mutex.lock();
-    d->back.swap(d->interm);
-    d->mutex.unlock();
-    qApp->postEvent(this, new QEvent(UpdateData));
+    mutex.lock();
+    w.back.swap(interm);
+    mutex.unlock();
+    return true;
+}
+
+AudioVisualizer::AudioVisualizer(QObject *item)
+    : QObject(item), d(new Data)
+{
+    d->p = this;
+}
+
+AudioVisualizer::~AudioVisualizer()
+{
+    d->thread.finish();
+    delete d;
+}
+
+auto AudioVisualizer::reset() -> void
+{
+    d->levelReset.store(1);
+}
+
+auto AudioVisualizer::analyze(const AudioBufferPtr &data) -> void
+{
+    if (!d->enabled)
+        return;
+    Q_ASSERT(data);
+    if (data->isEmpty())
+        return;
+    const int format = data->fps() << 4 | data->channels();
+    if (d->format.load() != format)
+        d->format.storeRelease(format);
+    // drop if worker falls behind
+    d->ring.push(data->constView<float>().plane(), data->samples());
 }
 
 auto AudioVisualizer::min() const -> qreal
 {
-    return d->min;
+    return d->option.min;
 }
 
 auto AudioVisualizer::max() const -> qreal
 {
-    return d->max;
+    return d->option.max;
 }
 
 auto AudioVisualizer::setMin(qreal min) -> void
 {
-    if (_Change(d->min, min))
+    if (d->set(d->option.min, min))
         emit minChanged();
 }
 
 auto AudioVisualizer::setMax(qreal max) -> void
 {
-    if (_Change(d->max, max))
+    if (d->set(d->option.max, max))
         emit maxChanged();
 }
 
 auto AudioVisualizer::count() const -> int
 {
-    return d->count;
+    return d->option.count;
 }
 
 auto AudioVisualizer::setCount(int count) -> void
 {
-    if (_Change(d->count, count))
+    if (d->set(d->option.count, count))
         emit countChanged();
 }
 
 auto AudioVisualizer::setEnabled(bool enabled) -> void
 {
-    if (_Change(d->enabled, enabled))
+    if (_Change(d->enabled, enabled)) {
+        if (enabled) {
+            d->quit = false;
+            d->thread.start();
+        } else
+            d->thread.finish();
         emit enabledChanged();
+    }
 }
 
 auto AudioVisualizer::isEnabled() const -> bool
@@ -232,24 +376,24 @@ auto AudioVisualizer::customEvent(QEvent *e) -> void
 
 auto AudioVisualizer::setXScale(Scale scale) -> void
 {
-    if (_Change(d->xs, scale))
+    if (d->set(d->option.xs, scale))
         emit xScaleChanged();
 }
 
 auto AudioVisualizer::xScale() const -> Scale
 {
-    return d->xs;
+    return d->option.xs;
 }
 
 auto AudioVisualizer::setYScale(Scale scale) -> void
 {
-    if (_Change(d->ys, scale))
+    if (d->set(d->option.ys, scale))
         emit yScaleChanged();
 }
 
 auto AudioVisualizer::yScale() const -> Scale
 {
-    return d->ys;
+    return d->option.ys;
 }
 
 auto AudioVisualizer::type() const -> Type
@@ -264,3 +408,25 @@ auto AudioVisualizer::setType(Visualization type) -> void
         setEnabled(d->active && d->type);
     }
 }
+
+auto AudioVisualizer::window() const -> Window
+{
+    return d->option.window;
+}
+
+auto AudioVisualizer::setWindow(Window window) -> void
+{
+    if (d->set(d->option.window, window))
+        emit windowChanged();
+}
+
+auto AudioVisualizer::bins() const -> int
+{
+    return d->option.bins;
+}
+
+auto AudioVisualizer::setBins(int bins) -> void
+{
+    if (d->set(d->option.bins, qBound(MinBins, bins, MaxBins)))
+        emit binsChanged();
+}
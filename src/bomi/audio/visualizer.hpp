@@ -4,7 +4,7 @@
 #include "quick/simpletextureitem.hpp"
 #include "enum/visualization.hpp"
 
-class AudioBuffer;
+class AudioBufferPtr;
 
 class AudioVisualizer : public QObject {
     Q_OBJECT
@@ -17,10 +17,14 @@ class AudioVisualizer : public QObject {
     Q_PROPERTY(Scale xScale READ xScale WRITE setXScale NOTIFY xScaleChanged)
     Q_PROPERTY(Scale yScale READ yScale WRITE setYScale NOTIFY yScaleChanged)
     Q_PROPERTY(Type type READ type NOTIFY typeChanged)
+    Q_PROPERTY(Window window READ window WRITE setWindow NOTIFY windowChanged)
+    Q_PROPERTY(int bins READ bins WRITE setBins NOTIFY binsChanged)
     Q_ENUMS(Scale)
     Q_ENUMS(Type)
+    Q_ENUMS(Window)
 public:
     enum Scale { Log, Linear };
+    enum Window { Hann, Blackman };
     enum Type {
         None = (int)Visualization::Off,
         Bar = (int)Visualization::Bar
@@ -43,8 +47,13 @@ public:
     auto setYScale(Scale scale) -> void;
     auto setType(Visualization type) -> void;
     auto type() const -> Type;
+    auto window() const -> Window;
+    auto setWindow(Window window) -> void;
+    // number of frequency bins of FFT
+    auto bins() const -> int;
+    auto setBins(int bins) -> void;
     // in af thread
-    auto analyze(const QSharedPointer<AudioBuffer> &data) -> void;
+    auto analyze(const AudioBufferPtr &data) -> void;
     auto reset() -> void;
 signals:
     void audioChanged();
@@ -57,6 +66,8 @@ signals:
     void xScaleChanged();
     void yScaleChanged();
     void typeChanged();
+    void windowChanged();
+    void binsChanged();
 private:
     auto setEnabled(bool enabled) -> void;
     auto customEvent(QEvent *e) -> void final;
@@ -66,5 +77,6 @@ private:
 
 Q_DECLARE_METATYPE(AudioVisualizer::Scale)
 Q_DECLARE_METATYPE(AudioVisualizer::Type)
+Q_DECLARE_METATYPE(AudioVisualizer::Window)
 
 #endif // VISUALIZER_HPP
@@ -27,7 +27,7 @@ QMAKE_CXXFLAGS -= -g
 CONFIG -= debug
 CONFIG += release
 } else {
-QMAKE_CXXFLAGS += -Wno-non-template-friend
+QMAKE_CXXFLAGS += -Wno-non-template-friend -Wno-psabi
 }
 
 !isEmpty(USE_CCACHE): QMAKE_CXX = ccache $${QMAKE_CXX}
@@ -256,6 +256,15 @@ HEADERS += \
     video/interpolatorparams.hpp \
     video/videofilter.hpp \
     video/motioninterpolator.hpp \
+    video/motioncompensator.hpp \
+    video/scenescanner.hpp \
+    video/thumbnailcache.hpp \
+    video/snapshotreader.hpp \
+    video/frametimer.hpp \
+    video/hwdecdownloader.hpp \
+    subtitle/subtitleloader.hpp \
+    subtitle/subcompindex.hpp \
+    subtitle/shelfpacker.hpp \
     enum/processor.hpp \
     video/motionintrploption.hpp \
     enum/logoutput.hpp \
@@ -301,7 +310,14 @@ HEADERS += \
     dialog/encoderdialog.hpp \
     misc/filenamegenerator.hpp \
     enum/rotation.hpp \
-    player/videosettings.hpp
+    player/videosettings.hpp \
+    misc/simd.hpp \
+    audio/audioequalizerfilter.hpp \
+    misc/benchmark.hpp \
+    misc/triplebuffer.hpp \
+    misc/spscring.hpp \
+    misc/slicepool.hpp \
+    audio/audiocorrelation.hpp
 
 SOURCES += \
 	stdafx.cpp \
@@ -477,6 +493,15 @@ SOURCES += \
     video/interpolatorparams.cpp \
     video/videofilter.cpp \
     video/motioninterpolator.cpp \
+    video/motioncompensator.cpp \
+    video/scenescanner.cpp \
+    video/thumbnailcache.cpp \
+    video/snapshotreader.cpp \
+    video/frametimer.cpp \
+    video/hwdecdownloader.cpp \
+    subtitle/subtitleloader.cpp \
+    subtitle/subcompindex.cpp \
+    subtitle/shelfpacker.cpp \
     enum/processor.cpp \
     video/motionintrploption.cpp \
     enum/logoutput.cpp \
@@ -519,7 +544,15 @@ SOURCES += \
     dialog/encoderdialog.cpp \
     misc/filenamegenerator.cpp \
     enum/rotation.cpp \
-    player/videosettings.cpp
+    player/videosettings.cpp \
+    misc/simd.cpp \
+    misc/slicepool.cpp \
+    audio/audioequalizerfilter.cpp \
+    misc/benchmark.cpp \
+    audio/audiobenchmark.cpp \
+    video/videobenchmark.cpp \
+    subtitle/subtitlebenchmark.cpp \
+    audio/audiocorrelation.cpp
 
 TRANSLATIONS += translations/bomi_en.ts \
 	translations/bomi_ko.ts \
@@ -85,7 +85,10 @@ Item {
         Component {
             id: toolText
             PlayInfoText {
-                content: formatBracket(name, activationText(tool.state), Format.textNA(tool.driver))
+                readonly property string fps: tool.fps > 0 ? " " + tool.fps.toFixed(1) + "fps" : ""
+                readonly property string download: tool.copy > 0
+                    ? " copy " + tool.copy.toFixed(2) + "ms/wait " + tool.wait.toFixed(2) + "ms" : ""
+                content: formatBracket(name, activationText(tool.state), Format.textNA(tool.driver) + fps + download)
             }
         }
         Loader {
@@ -0,0 +1,144 @@
+#include "benchmark.hpp"
+#include "simd.hpp"
+
+auto benchmarkAudioConverter() -> void;
+auto benchmarkAudioScaler() -> void;
+auto benchmarkAudioChain() -> void;
+auto benchmarkBobDeinterlacer() -> void;
+auto benchmarkFilterGraph() -> void;
+auto benchmarkHwDecDownload() -> void;
+auto benchmarkVideoChain() -> void;
+auto benchmarkSubtitleShadow() -> void;
+auto benchmarkSubtitleIndex() -> void;
+
+static const struct {
+    const char *name;
+    auto (*run)() -> void;
+} s_suites[] = {
+    { "audio-converter", benchmarkAudioConverter },
+    { "audio-scaler", benchmarkAudioScaler },
+    { "audio-chain", benchmarkAudioChain },
+    { "video-bob", benchmarkBobDeinterlacer },
+    { "video-filtergraph", benchmarkFilterGraph },
+    { "video-hwdec", benchmarkHwDecDownload },
+    { "video-chain", benchmarkVideoChain },
+    { "subtitle-shadow", benchmarkSubtitleShadow },
+    { "subtitle-index", benchmarkSubtitleIndex }
+};
+
+static int s_mismatches = 0;
+
+static auto goldenPath() -> QString
+{
+    const auto path = QString::fromLocal8Bit(qgetenv("BOMI_BENCHMARK_GOLDEN"));
+    return path.isEmpty() ? u"benchmark-golden.json"_q : path;
+}
+
+static auto goldenKey(const QString &suite) -> QString
+{
+    return suite % '/'_q % _L(Simd::name(Simd::isa()));
+}
+
+static auto readGolden() -> QJsonObject
+{
+    QFile file(goldenPath());
+    if (!file.open(QFile::ReadOnly))
+        return QJsonObject();
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+Benchmark::Benchmark(const QString &suite)
+    : m_suite(suite)
+{
+    qDebug().nospace().noquote() << "[" << m_suite << "] "
+                                 << Simd::name(Simd::isa());
+    m_golden = readGolden()[goldenKey(m_suite)].toObject();
+}
+
+Benchmark::~Benchmark()
+{
+    if (!m_recorded)
+        return;
+    auto json = readGolden();
+    json[goldenKey(m_suite)] = m_golden;
+    QFile file(goldenPath());
+    if (file.open(QFile::WriteOnly | QFile::Truncate))
+        file.write(QJsonDocument(json).toJson());
+    else
+        qDebug().nospace().noquote() << "Cannot write " << goldenPath();
+}
+
+auto Benchmark::checksum(const void *data, int bytes, quint64 hash) -> quint64
+{
+    auto p = static_cast<const uchar*>(data);
+    for (int i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+auto Benchmark::check(const QString &name, quint64 checksum) -> bool
+{
+    const auto hex = QString::number(checksum, 16).rightJustified(16, '0'_q);
+    const auto golden = m_golden.value(name).toString();
+    QString result;
+    if (golden.isEmpty()) {
+        m_golden.insert(name, hex);
+        m_recorded = true;
+        result = u"recorded"_q;
+    } else if (golden != hex) {
+        ++s_mismatches;
+        result = "MISMATCH (golden: "_a % golden % ')'_q;
+    } else
+        result = u"ok"_q;
+    qDebug().nospace().noquote() << "  " << name.leftJustified(40) << " "
+                                 << hex << "  " << result;
+    return golden.isEmpty() || golden == hex;
+}
+
+auto Benchmark::report(const QString &name, double nsec, double units,
+                       const QString &unit) const -> void
+{
+    qDebug().nospace().noquote()
+            << "  " << name.leftJustified(40) << " "
+            << QString::number(nsec * 1e-3, 'f', 2).rightJustified(12) << " us  "
+            << QString::number(nsec / units, 'f', 3).rightJustified(10)
+            << " ns/" << unit;
+}
+
+auto Benchmark::reportRealtime(const QString &name, double nsec, double sec) const -> void
+{
+    qDebug().nospace().noquote()
+            << "  " << name.leftJustified(40) << " "
+            << QString::number(nsec * 1e-3, 'f', 2).rightJustified(12) << " us  "
+            << QString::number(sec * 1e9 / nsec, 'f', 1).rightJustified(10)
+            << " x realtime";
+}
+
+auto Benchmark::run(const QString &prefix) -> bool
+{
+    bool found = false;
+    s_mismatches = 0;
+    for (auto &suite : s_suites) {
+        if (QString(_L(suite.name)).startsWith(prefix)) {
+            suite.run();
+            found = true;
+        }
+    }
+    if (s_mismatches)
+        qDebug().nospace().noquote() << s_mismatches
+                                     << " checksum(s) differ from golden ones.";
+    if (!found)
+        qDebug().nospace().noquote() << "No benchmark matches '" << prefix
+                                     << "'. Available: " << suites().join(u", "_q);
+    return found;
+}
+
+auto Benchmark::suites() -> QStringList
+{
+    QStringList names;
+    for (auto &suite : s_suites)
+        names.push_back(_L(suite.name));
+    return names;
+}
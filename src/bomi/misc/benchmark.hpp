@@ -0,0 +1,49 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <QElapsedTimer>
+
+// micro-benchmarks run by --benchmark option
+// each suite is a function registered in benchmark.cpp which reports cases
+// through Benchmark::report(). Checksums of outputs are compared with golden
+// ones in benchmark-golden.json of current directory or the file given by
+// BOMI_BENCHMARK_GOLDEN, and recorded there if missing.
+
+class Benchmark {
+public:
+    Benchmark(const QString &suite);
+    ~Benchmark();
+    // call func repeatedly for at least given time and return nsec per call
+    template<class Func>
+    static auto measure(Func &&func, int msec = 300) -> double
+    {
+        func(); // warm up
+        QElapsedTimer timer;
+        qint64 count = 0;
+        timer.start();
+        do {
+            func();
+            ++count;
+        } while (timer.elapsed() < msec);
+        return double(timer.nsecsElapsed()) / count;
+    }
+    // nsec is for units of processed items named by unit
+    auto report(const QString &name, double nsec, double units,
+                const QString &unit) const -> void;
+    // nsec is for processing media of given duration in seconds
+    auto reportRealtime(const QString &name, double nsec, double sec) const -> void;
+    // FNV-1a; pass previous hash to continue
+    static auto checksum(const void *data, int bytes,
+                         quint64 hash = 0xcbf29ce484222325ull) -> quint64;
+    // golden checksums are kept per suite and instruction set
+    auto check(const QString &name, quint64 checksum) -> bool;
+    // run suites whose names start with prefix or all suites for empty prefix
+    static auto run(const QString &prefix) -> bool;
+    static auto suites() -> QStringList;
+private:
+    QString m_suite;
+    QJsonObject m_golden;
+    bool m_recorded = false;
+};
+
+#endif // BENCHMARK_HPP
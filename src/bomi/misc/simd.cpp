@@ -0,0 +1,30 @@
+#include "simd.hpp"
+
+auto Simd::isa() -> Isa
+{
+    static const Isa best = [] () {
+#ifdef SIMD_HAS_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return Avx2;
+#endif
+#ifdef SIMD_HAS_SSE2
+        return Sse2;
+#else
+        return Scalar;
+#endif
+    }();
+    return best;
+}
+
+auto Simd::name(Isa isa) -> const char*
+{
+    switch (isa) {
+    case Avx2:
+        return "AVX2";
+    case Sse2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,250 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+// thin wrappers over vector instructions
+// kernels are written once as templates over Float1/Float4/Float8 and
+// instantiated per instruction set. AVX2 kernels must be entered through a
+// function marked with SIMD_AVX2_ENTRY so that everything is inlined with
+// AVX2 enabled; see AudioMixer for an example.
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define SIMD_HAS_SSE2
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define SIMD_HAS_AVX2
+#define SIMD_AVX2 __attribute__((target("avx2,fma")))
+#define SIMD_AVX2_ENTRY __attribute__((target("avx2,fma"), flatten))
+#endif
+#endif
+
+namespace Simd {
+
+enum Isa { Scalar, Sse2, Avx2 };
+
+// best instruction set available on running cpu
+auto isa() -> Isa;
+auto name(Isa isa) -> const char*;
+
+struct Float1 {
+    using V = float;
+    SCA N = 1;
+    SIA load(const float *p) -> V { return *p; }
+    SIA store(float *p, V v) -> void { *p = v; }
+    SIA set1(float f) -> V { return f; }
+    SIA zero() -> V { return 0.f; }
+    SIA add(V a, V b) -> V { return a + b; }
+    SIA sub(V a, V b) -> V { return a - b; }
+    SIA mul(V a, V b) -> V { return a * b; }
+    SIA madd(V a, V b, V c) -> V { return a * b + c; }
+    SIA min(V a, V b) -> V { return a < b ? a : b; }
+    SIA max(V a, V b) -> V { return a > b ? a : b; }
+    SIA abs(V a) -> V { return std::fabs(a); }
+    SIA copysign(V mag, V sign) -> V { return std::copysign(mag, sign); }
+    SIA less(V a, V b) -> V { return a < b ? 1.f : 0.f; }
+    SIA select(V mask, V a, V b) -> V { return mask != 0.f ? a : b; }
+    // x = mantissa(x) * 2^exponent(x) with mantissa in [0.5, 1)
+    SIA frexp(V x, V *e) -> V { int n; x = std::frexp(x, &n); *e = n; return x; }
+    SIA sum(V a) -> float { return a; }
+    // round to nearest and saturate
+    SIA storeS16(qint16 *p, V v) -> void
+        { *p = std::lrint(max(-32768.f, min(v, 32767.f))); }
+    SIA storeS32(qint32 *p, V v) -> void
+        { *p = std::lrint(max(-2147483648.f, min(v, 2147483520.f))); }
+    SIA storeF64(double *p, V v) -> void { *p = v; }
+    // uniform in [-0.5, 0.5) by xorshift32 on N state words
+    SIA random(quint32 *s) -> V
+    {
+        auto x = *s;
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        *s = x;
+        union { quint32 i; float f; } u = { (x >> 9) | 0x3f800000 };
+        return u.f - 1.5f;
+    }
+};
+
+#ifdef SIMD_HAS_SSE2
+struct Float4 {
+    using V = __m128;
+    SCA N = 4;
+    SIA load(const float *p) -> V { return _mm_loadu_ps(p); }
+    SIA store(float *p, V v) -> void { _mm_storeu_ps(p, v); }
+    SIA set1(float f) -> V { return _mm_set1_ps(f); }
+    SIA zero() -> V { return _mm_setzero_ps(); }
+    SIA add(V a, V b) -> V { return _mm_add_ps(a, b); }
+    SIA sub(V a, V b) -> V { return _mm_sub_ps(a, b); }
+    SIA mul(V a, V b) -> V { return _mm_mul_ps(a, b); }
+    SIA madd(V a, V b, V c) -> V { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    SIA min(V a, V b) -> V { return _mm_min_ps(a, b); }
+    SIA max(V a, V b) -> V { return _mm_max_ps(a, b); }
+    SIA abs(V a) -> V { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+    SIA copysign(V mag, V sign) -> V
+    {
+        const auto m = _mm_set1_ps(-0.f);
+        return _mm_or_ps(_mm_andnot_ps(m, mag), _mm_and_ps(m, sign));
+    }
+    SIA less(V a, V b) -> V { return _mm_cmplt_ps(a, b); }
+    SIA select(V mask, V a, V b) -> V
+        { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    SIA frexp(V x, V *e) -> V
+    {
+        const auto i = _mm_castps_si128(x);
+        const auto n = _mm_sub_epi32(_mm_srli_epi32(i, 23), _mm_set1_epi32(126));
+        *e = _mm_cvtepi32_ps(n);
+        const auto m = _mm_and_si128(i, _mm_set1_epi32(0x807fffff));
+        return _mm_castsi128_ps(_mm_or_si128(m, _mm_set1_epi32(0x3f000000)));
+    }
+    SIA sum(V a) -> float
+    {
+        a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+        return _mm_cvtss_f32(a);
+    }
+    SIA storeS16(qint16 *p, V v) -> void
+    {
+        const auto i = _mm_cvtps_epi32(v);
+        _mm_storel_epi64((__m128i*)p, _mm_packs_epi32(i, i));
+    }
+    SIA storeS32(qint32 *p, V v) -> void
+    {
+        v = _mm_min_ps(v, _mm_set1_ps(2147483520.f));
+        _mm_storeu_si128((__m128i*)p, _mm_cvtps_epi32(v));
+    }
+    SIA storeF64(double *p, V v) -> void
+    {
+        _mm_storeu_pd(p, _mm_cvtps_pd(v));
+        _mm_storeu_pd(p + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    SIA random(quint32 *s) -> V
+    {
+        auto x = _mm_loadu_si128((const __m128i*)s);
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+        _mm_storeu_si128((__m128i*)s, x);
+        x = _mm_or_si128(_mm_srli_epi32(x, 9), _mm_set1_epi32(0x3f800000));
+        return _mm_sub_ps(_mm_castsi128_ps(x), _mm_set1_ps(1.5f));
+    }
+};
+#endif
+
+#ifdef SIMD_HAS_AVX2
+struct Float8 {
+    using V = __m256;
+    SCA N = 8;
+    SIMD_AVX2 SIA load(const float *p) -> V { return _mm256_loadu_ps(p); }
+    SIMD_AVX2 SIA store(float *p, V v) -> void { _mm256_storeu_ps(p, v); }
+    SIMD_AVX2 SIA set1(float f) -> V { return _mm256_set1_ps(f); }
+    SIMD_AVX2 SIA zero() -> V { return _mm256_setzero_ps(); }
+    SIMD_AVX2 SIA add(V a, V b) -> V { return _mm256_add_ps(a, b); }
+    SIMD_AVX2 SIA sub(V a, V b) -> V { return _mm256_sub_ps(a, b); }
+    SIMD_AVX2 SIA mul(V a, V b) -> V { return _mm256_mul_ps(a, b); }
+    SIMD_AVX2 SIA madd(V a, V b, V c) -> V { return _mm256_fmadd_ps(a, b, c); }
+    SIMD_AVX2 SIA min(V a, V b) -> V { return _mm256_min_ps(a, b); }
+    SIMD_AVX2 SIA max(V a, V b) -> V { return _mm256_max_ps(a, b); }
+    SIMD_AVX2 SIA abs(V a) -> V { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+    SIMD_AVX2 SIA copysign(V mag, V sign) -> V
+    {
+        const auto m = _mm256_set1_ps(-0.f);
+        return _mm256_or_ps(_mm256_andnot_ps(m, mag), _mm256_and_ps(m, sign));
+    }
+    SIMD_AVX2 SIA less(V a, V b) -> V { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    SIMD_AVX2 SIA select(V mask, V a, V b) -> V { return _mm256_blendv_ps(b, a, mask); }
+    SIMD_AVX2 SIA frexp(V x, V *e) -> V
+    {
+        const auto i = _mm256_castps_si256(x);
+        const auto n = _mm256_sub_epi32(_mm256_srli_epi32(i, 23), _mm256_set1_epi32(126));
+        *e = _mm256_cvtepi32_ps(n);
+        const auto m = _mm256_and_si256(i, _mm256_set1_epi32(0x807fffff));
+        return _mm256_castsi256_ps(_mm256_or_si256(m, _mm256_set1_epi32(0x3f000000)));
+    }
+    SIMD_AVX2 SIA sum(V a) -> float
+    {
+        const auto h = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        return Float4::sum(h);
+    }
+    SIMD_AVX2 SIA storeS16(qint16 *p, V v) -> void
+    {
+        const auto i = _mm256_cvtps_epi32(v);
+        const auto lo = _mm256_castsi256_si128(i), hi = _mm256_extracti128_si256(i, 1);
+        _mm_storeu_si128((__m128i*)p, _mm_packs_epi32(lo, hi));
+    }
+    SIMD_AVX2 SIA storeS32(qint32 *p, V v) -> void
+    {
+        v = _mm256_min_ps(v, _mm256_set1_ps(2147483520.f));
+        _mm256_storeu_si256((__m256i*)p, _mm256_cvtps_epi32(v));
+    }
+    SIMD_AVX2 SIA storeF64(double *p, V v) -> void
+    {
+        _mm256_storeu_pd(p, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        _mm256_storeu_pd(p + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+    SIMD_AVX2 SIA random(quint32 *s) -> V
+    {
+        auto x = _mm256_loadu_si256((const __m256i*)s);
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+        _mm256_storeu_si256((__m256i*)s, x);
+        x = _mm256_or_si256(_mm256_srli_epi32(x, 9), _mm256_set1_epi32(0x3f800000));
+        return _mm256_sub_ps(_mm256_castsi256_ps(x), _mm256_set1_ps(1.5f));
+    }
+};
+#endif
+
+// natural logarithm for positive normal numbers
+// taken from cephes logf; relative error is below 2^-23 in [1, 2^64)
+template<class F>
+SIA log(typename F::V x) -> typename F::V
+{
+    typename F::V e;
+    x = F::frexp(x, &e);
+    const auto small = F::less(x, F::set1(0.707106781186547524f));
+    e = F::sub(e, F::select(small, F::set1(1.f), F::zero()));
+    x = F::sub(F::add(x, F::select(small, x, F::zero())), F::set1(1.f));
+    const auto z = F::mul(x, x);
+    auto y = F::set1(7.0376836292e-2f);
+    y = F::madd(y, x, F::set1(-1.1514610310e-1f));
+    y = F::madd(y, x, F::set1(1.1676998740e-1f));
+    y = F::madd(y, x, F::set1(-1.2420140846e-1f));
+    y = F::madd(y, x, F::set1(1.4249322787e-1f));
+    y = F::madd(y, x, F::set1(-1.6668057665e-1f));
+    y = F::madd(y, x, F::set1(2.0000714765e-1f));
+    y = F::madd(y, x, F::set1(-2.4999993993e-1f));
+    y = F::madd(y, x, F::set1(3.3333331174e-1f));
+    y = F::mul(F::mul(y, x), z);
+    y = F::madd(e, F::set1(-2.12194440e-4f), y);
+    y = F::madd(z, F::set1(-0.5f), y);
+    x = F::add(x, y);
+    return F::madd(e, F::set1(0.693359375f), x);
+}
+
+// call func(F(), i) for each vector in [0, n) and func(Float1(), i) for the rest
+template<class F, class Func>
+SIA forEach(int n, Func &&func) -> void
+{
+    int i = 0;
+    for (; i + F::N <= n; i += F::N)
+        func(F(), i);
+    for (; i < n; ++i)
+        func(Float1(), i);
+}
+
+// sine for |x| <= pi/2 by Taylor series up to 11th order
+// absolute error is below 6e-8 in the range
+template<class F>
+SIA sin(typename F::V x) -> typename F::V
+{
+    const auto x2 = F::mul(x, x);
+    auto y = F::set1(-1.f/39916800.f);
+    y = F::madd(y, x2, F::set1(1.f/362880.f));
+    y = F::madd(y, x2, F::set1(-1.f/5040.f));
+    y = F::madd(y, x2, F::set1(1.f/120.f));
+    y = F::madd(y, x2, F::set1(-1.f/6.f));
+    y = F::madd(y, x2, F::set1(1.f));
+    return F::mul(y, x);
+}
+
+}
+
+#endif // SIMD_HPP
@@ -0,0 +1,78 @@
+#include "slicepool.hpp"
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QMutex>
+
+class SliceRunnable : public QRunnable {
+public:
+    SliceRunnable() { setAutoDelete(false); }
+    auto run() -> void final { (*m_func)(m_from, m_to); m_done->release(); }
+private:
+    const std::function<void(int, int)> *m_func = nullptr;
+    int m_from = 0, m_to = 0;
+    QSemaphore *m_done = nullptr;
+    friend class SlicePool;
+};
+
+static constexpr int MaxThreads = 16;
+
+struct SlicePool::Data {
+    QThreadPool pool;
+    QMutex mutex; // runnables are reused so that callers take turns
+    QSemaphore done;
+    SliceRunnable runnables[MaxThreads];
+    int threads = 1;
+};
+
+SlicePool::SlicePool(int threads)
+    : d(new Data)
+{
+    setThreads(threads);
+}
+
+SlicePool::~SlicePool()
+{
+    d->pool.waitForDone();
+    delete d;
+}
+
+auto SlicePool::setThreads(int threads) -> void
+{
+    d->threads = threads > 0 ? threads : QThread::idealThreadCount();
+    d->threads = qBound(1, d->threads, MaxThreads);
+    d->pool.setMaxThreadCount(qMax(1, d->threads - 1));
+}
+
+auto SlicePool::threads() const -> int
+{
+    return d->threads;
+}
+
+auto SlicePool::instance() -> SlicePool&
+{
+    static SlicePool pool;
+    return pool;
+}
+
+auto SlicePool::run(int threads, int rows, int align, int minimum,
+                    const std::function<void(int, int)> &func) -> void
+{
+    const int limit = threads > 0 ? qMin(threads, d->threads) : d->threads;
+    const int slices = qBound(1, rows / qMax(1, minimum), limit);
+    if (slices < 2) {
+        func(0, rows);
+        return;
+    }
+    auto edge = [&] (int i) { return i == slices ? rows : rows * i / slices / align * align; };
+    QMutexLocker locker(&d->mutex);
+    for (int i = 1; i < slices; ++i) {
+        auto &r = d->runnables[i];
+        r.m_func = &func;
+        r.m_from = edge(i);
+        r.m_to = edge(i + 1);
+        r.m_done = &d->done;
+        d->pool.start(&r);
+    }
+    func(0, edge(1));
+    d->done.acquire(slices - 1);
+}
@@ -0,0 +1,34 @@
+#ifndef SLICEPOOL_HPP
+#define SLICEPOOL_HPP
+
+#include <functional>
+
+// splits a range of rows into slices which run on a thread pool
+// the calling thread takes the first slice and returns when all are done
+// concurrent calls take turns since slices run on preallocated runnables
+
+class SlicePool {
+public:
+    // zero for cpu count
+    SlicePool(int threads = 0);
+    ~SlicePool();
+    SlicePool(const SlicePool &) = delete;
+    auto operator = (const SlicePool &) -> SlicePool& = delete;
+    auto setThreads(int threads) -> void;
+    auto threads() const -> int;
+    // calls func(from, to) over [0, rows); slice edges are multiples of align
+    // and a slice has at least minimum rows except the last one
+    auto run(int rows, int align, int minimum,
+             const std::function<void(int from, int to)> &func) -> void
+        { run(0, rows, align, minimum, func); }
+    // same as above with at most threads slices; zero for threads()
+    auto run(int threads, int rows, int align, int minimum,
+             const std::function<void(int from, int to)> &func) -> void;
+    // pool shared by video filters and subtitle drawer
+    static auto instance() -> SlicePool&;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // SLICEPOOL_HPP
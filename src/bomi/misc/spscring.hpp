@@ -0,0 +1,66 @@
+#ifndef SPSCRING_HPP
+#define SPSCRING_HPP
+
+// lock-free ring for one producer and one consumer thread
+// capacity is rounded up to power of 2 and push() is all-or-nothing so that
+// the producer never blocks and consumer never sees partial blocks.
+
+template<class T>
+class SpscRing {
+public:
+    SpscRing(int capacity = 0) { setCapacity(capacity); }
+    // neither side should be running
+    auto setCapacity(int capacity) -> void
+    {
+        int size = 1;
+        while (size < capacity)
+            size <<= 1;
+        m_data.resize(size);
+        m_mask = size - 1;
+        m_head.store(0);
+        m_tail.store(0);
+    }
+    auto capacity() const -> int { return m_mask + 1; }
+    // in producer or consumer thread
+    auto size() const -> int { return distance(m_head.loadAcquire(), m_tail.loadAcquire()); }
+    // in producer thread
+    auto push(const T *src, int n) -> bool
+    {
+        const int tail = m_tail.load();
+        if (n > capacity() - distance(m_head.loadAcquire(), tail))
+            return false;
+        copy(m_data.data(), tail, src, n, [] (T *ring, const T *p, int n)
+            { memcpy(ring, p, n * sizeof(T)); });
+        m_tail.storeRelease(next(tail, n));
+        return true;
+    }
+    // in consumer thread; returns the number of popped elements
+    auto pop(T *dst, int max) -> int
+    {
+        const int head = m_head.load();
+        const int n = std::min(max, distance(head, m_tail.loadAcquire()));
+        copy(m_data.data(), head, dst, n, [] (T *ring, T *p, int n)
+            { memcpy(p, ring, n * sizeof(T)); });
+        m_head.storeRelease(next(head, n));
+        return n;
+    }
+    // in consumer thread
+    auto clear() -> void { m_head.storeRelease(m_tail.loadAcquire()); }
+private:
+    // positions are free running and wrap around through unsigned arithmetic
+    static auto next(int pos, int n) -> int { return int(quint32(pos) + quint32(n)); }
+    static auto distance(int from, int to) -> int { return int(quint32(to) - quint32(from)); }
+    template<class P, class F>
+    auto copy(T *ring, int pos, P p, int n, F func) -> void
+    {
+        const int at = pos & m_mask, first = std::min(n, capacity() - at);
+        func(ring + at, p, first);
+        if (first < n)
+            func(ring, p + first, n - first);
+    }
+    std::vector<T> m_data;
+    int m_mask = 0;
+    QAtomicInt m_head{0}, m_tail{0};
+};
+
+#endif // SPSCRING_HPP
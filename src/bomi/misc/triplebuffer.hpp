@@ -0,0 +1,30 @@
+#ifndef TRIPLEBUFFER_HPP
+#define TRIPLEBUFFER_HPP
+
+// wait-free handover of latest value from one writer to one reader
+// writer fills back() and calls publish(); reader calls update() and reads
+// front(). neither side blocks and reader always sees a complete value.
+
+template<class T>
+class TripleBuffer {
+public:
+    auto back() -> T& { return m_data[m_back]; }
+    auto publish() -> void
+        { m_back = m_middle.fetchAndStoreOrdered(m_back | Fresh) & Index; }
+    // true if a new value has been published since last update()
+    auto update() -> bool
+    {
+        if (!(m_middle.loadAcquire() & Fresh))
+            return false;
+        m_front = m_middle.fetchAndStoreOrdered(m_front) & Index;
+        return true;
+    }
+    auto front() const -> const T& { return m_data[m_front]; }
+private:
+    enum { Index = 3, Fresh = 4 };
+    T m_data[3];
+    int m_front = 0, m_back = 1;
+    QAtomicInt m_middle{2};
+};
+
+#endif // TRIPLEBUFFER_HPP
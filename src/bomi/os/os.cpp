@@ -147,6 +147,13 @@ auto HwAcc::download(mp_hwdec_ctx *, const mp_image *, mp_image_pool *) -> mp_im
     return nullptr;
 }
 
+auto HwAcc::map(mp_hwdec_ctx *, const mp_image *, mp_image *) -> void*
+{
+    return nullptr;
+}
+
+auto HwAcc::unmap(mp_hwdec_ctx *, void *) -> void { }
+
 #ifndef Q_OS_WIN
 auto setImeEnabled(QWindow *w, bool enabled) -> void
 {
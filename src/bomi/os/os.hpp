@@ -103,6 +103,11 @@ public:
     auto description() const -> QString;
     virtual auto download(mp_hwdec_ctx *ctx, const mp_image *mpi,
                           mp_image_pool *pool) -> mp_image*;
+    // maps surface into view which may be uncached memory
+    // returns handle for unmap() or null if not supported
+    virtual auto map(mp_hwdec_ctx *ctx, const mp_image *mpi,
+                     mp_image *view) -> void*;
+    virtual auto unmap(mp_hwdec_ctx *ctx, void *handle) -> void;
     static auto fullCodecList() -> QList<CodecId>;
     static auto name(Api api) -> QString;
     static auto description(Api api) -> QString;
@@ -693,6 +693,47 @@ auto VaApiInfo::download(mp_hwdec_ctx *ctx, const mp_image *mpi,
     return img;
 }
 
+struct VaMapped { mp_vaapi_ctx *ctx; VAImage image; };
+
+auto VaApiInfo::map(mp_hwdec_ctx *ctx, const mp_image *mpi,
+                    mp_image *view) -> void*
+{
+    const auto va = ctx->vaapi_ctx;
+    if (!va)
+        return nullptr;
+    const auto id = va_surface_id((mp_image*)mpi);
+    if (id == VA_INVALID_ID)
+        return nullptr;
+    auto mapped = new VaMapped{va, VAImage()};
+    va_lock(va);
+    // derived image shares memory of surface; not every driver supports it
+    bool ok = vaSyncSurface(va->display, id) == VA_STATUS_SUCCESS
+            && vaDeriveImage(va->display, id, &mapped->image) == VA_STATUS_SUCCESS;
+    va_unlock(va);
+    if (ok && !(ok = va_image_map(va, &mapped->image, view))) {
+        va_lock(va);
+        vaDestroyImage(va->display, mapped->image.image_id);
+        va_unlock(va);
+    }
+    if (!ok) {
+        delete mapped;
+        return nullptr;
+    }
+    mp_image_set_size(view, mpi->w, mpi->h);
+    return mapped;
+}
+
+auto VaApiInfo::unmap(mp_hwdec_ctx *ctx, void *handle) -> void
+{
+    Q_UNUSED(ctx);
+    auto mapped = static_cast<VaMapped*>(handle);
+    va_image_unmap(mapped->ctx, &mapped->image);
+    va_lock(mapped->ctx);
+    vaDestroyImage(mapped->ctx->display, mapped->image.image_id);
+    va_unlock(mapped->ctx);
+    delete mapped;
+}
+
 #endif
 
 /******************************************************************************/
@@ -104,6 +104,9 @@ struct VaApiInfo : public HwAccX11 {
     VaApiInfo();
     auto download(mp_hwdec_ctx *ctx, const mp_image *mpi,
                   mp_image_pool *pool) -> mp_image* final;
+    auto map(mp_hwdec_ctx *ctx, const mp_image *mpi,
+             mp_image *view) -> void* final;
+    auto unmap(mp_hwdec_ctx *ctx, void *handle) -> void final;
 };
 
 #endif
@@ -6,6 +6,7 @@
 #include "misc/json.hpp"
 #include "misc/locale.hpp"
 #include "misc/objectstorage.hpp"
+#include "misc/benchmark.hpp"
 #include "quick/appobject.hpp"
 #include "rootmenu.hpp"
 #include "os/os.hpp"
@@ -42,7 +43,7 @@ auto translator_load(const Locale &locale) -> bool;
 enum class LineCmd {
     Wake, Open, Action, LogLevel, Debug,
     DumpApiTree, DumpActionList, WinAssoc, WinUnassoc, WinAssocDefault,
-    SetSubtitle, AddSubtitle,
+    SetSubtitle, AddSubtitle, Benchmark,
 };
 
 static const QCommandLineOption s_dummy{u"__dummy__"_q};
@@ -256,6 +257,9 @@ App::App(int &argc, char **argv)
                          u"Dump API structure tree to stdout."_q);
     d->parser->addOption(LineCmd::DumpActionList, u"dump-action-list"_q,
                          u"Dump executable action list to stdout."_q);
+    d->parser->addOption(LineCmd::Benchmark, u"benchmark"_q,
+                         u"Run benchmarks whose names start with %1 and print "
+                         "results. Give 'all' to run every benchmark."_q, u"name"_q);
 #ifdef Q_OS_WIN
     d->parser->addOption(LineCmd::WinAssoc, u"win-assoc"_q,
                          u"Associate given comma-separated extension list."_q, u"ext"_q);
@@ -346,6 +350,10 @@ auto App::executeToQuit() -> bool
         AppObject::dumpInfo();
     if (isSet(LineCmd::DumpActionList))
         RootMenu::dumpInfo();
+    if (isSet(LineCmd::Benchmark)) {
+        const auto name = d->parser->value(LineCmd::Benchmark);
+        Benchmark::run(name == "all"_a ? QString() : name);
+    }
     if (isSet(LineCmd::WinAssoc))
         OS::associateFileTypes(nullptr, true, d->parser->value(LineCmd::WinAssoc).split(','_q));
     if (isSet(LineCmd::WinAssocDefault))
@@ -2,6 +2,8 @@
 #include "streamtrack.hpp"
 #include "video/videoformat.hpp"
 #include "audio/audioformat.hpp"
+#include "audio/audiocontroller.hpp"
+#include "video/frametimer.hpp"
 #include <QQmlEngine>
 
 template<class L, class T = typename std::remove_pointer<typename L::value_type>::type>
@@ -111,6 +113,41 @@ auto AudioFormatObject::setFormat(const AudioFormat &format) -> void
     setDepth(format.bits());
 }
 
+auto AudioStageObject::set(const AudioStageLoad &load) -> void
+{
+    m_p50 = load.p50;
+    m_p99 = load.p99;
+    m_load = load.load;
+    m_frames = load.frames;
+    emit changed();
+}
+
+auto AudioObject::dspStages() const -> QQmlListProperty<AudioStageObject>
+{
+    return _MakeQmlList(this, &m_stages);
+}
+
+auto AudioObject::setDsp(const QVector<AudioStageLoad> &loads) -> void
+{
+    bool reset = loads.size() != m_stages.size();
+    for (int i = 0; !reset && i < loads.size(); ++i)
+        reset = loads[i].name != m_stages[i]->name();
+    if (reset) {
+        for (auto stage : m_stages)
+            QQmlEngine::setObjectOwnership(stage, QQmlEngine::JavaScriptOwnership);
+        m_stages.clear();
+        for (auto &load : loads)
+            m_stages.push_back(new AudioStageObject(load.name));
+        emit dspStagesChanged();
+    }
+    m_load = 0;
+    for (int i = 0; i < loads.size(); ++i) {
+        m_stages[i]->set(loads[i]);
+        m_load += loads[i].load;
+    }
+    emit dspChanged();
+}
+
 auto AudioObject::setDriver(const QString &driver) -> void
 {
     if (_Change(m_driver, driver)) {
@@ -192,6 +229,30 @@ void VideoObject::setDroppedFrames(int f)
         emit droppedFpsChanged();
 }
 
+auto FrameTimeObject::set(const FrameTimePercentiles &p) -> void
+{
+    m_p50 = p.p50;
+    m_p95 = p.p95;
+    m_p99 = p.p99;
+    emit changed();
+}
+
+auto VideoTimingObject::set(const FrameTimingStats &stats) -> void
+{
+    m_interval.set(stats.interval);
+    m_upload.set(stats.upload);
+    m_render.set(stats.render);
+    m_frames = stats.frames;
+    m_late = stats.late;
+    m_missed = stats.missed;
+    emit changed();
+}
+
+auto VideoTimingObject::dump(const QString &fileName) const -> bool
+{
+    return m_timer && m_timer->dump(fileName);
+}
+
 auto VideoObject::delayedTime() const -> qreal
 {
     double fps = m_filter.fps();
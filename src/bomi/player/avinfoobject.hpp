@@ -7,6 +7,8 @@
 
 class AudioFormat;                      class StreamTrack;
 class StreamList;                       class VideoRenderer;
+struct AudioStageLoad;                  class FrameTimer;
+struct FrameTimePercentiles;            struct FrameTimingStats;
 
 class CodecObject : public QObject {
     Q_OBJECT
@@ -142,6 +144,32 @@ private:
     QString m_ch;
 };
 
+class AudioStageObject : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(QString name READ name CONSTANT FINAL)
+    Q_PROPERTY(double p50 READ p50 NOTIFY changed)
+    Q_PROPERTY(double p99 READ p99 NOTIFY changed)
+    Q_PROPERTY(double load READ load NOTIFY changed)
+    Q_PROPERTY(qint64 frames READ frames NOTIFY changed)
+public:
+    AudioStageObject(const QString &name = QString()): m_name(name) { }
+    auto name() const -> QString { return m_name; }
+    // usec per buffer
+    auto p50() const -> double { return m_p50; }
+    auto p99() const -> double { return m_p99; }
+    // ratio of processing time to duration of output
+    auto load() const -> double { return m_load; }
+    // frames fed in last period
+    auto frames() const -> qint64 { return m_frames; }
+    auto set(const AudioStageLoad &load) -> void;
+signals:
+    void changed();
+private:
+    QString m_name;
+    double m_p50 = 0, m_p99 = 0, m_load = 0;
+    qint64 m_frames = 0;
+};
+
 class AudioObject : public AvCommonObject {
     Q_OBJECT
     Q_PROPERTY(AudioFormatObject *decoder READ decoder CONSTANT FINAL)
@@ -151,6 +179,8 @@ class AudioObject : public AvCommonObject {
     Q_PROPERTY(QString driver READ driver NOTIFY driverChanged)
     Q_PROPERTY(QString device READ device NOTIFY deviceChanged)
     Q_PROPERTY(QList<qreal> spectrum READ spectrum NOTIFY spectrumChanged)
+    Q_PROPERTY(double dspLoad READ dspLoad NOTIFY dspChanged)
+    Q_PROPERTY(QQmlListProperty<AudioStageObject> dspStages READ dspStages NOTIFY dspStagesChanged)
 public:
     AudioObject();
     auto decoder() const -> const AudioFormatObject* { return &m_decoder; }
@@ -167,6 +197,10 @@ public:
     auto spectrum() const -> QList<qreal> { return m_spectrum; }
     auto setSpectrum(const QList<qreal> &spectrum) -> void
         { emit spectrumChanged(m_spectrum = spectrum); }
+    // sum of loads of all stages
+    auto dspLoad() const -> double { return m_load; }
+    auto dspStages() const -> QQmlListProperty<AudioStageObject>;
+    auto setDsp(const QVector<AudioStageLoad> &loads) -> void;
 public slots:
     void setDriver(const QString &driver);
     void setDevice(const QString &device);
@@ -175,9 +209,12 @@ signals:
     void driverChanged();
     void deviceChanged();
     void spectrumChanged(const QList<qreal> &spectrum);
+    void dspChanged();
+    void dspStagesChanged();
 private:
     AudioFormatObject m_decoder, m_filter, m_output;
-    double m_gain = -1.0;
+    QVector<AudioStageObject*> m_stages;
+    double m_gain = -1.0, m_load = 0;
     QString m_driver, m_device;
     QList<qreal> m_spectrum;
 };
@@ -189,18 +226,37 @@ class VideoToolObject : public QObject {
     Q_PROPERTY(int state READ state NOTIFY stateChanged)
     Q_PROPERTY(QString driver READ driver NOTIFY driverChanged)
     Q_PROPERTY(QString method READ driver NOTIFY driverChanged)
+    Q_PROPERTY(qreal fps READ fps NOTIFY fpsChanged)
+    Q_PROPERTY(qreal copy READ copy NOTIFY downloadChanged)
+    Q_PROPERTY(qreal wait READ wait NOTIFY downloadChanged)
 public:
     auto state() const -> int { return m_state; }
     auto driver() const -> QString { return m_driver; }
+    // frames processed per second or zero if not measured
+    auto fps() const -> qreal { return m_fps; }
+    // msec per frame to copy surfaces in background and blocked for them
+    auto copy() const -> qreal { return m_copy; }
+    auto wait() const -> qreal { return m_wait; }
     auto setDriver(const QString &driver) -> void
     { if (_Change(m_driver, driver)) emit driverChanged(); }
     auto setState(int state) -> void
     { if (_Change(m_state, state)) emit stateChanged(); }
+    auto setFps(qreal fps) -> void
+    { if (_Change(m_fps, fps)) emit fpsChanged(); }
+    auto setDownload(qreal copy, qreal wait) -> void
+    {
+        const bool changed = _Change(m_copy, copy);
+        if (_Change(m_wait, wait) || changed)
+            emit downloadChanged();
+    }
 signals:
     void stateChanged();
     void driverChanged();
+    void fpsChanged();
+    void downloadChanged();
 private:
     int m_state = 0;
+    qreal m_fps = 0.0, m_copy = 0.0, m_wait = 0.0;
     QString m_driver;
 };
 
@@ -261,6 +317,53 @@ private:
     ColorRange m_range = ColorRange::Auto;
 };
 
+class FrameTimeObject : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(double p50 READ p50 NOTIFY changed)
+    Q_PROPERTY(double p95 READ p95 NOTIFY changed)
+    Q_PROPERTY(double p99 READ p99 NOTIFY changed)
+public:
+    // msec over recent frames
+    auto p50() const -> double { return m_p50; }
+    auto p95() const -> double { return m_p95; }
+    auto p99() const -> double { return m_p99; }
+    auto set(const FrameTimePercentiles &p) -> void;
+signals:
+    void changed();
+private:
+    double m_p50 = 0, m_p95 = 0, m_p99 = 0;
+};
+
+class VideoTimingObject : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(FrameTimeObject *interval READ interval CONSTANT FINAL)
+    Q_PROPERTY(FrameTimeObject *upload READ upload CONSTANT FINAL)
+    Q_PROPERTY(FrameTimeObject *render READ render CONSTANT FINAL)
+    Q_PROPERTY(qint64 frames READ frames NOTIFY changed)
+    Q_PROPERTY(qint64 late READ late NOTIFY changed)
+    Q_PROPERTY(qint64 missed READ missed NOTIFY changed)
+public:
+    // between presents of frames
+    auto interval() -> FrameTimeObject* { return &m_interval; }
+    auto upload() -> FrameTimeObject* { return &m_upload; }
+    auto render() -> FrameTimeObject* { return &m_render; }
+    auto frames() const -> qint64 { return m_frames; }
+    // upload and render took longer than a vsync period
+    auto late() const -> qint64 { return m_late; }
+    // presented later than cadence allows
+    auto missed() const -> qint64 { return m_missed; }
+    auto set(const FrameTimingStats &stats) -> void;
+    auto setTimer(const FrameTimer *timer) -> void { m_timer = timer; }
+    // CSV of recent frames
+    Q_INVOKABLE bool dump(const QString &fileName) const;
+signals:
+    void changed();
+private:
+    FrameTimeObject m_interval, m_upload, m_render;
+    qint64 m_frames = 0, m_late = 0, m_missed = 0;
+    const FrameTimer *m_timer = nullptr;
+};
+
 class VideoObject : public AvCommonObject {
     Q_OBJECT
     Q_PROPERTY(VideoFormatObject *decoder READ decoder CONSTANT FINAL)
@@ -275,6 +378,7 @@ class VideoObject : public AvCommonObject {
     Q_PROPERTY(qreal droppedFps READ droppedFps NOTIFY droppedFpsChanged)
     Q_PROPERTY(qint64 frameNumber READ frameNumber NOTIFY frameNumberChanged)
     Q_PROPERTY(qint64 frameCount READ frameCount NOTIFY frameCountChanged)
+    Q_PROPERTY(VideoTimingObject *timing READ timing CONSTANT FINAL)
 public:
     VideoObject();
     auto decoder() const -> const VideoFormatObject* { return &m_decoder; }
@@ -304,6 +408,7 @@ public:
     auto frameCount() const -> qint64 { return m_frameCount; }
     auto screen() const -> VideoRenderer* { return m_screen; }
     auto setScreen(VideoRenderer *vr) { m_screen = vr; }
+    auto timing() -> VideoTimingObject* { return &m_timing; }
 signals:
     void frameCountChanged();
     void frameNumberChanged();
@@ -314,6 +419,7 @@ signals:
 private:
     VideoFormatObject m_decoder, m_filter, m_output;
     VideoToolObject m_hwacc, m_deint;
+    VideoTimingObject m_timing;
     int m_dropped = 0, m_delayed = 0;
     qreal m_droppedFps = 0.0, m_fpsMp = 1;
     qint64 m_frameCount = 0, m_frameNumber = 0;
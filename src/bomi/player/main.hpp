@@ -53,7 +53,10 @@ auto registerType() -> void
     qmlRegisterType<AvTrackObject>();
     qmlRegisterType<VideoFormatObject>();
     qmlRegisterType<VideoToolObject>();
+    qmlRegisterType<FrameTimeObject>();
+    qmlRegisterType<VideoTimingObject>();
     qmlRegisterType<AudioFormatObject>();
+    qmlRegisterType<AudioStageObject>();
     qmlRegisterType<AudioObject>();
     qmlRegisterType<CodecObject>();
     qmlRegisterType<SubtitleObject>();
@@ -93,6 +96,7 @@ auto registerType() -> void
     qRegisterMetaType<IntrplParamSetMap>("IntrplParamSetMap");
     qRegisterMetaType<AudioVisualizer::Type>();
     qRegisterMetaType<AudioVisualizer::Scale>();
+    qRegisterMetaType<AudioVisualizer::Window>();
 
     qRegisterMetaTypeStreamOperators<Mrl>();
     qRegisterMetaTypeStreamOperators<Playlist>();
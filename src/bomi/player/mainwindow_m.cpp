@@ -285,6 +285,12 @@ auto MainWindow::Data::plugMenu() -> void
         e.seekToNextBlackFrame();
         showMessage(tr("Seek to Next Black Frame"));
     });
+    connect(seek[u"next-scene"_q], &QAction::triggered, p, [=] () {
+        if (e.seekToNextScene())
+            showMessage(tr("Seek to Next Scene"));
+        else
+            showMessage(tr("Seek to Next Scene"), tr("Not found yet"));
+    });
     connect(play[u"disc-menu"_q], &QAction::triggered,
             p, [=] () { e.seekEdition(PlayEngine::DVDMenu); });
     connect(seek.g(u"subtitle"_q), &ActionGroup::triggered,
@@ -358,21 +364,32 @@ auto MainWindow::Data::plugMenu() -> void
     connectSnapshot(u"quick"_q, QuickSnapshot);
     connectSnapshot(u"quick-nosub"_q, QuickSnapshotNoSub);
     connectSnapshot(u"tool"_q, SnapshotTool);
+    connect(snap[u"quick-burst"_q], &QAction::triggered, p, [this] () {
+        const auto save = pref.quick_snapshot_save();
+        burstShots = 0;
+        if (save == QuickSnapshotSave::Ask || (save == QuickSnapshotSave::Current
+                                               && !e.mrl().isLocalFile())) {
+            burstFolder = _GetOpenDir(nullptr, tr("Save Snapshot Burst"));
+            if (burstFolder.isEmpty())
+                return;
+            burstShots = pref.quick_snapshot_burst_count();
+        }
+        snapshotMode = QuickSnapshot;
+        e.takeSnapshots(pref.quick_snapshot_burst_count(),
+                        pref.quick_snapshot_burst_interval());
+    });
     connect(&e, &PlayEngine::snapshotTaken, p, [this] () {
         QImage frameOnly, withOsd;
         ph.position = _MSecToTime(e.snapshot(&frameOnly, &withOsd));
-        e.clearSnapshots();
         if (frameOnly.isNull())
             return;
         if (snapshotMode == QuickSnapshot || snapshotMode == SnapshotTool) {
             QRectF subRect;
-            QImage osd; osd.swap(withOsd);
-            withOsd = frameOnly;
-            QPainter painter(&withOsd);
-            painter.drawImage(osd.rect(), osd);
             auto sub = e.subtitleImage(withOsd.rect(), &subRect);
-            if (!sub.isNull())
+            if (!sub.isNull()) {
+                QPainter painter(&withOsd);
                 painter.drawImage(subRect, sub);
+            }
         }
         switch (snapshotMode) {
         case SnapshotTool: {
@@ -404,6 +421,11 @@ auto MainWindow::Data::plugMenu() -> void
                     break;
                 }
             case QuickSnapshotSave::Ask:
+                if (burstShots > 0) {
+                    --burstShots;
+                    folder = burstFolder;
+                    break;
+                }
                 folder = _LastOpenPath();
                 ask = true;
                 break;
@@ -721,6 +721,7 @@ auto MainWindow::Data::applyPref() -> void
 
     e.lock();
     e.preview()->setActive(controls.showPreviewOnMouseOverSeekBar);
+    e.preview()->setCacheLimit(p.preview_cache_mb() * 1024 * 1024);
 
     e.setResume_locked(p.remember_stopped());
     e.setPreciseSeeking_locked(p.precise_seeking());
@@ -736,8 +737,9 @@ auto MainWindow::Data::applyPref() -> void
     e.setAudioDevice_locked(p.audio_device());
     e.setVolumeNormalizerOption_locked(p.audio_normalizer());
     e.setChannelLayoutMap_locked(p.channel_manipulation());
-    e.setVolumeControl_locked(p.volume_scale(), p.soft_clip());
+    e.setVolumeControl_locked(p.volume_scale(), p.soft_clip(), p.audio_dithering());
     e.setResyncAvWhenFilterToggled_locked(p.audio_filter_resync());
+    e.setTempoScalerSearch_locked(p.audio_scaler_coarse_search());
 
     e.setSubtitleStyle_locked(p.sub_style());
     e.setAutoselectMode_locked(p.sub_enable_autoselect(), p.sub_autoselect(),
@@ -126,6 +126,8 @@ struct MainWindow::Data {
     QList<QAction*> unblockedActions;
     HistoryModel history;
     SnapshotMode snapshotMode = NoSnapshot;
+    // folder asked once for the remaining shots of a burst
+    QString burstFolder; int burstShots = 0;
 
     TopLevelItem *top = nullptr;
     OS::WindowAdapter *adapter = nullptr;
@@ -5,7 +5,9 @@
 #include "subtitle/subtitlemodel.hpp"
 #include "os/os.hpp"
 #include "videosettings.hpp"
+#include "video/hwdecdownloader.hpp"
 #include <QQuickWindow>
+#include <QScreen>
 
 PlayEngine::PlayEngine()
 : d(new Data(this)) {
@@ -15,9 +17,13 @@ PlayEngine::PlayEngine()
     d->sr = new SubtitleRenderer;
     d->vr = new VideoRenderer;
     d->preview = new VideoPreview;
+    d->scanner = new SceneScanner;
+    d->ss.reader = new SnapshotReader;
     d->vr->setOverlay(d->sr);
     d->vr->setRenderFrameFunction([this] (Fbo *frame, Fbo* osd, const QMargins &m)
         { d->renderVideoFrame(frame, osd, m); });
+    d->vr->setFrameTimer(&d->frames.timing);
+    d->info.video.timing()->setTimer(&d->frames.timing);
     d->updateVideoRendererFboFormat();
     d->info.video.setScreen(d->vr);
 
@@ -114,6 +120,15 @@ PlayEngine::PlayEngine()
             [=] () { if (_Change(d->end_s, end()/1000)) emit end_sChanged(); });
 
     connect(d->vr, &VideoRenderer::screenRectChanged, this, &PlayEngine::videoScreenRectChanged);
+    connect(d->ss.reader, &SnapshotReader::taken, this, [=] (const Snapshot &ss) {
+        d->ss.taken.push_back(ss);
+        emit snapshotTaken();
+    }, Qt::QueuedConnection);
+    connect(&d->ss.burst, &QTimer::timeout, this, [=] () {
+        takeSnapshot();
+        if (--d->ss.shots <= 0)
+            d->ss.burst.stop();
+    });
     auto checkDeint = [=] () {
         auto act = Unavailable;
         if (d->vp->isInputInterlaced())
@@ -149,6 +164,8 @@ PlayEngine::PlayEngine()
     connect(d->vp, &VideoProcessor::seekRequested, this, &PlayEngine::seek);
     connect(d->vp, &VideoProcessor::fpsManimulated, &d->info.video,
             &VideoObject::setFpsManimulation, Qt::QueuedConnection);
+    connect(d->vp, &VideoProcessor::deintFpsChanged, d->info.video.deint(),
+            &VideoToolObject::setFps, Qt::QueuedConnection);
     connect(d->vp, &VideoProcessor::hwdecChanged, this, [=] (const QString &api)
     {
         auto &video = d->info.video;
@@ -181,20 +198,39 @@ PlayEngine::PlayEngine()
     });
     connect(d->ac, &AudioController::gainChanged,
             &d->info.audio, &AudioObject::setNormalizer);
+    connect(d->ac, &AudioController::stageLoadsChanged, this,
+            [=] () { d->info.audio.setDsp(d->ac->stageLoads()); }, Qt::QueuedConnection);
     connect(d->ac, &AudioController::spectrumObtained,
             &d->info.audio, &AudioObject::setSpectrum, Qt::QueuedConnection);
     connect(this, &PlayEngine::audioOnlyChanged, d->ac, &AudioController::setAnalyzeSpectrum);
     connect(d->sr, &SubtitleRenderer::selectionChanged,
             this, &PlayEngine::subtitleSelectionChanged);
     connect(d->sr, &SubtitleRenderer::updated, this, &PlayEngine::subtitleUpdated);
+    connect(&d->subLoader, &SubtitleLoader::parsed, this,
+            [=] (const QVector<SubComp> &captions)
+        { if (d->sr->merge(captions)) d->syncInclusiveSubtitles(); });
+    // captions of a file still pending at its end belong to no component
+    // unless they wait for components of mrl being opened
+    connect(&d->subLoader, &SubtitleLoader::finished, this,
+            [=] (const QString &file) { if (!d->syncing.load()) d->sr->dropPending(file); });
 
     d->updateMediaName();
-    d->frames.measure.setTimer([=]()
-        { d->info.video.output()->setFps(d->frames.measure.get()); }, 100000);
+    d->frames.measure.setTimer([=]() {
+        d->info.video.output()->setFps(d->frames.measure.get());
+        d->frames.timing.update();
+    }, 100000);
     connect(&d->info.frameTimer, &QTimer::timeout, this, [=] () {
         d->info.video.decoder()->setBitrate(d->mpv.get<int>("video-bitrate"));
         d->info.video.setDelayedFrames(d->info.delayed);
         d->info.video.setDroppedFrames(d->mpv.get<int64_t>("vo-drop-frame-count"));
+        const auto download = d->vp->downloadStats();
+        d->info.video.hwacc()->setDownload(download.copy, download.wait);
+        // refresh rate is read here for render thread
+        const auto w = d->vr->window();
+        const auto hz = w && w->screen() ? w->screen()->refreshRate() : 0.0;
+        d->frames.timing.setVsync(hz > 1 ? 1e3 / hz : 0.0);
+        if (d->frames.timing.fetch())
+            d->info.video.timing()->set(d->frames.timing.stats());
     });
     connect(d->info.video.output(), &VideoFormatObject::sizeChanged,
             d->preview, &VideoPreview::setSizeHint);
@@ -269,6 +305,8 @@ PlayEngine::~PlayEngine()
     delete d->vr;
     delete d->vp;
     delete d->preview;
+    delete d->scanner;
+    delete d->ss.reader;
     delete d;
     _Debug("Finalized");
 }
@@ -278,10 +316,15 @@ auto PlayEngine::initializeGL(const QQuickWindow *w, QOpenGLContext *ctx) -> voi
     d->mpv.initializeGL(ctx);
     connect(w, &QQuickWindow::frameSwapped,
             &d->mpv, &Mpv::frameSwapped, Qt::DirectConnection);
+    connect(w, &QQuickWindow::frameSwapped,
+            this, [=] () { d->frames.timing.swapped(); }, Qt::DirectConnection);
 }
 
 auto PlayEngine::finalizeGL(QOpenGLContext */*ctx*/) -> void
 {
+    d->ss.reader->finalize();
+    _Delete(d->ss.frame);
+    _Delete(d->ss.osd);
     d->mpv.finalizeGL();
 }
 
@@ -509,10 +552,11 @@ auto PlayEngine::relativeSeek(int pos) -> void
     d->vp->stopSkipping();
 }
 
-auto PlayEngine::setVolumeControl_locked(int scale, bool soft) -> void
+auto PlayEngine::setVolumeControl_locked(int scale, bool soft, bool dither) -> void
 {
     d->volumeScale = scale;
     d->ac->setSoftClip(soft);
+    d->ac->setDithering(dither);
 }
 
 auto PlayEngine::setChannelLayoutMap_locked(const ChannelLayoutMap &map) -> void
@@ -729,6 +773,11 @@ auto PlayEngine::load(const Mrl &mrl, bool tryResume, const QString &sub) -> voi
     }
     if (!d->mrl.isEmpty())
         d->loadfile(d->mrl, tryResume, sub);
+    if (d->mrl.isLocalFile() && !d->hasImage) {
+        if (d->scanner->file() != QFileInfo(d->mrl.toLocalFile()).absoluteFilePath())
+            d->scanner->scan(d->mrl.toLocalFile());
+    } else
+        d->scanner->clear();
 }
 
 auto PlayEngine::time() const -> int
@@ -790,6 +839,11 @@ auto PlayEngine::setResyncAvWhenFilterToggled_locked(bool on) -> void
     d->filterResync = on;
 }
 
+auto PlayEngine::setTempoScalerSearch_locked(bool coarse) -> void
+{
+    d->ac->setTempoScalerSearch(coarse);
+}
+
 auto PlayEngine::setAudioVolumeNormalizer(bool on) -> void
 {
     if (d->params.set_audio_volume_normalizer(on)) {
@@ -1135,20 +1189,37 @@ auto PlayEngine::setVideoRotation(Rotation r) -> void
 
 auto PlayEngine::takeSnapshot() -> void
 {
-    d->ss.take = true;
+    d->ss.take.ref();
     d->vr->updateForNewFrame(d->displaySize());
 }
 
+auto PlayEngine::takeSnapshots(int count, int interval) -> void
+{
+    d->ss.burst.stop();
+    d->ss.shots = count;
+    if (count <= 0)
+        return;
+    takeSnapshot();
+    if (--d->ss.shots > 0)
+        d->ss.burst.start(qMax(1, interval));
+}
+
 auto PlayEngine::snapshot(QImage *frame, QImage *osd) -> int
 {
-    *frame = d->ss.frame;
-    *osd = d->ss.osd;
-    return d->ss.time;
+    if (d->ss.taken.empty()) {
+        *frame = *osd = QImage();
+        return 0;
+    }
+    const auto ss = std::move(d->ss.taken.front());
+    d->ss.taken.pop_front();
+    *frame = ss.frame;
+    *osd = ss.osd;
+    return ss.time;
 }
 
 auto PlayEngine::clearSnapshots() -> void
 {
-    d->ss.frame = d->ss.osd = QImage();
+    d->ss.taken.clear();
 }
 
 auto PlayEngine::setVideoHighQualityDownscaling(bool on) -> void
@@ -1166,8 +1237,24 @@ auto PlayEngine::setVideoHighQualityUpscaling(bool on) -> void
 
 auto PlayEngine::seekToNextBlackFrame() -> void
 {
-    if (!isStopped())
+    if (isStopped())
+        return;
+    const auto pts = d->scanner->nextBlackFrame((d->time + d->t.offset) * 1e-3);
+    if (pts < 0)
         d->vp->skipToNextBlackFrame();
+    else
+        seek(qRound(pts * 1e3) - d->t.offset);
+}
+
+auto PlayEngine::seekToNextScene() -> bool
+{
+    if (isStopped())
+        return false;
+    const auto pts = d->scanner->nextScene((d->time + d->t.offset) * 1e-3);
+    if (pts < 0)
+        return false;
+    seek(qRound(pts * 1e3) - d->t.offset);
+    return true;
 }
 
 auto PlayEngine::waitingText() const -> QString
@@ -1379,6 +1466,7 @@ auto PlayEngine::addSubtitleFiles(const QStringList &files,
 
 auto PlayEngine::clearSubtitleFiles() -> void
 {
+    d->subLoader.cancel();
     for (auto &track : d->params.sub_tracks()) {
         if (track.isExternal())
             d->mpv.tellAsync("sub_remove", track.id());
@@ -159,13 +159,14 @@ public:
     auto setVolumeNormalizerOption_locked(const AudioNormalizerOption &option) -> void;
     auto setDeintOptions_locked(const DeintOptionSet &set) -> void;
     auto setAudioDevice_locked(const QString &device) -> void;
-    auto setVolumeControl_locked(int scale, bool soft) -> void;
+    auto setVolumeControl_locked(int scale, bool soft, bool dither) -> void;
     auto setChannelLayoutMap_locked(const ChannelLayoutMap &map) -> void;
     auto setPriority_locked(const QStringList &audio, const QStringList &sub) -> void;
     auto setAutoloader_locked(const Autoloader &audio, const Autoloader &sub) -> void;
     auto setResume_locked(bool resume) -> void;
     auto setPreciseSeeking_locked(bool on) -> void;
     auto setResyncAvWhenFilterToggled_locked(bool on) -> void;
+    auto setTempoScalerSearch_locked(bool coarse) -> void;
     auto setMotionIntrplOption_locked(const MotionIntrplOption &option) -> void;
     auto unlock() -> void;
 
@@ -251,6 +252,8 @@ public:
     auto unpause() -> void;
     auto relativeSeek(int pos) -> void;
     auto seekToNextBlackFrame() -> void;
+    // false if no scene change is known after current position
+    auto seekToNextScene() -> bool;
 
     auto initializeGL(const QQuickWindow *w, QOpenGLContext *ctx) -> void;
     auto finalizeGL(QOpenGLContext *ctx) -> void;
@@ -284,6 +287,9 @@ public:
     auto setVideoSettings(const VideoSettings &s) -> void;
     auto videoSettings() const -> VideoSettings;
     auto takeSnapshot() -> void;
+    // count snapshots every interval msec; zero count cancels
+    auto takeSnapshots(int count, int interval) -> void;
+    // oldest taken snapshot, removed from queue; osd is composited over frame
     auto snapshot(QImage *frame, QImage *osd) -> int;
     auto clearSnapshots() -> void;
     auto waitingText() const -> QString;
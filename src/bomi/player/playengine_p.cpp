@@ -297,6 +297,8 @@ auto PlayEngine::Data::onLoad() -> void
         QMutexLocker locker(&mutex);
         mpv.setAsync("file-local-options/audio-file", autoloadFiles(StreamAudio));
     }
+    subLoader.cancel();
+    syncing.store(1);
     QVector<SubComp> loads;
     auto loadSub = [&] (auto &&res) {
         MpvFileList files, encs;
@@ -842,6 +844,7 @@ auto PlayEngine::Data::process(QEvent *event) -> void
         emit p->beginSyncMrlState();
         params.m_mutex = nullptr;
         sr->setComponents(loads);
+        syncing.store(0);
         mutex.lock();
         params.copyFrom(ms.data());
         params.set_sub_tracks_inclusive(sr->toTrackList());
@@ -867,33 +870,40 @@ auto PlayEngine::Data::process(QEvent *event) -> void
 
 auto PlayEngine::Data::takeSnapshot() -> void
 {
-    p->clearSnapshots();
     const auto size = displaySize();
     if (size.isEmpty()) {
-        emit p->snapshotTaken();
+        ss.take.deref();
+        emit ss.reader->taken(Snapshot());
         return;
     }
-    Fbo frame(size), osd(size);
-    mpv.render(&frame, &osd, QMargins());
-    ss.frame = frame.texture().toImage(QImage::Format_ARGB32);
-    ss.osd = osd.texture().toImage(QImage::Format_ARGB32_Premultiplied);
-    ss.time = mpv.get<double>("time-pos") * 1e3;
-    emit p->snapshotTaken();
+    if (!ss.frame || ss.frame->size() != size) {
+        _Renew(ss.frame, size);
+        _Renew(ss.osd, size);
+    }
+    mpv.render(ss.frame, ss.osd, QMargins());
+    if (ss.reader->read(ss.frame, ss.osd, mpv.get<double>("time-pos") * 1e3))
+        ss.take.deref();
 }
 
 auto PlayEngine::Data::renderVideoFrame(Fbo *frame, Fbo *osd, const QMargins &m) -> void
 {
+    frames.timing.start(FrameTimer::Render);
     info.delayed = mpv.render(frame, osd, m);
+    frames.timing.finish(FrameTimer::Render);
     frames.measure.push(++frames.drawn);
 
     _Trace("PlayEngine::Data::renderVideoFrame(): "
            "render queued frame(%%), avgfps: %%",
            frame->size(), info.video.output()->fps());
 
-    if (ss.take) {
+    // keep frames coming until readbacks are done even if paused
+    bool pending = ss.reader->collect();
+    if (ss.take.load() > 0) {
         takeSnapshot();
-        ss.take = false;
+        pending = true;
     }
+    if (pending)
+        vr->updateForNewFrame(displaySize());
 }
 
 auto PlayEngine::Data::toTracks(const QVariant &var) -> QVector<StreamList>
@@ -927,8 +937,8 @@ auto PlayEngine::Data::restoreInclusiveSubtitles(const StreamList &tracks, const
         auto it = subMap.find(track.file());
         if (it == subMap.end()) {
             it = subMap.insert(track.file(), QMap<QString, SubComp>());
-            Subtitle sub;
-            if (!sub.load(track.file(), encoding(track, enc, detect)))
+            const auto sub = subLoader.load(track.file(), encoding(track, enc, detect));
+            if (sub.isEmpty())
                 continue;
             for (int i = 0; i < sub.size(); ++i)
                 it->insert(sub[i].language(), sub[i]);
@@ -1002,9 +1012,9 @@ auto PlayEngine::Data::autoloadSubtitle(const MrlState *s, const MpvFileList &su
     MpvFileList files;
     QVector<SubComp> loads;
     for (auto &file : subs.names) {
-       Subtitle sub;
        const auto enc = EncodingInfo::detect(EncodingInfo::Subtitle, file);
-       if (sub.load(file, enc)) {
+       const auto sub = subLoader.load(file, enc);
+       if (!sub.isEmpty()) {
            for (int i = 0; i < sub.size(); ++i)
                loads.push_back(sub[i]);
        } else {
@@ -1068,6 +1078,8 @@ auto PlayEngine::Data::setWaitings(Waitings w, bool set) -> void
 auto PlayEngine::Data::clearTimings() -> void
 {
     frames.measure.reset();
+    frames.timing.reset();
+    info.video.timing()->set(FrameTimingStats());
     info.video.setDroppedFrames(0);
     info.video.setDelayedFrames(0);
     info.video.output()->setFps(0);
@@ -1097,8 +1109,8 @@ auto PlayEngine::Data::addSubtitleFiles(const QVector<SubtitleWithEncoding> &sub
     QVector<SubComp> loaded;
     for (auto &s : subs) {
         const auto enc = EncodingInfo::detect(EncodingInfo::Subtitle, s.encoding, s.file);
-        Subtitle sub;
-        if (sub.load(s.file, enc)) {
+        const auto sub = subLoader.load(s.file, enc);
+        if (!sub.isEmpty()) {
             for (int i = 0; i < sub.size(); ++i) {
                 loaded.push_back(sub[i]);
                 loaded.back().selection() = true;
@@ -19,8 +19,12 @@
 #include "video/videorenderer.hpp"
 #include "video/videoprocessor.hpp"
 #include "video/videopreview.hpp"
+#include "video/scenescanner.hpp"
+#include "video/snapshotreader.hpp"
+#include "video/frametimer.hpp"
 #include "subtitle/subtitle.hpp"
 #include "subtitle/subtitlerenderer.hpp"
+#include "subtitle/subtitleloader.hpp"
 #include "enum/codecid.hpp"
 #include "enum/framebufferobjectformat.hpp"
 #include "opengl/openglframebufferobject.hpp"
@@ -70,6 +74,7 @@ struct PlayEngine::Data {
     AudioController *ac = nullptr;
     SubtitleRenderer *sr = nullptr;
     VideoProcessor *vp = nullptr;
+    SceneScanner *scanner = nullptr;
     FramebufferObjectFormat fboFormat = FramebufferObjectFormat::Auto;
     QByteArray playingVideo, playingAudio;
     YouTubeDL::Result ytResult;
@@ -118,6 +123,8 @@ struct PlayEngine::Data {
     int duration = 0, begin = 0, time = 0;
 
     QMap<QString, EncodingInfo> assEncodings;
+    SubtitleLoader subLoader;
+    QAtomicInt syncing{0}; // components of mrl being opened are not set yet
 
     std::array<StreamData, StreamUnknown> streams = []() {
         std::array<StreamData, StreamUnknown> strs;
@@ -130,9 +137,16 @@ struct PlayEngine::Data {
     struct {
         quint64 drawn = 0, dropped = 0, delayed = 0;
         SpeedMeasure<quint64> measure{5, 20};
+        FrameTimer timing;
     } frames;
 
-    struct { QImage osd, frame; bool take = false; int time = 0; } ss;
+    struct {
+        SnapshotReader *reader = nullptr;
+        Fbo *frame = nullptr, *osd = nullptr; // for render thread
+        QAtomicInt take{0};
+        QTimer burst; int shots = 0;
+        std::deque<Snapshot> taken;
+    } ss;
     QPoint mouse;
 
     auto resync(bool force = false) -> void;
@@ -146,7 +160,7 @@ struct PlayEngine::Data {
         { sr->setComponents(loaded); s->set_sub_tracks_inclusive(sr->toTrackList()); }
     auto syncInclusiveSubtitles() -> void
         { params.set_sub_tracks_inclusive(sr->toTrackList()); }
-    static auto restoreInclusiveSubtitles(const StreamList &tracks,
+    auto restoreInclusiveSubtitles(const StreamList &tracks,
         const EncodingInfo &enc, bool detect) -> QVector<SubComp>;
     auto audio_add(const QString &file, bool select) -> void
         { mpv.tellAsync("audio_add", MpvFile(file), select ? "select"_b : "auto"_b); }
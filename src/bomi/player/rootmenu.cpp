@@ -332,6 +332,7 @@ RootMenu::RootMenu()
             d->actionToGroup(u"prev-frame"_q, QT_TR_NOOP("Previous Frame"), false, u"frame"_q)->setData(-1);
             d->actionToGroup(u"next-frame"_q, QT_TR_NOOP("Next Frame"), false, u"frame"_q)->setData(1);
             d->action(u"black-frame"_q, QT_TR_NOOP("Next Black Frame"));
+            d->action(u"next-scene"_q, QT_TR_NOOP("Next Scene"));
 
             d->separator();
 
@@ -364,6 +365,7 @@ RootMenu::RootMenu()
         d->menu(u"snapshot"_q, QT_TR_NOOP("Take Snapshot"), [=] () {
             d->action(u"quick"_q, QT_TR_NOOP("Quick Snapshot"));
             d->action(u"quick-nosub"_q, QT_TR_NOOP("Quick Snapshot(No Subtitles)"));
+            d->action(u"quick-burst"_q, QT_TR_NOOP("Quick Snapshot Burst"));
             d->action(u"tool"_q, QT_TR_NOOP("Snapshot Tool"));
         });
         d->menu(u"clip"_q, QT_TR_NOOP("Make Video Clip"), [=] () {
@@ -127,6 +127,7 @@ auto ShortcutMap::default_(const QString &id) -> QList<Key>
        map[u"play/seek/prev-frame"_q] << Qt::ALT + Qt::Key_Left;
        map[u"play/seek/next-frame"_q] << Qt::ALT + Qt::Key_Right;
        map[u"play/seek/black-frame"_q] << Qt::ALT + Qt::Key_B;
+       map[u"play/seek/next-scene"_q] << Qt::ALT + Qt::Key_N;
        map[u"play/seek/prev-subtitle"_q] << Qt::Key_Comma;
        map[u"play/seek/current-subtitle"_q] << Qt::Key_Period;
        map[u"play/seek/next-subtitle"_q] << Qt::Key_Slash;
@@ -149,6 +150,7 @@ auto ShortcutMap::default_(const QString &id) -> QList<Key>
 
        map[u"video/snapshot/quick"_q] << Qt::CTRL + Qt::Key_S;
        map[u"video/snapshot/tool"_q] << Qt::CTRL + Qt::SHIFT + Qt::Key_S;
+       map[u"video/snapshot/quick-burst"_q] << Qt::CTRL + Qt::ALT + Qt::Key_S;
        map[u"video/clip/range"_q] << Qt::CTRL + Qt::Key_C;
        map[u"video/clip/advanced"_q] << Qt::CTRL + Qt::SHIFT + Qt::Key_C;
        map[u"video/aspect/source"_q] << CTRL+SHIFT+Key_R;
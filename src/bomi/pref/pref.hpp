@@ -59,6 +59,8 @@ private:
     P1(QString, quick_snapshot_format, u"png"_q, "currentText")
     P0(QString, quick_snapshot_folder, _WritablePath(Location::Pictures))
     P0(int, quick_snapshot_quality, -1)
+    P0(int, quick_snapshot_burst_count, 10)
+    P0(int, quick_snapshot_burst_interval, 1000)
     P0(QuickSnapshotSave, quick_snapshot_save, QuickSnapshotSave::Fixed)
 
     P0(bool, jr_use, false)
@@ -127,6 +129,7 @@ private:
     P0(DeintOptionSet, deinterlacing, {})
 
     P0(bool, audio_filter_resync, true)
+    P0(bool, audio_scaler_coarse_search, false)
     P0(AudioNormalizerOption, audio_normalizer, AudioNormalizerOption::default_())
 
     P1(QString, skin_name, defaultSkinName(), "currentText")
@@ -136,6 +139,7 @@ private:
 
     P1(QString, audio_device, u"auto"_q, "currentText")
     P0(bool, soft_clip, true)
+    P0(bool, audio_dithering, false)
     P0(bool, auto_unmute, false)
 
     P0(double, cache_local_mb, 0)
@@ -150,6 +154,7 @@ private:
     P0(int, cache_min_playback_kb, 0)
     P0(int, cache_min_seeking_kb, 500)
     P0(double, cache_file_size_mb, 1024)
+    P0(double, preview_cache_mb, 256)
     P0(QStringList, network_folders, {})
 
     P0(QString, yt_user_agent, u"Mozilla/5.0 (X11; Linux x86_64; rv:10.0) Gecko/20100101 Firefox/10.0 (Chrome)"_q)
@@ -0,0 +1,85 @@
+#include "shelfpacker.hpp"
+
+auto ShelfPacker::reset(const QSize &size) -> void
+{
+    m_size = size;
+    m_shelves.clear();
+}
+
+// first x where width fits or -1
+auto ShelfPacker::gap(const Shelf &shelf, int width) const -> int
+{
+    int end = 0;
+    for (auto &span : shelf.spans) {
+        if (span.first - end >= width)
+            return end;
+        end = span.second;
+    }
+    return m_size.width() - end >= width ? end : -1;
+}
+
+auto ShelfPacker::allocate(const QSize &size) -> QRect
+{
+    const int w = size.width(), h = size.height();
+    if (w <= 0 || h <= 0 || w > m_size.width())
+        return QRect();
+    // lowest shelf which fits; twice taller one wastes too much
+    int best = -1, x = 0;
+    for (int i = 0; i < (int)m_shelves.size(); ++i) {
+        const auto &shelf = m_shelves[i];
+        const bool empty = shelf.spans.empty();
+        if (shelf.height < h || (!empty && shelf.height > h * 2))
+            continue;
+        if (best >= 0 && m_shelves[best].height <= shelf.height)
+            continue;
+        const int at = gap(shelf, w);
+        if (at >= 0) {
+            best = i;
+            x = at;
+        }
+    }
+    if (best < 0) {
+        const int y = m_shelves.empty() ? 0 : m_shelves.back().y + m_shelves.back().height;
+        if (y + h > m_size.height())
+            return QRect();
+        m_shelves.push_back({ y, h, { } });
+        best = m_shelves.size() - 1;
+    } else if (m_shelves[best].spans.empty() && m_shelves[best].height > h) {
+        auto &shelf = m_shelves[best];
+        const Shelf rest{ shelf.y + h, shelf.height - h, { } };
+        shelf.height = h;
+        m_shelves.insert(m_shelves.begin() + best + 1, rest);
+    }
+    auto &shelf = m_shelves[best];
+    const std::pair<int, int> span(x, x + w);
+    shelf.spans.insert(std::lower_bound(shelf.spans.begin(), shelf.spans.end(), span), span);
+    return { x, shelf.y, w, h };
+}
+
+auto ShelfPacker::release(const QRect &rect) -> void
+{
+    auto it = std::find_if(m_shelves.begin(), m_shelves.end(),
+                           [&] (const Shelf &s) { return s.y == rect.y(); });
+    if (it == m_shelves.end())
+        return;
+    auto &spans = it->spans;
+    const auto span = std::find(spans.begin(), spans.end(),
+                                std::make_pair(rect.x(), rect.x() + rect.width()));
+    if (span == spans.end())
+        return;
+    spans.erase(span);
+    if (!spans.empty())
+        return;
+    auto empty = [] (const Shelf &s) { return s.spans.empty(); };
+    if (it + 1 != m_shelves.end() && empty(it[1])) {
+        it->height += it[1].height;
+        m_shelves.erase(it + 1);
+    }
+    if (it != m_shelves.begin() && empty(it[-1])) {
+        it[-1].height += it->height;
+        it = m_shelves.erase(it) - 1;
+    }
+    // space below last shelf is free anyway
+    if (it + 1 == m_shelves.end())
+        m_shelves.erase(it);
+}
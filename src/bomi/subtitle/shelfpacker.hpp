@@ -0,0 +1,31 @@
+#ifndef SHELFPACKER_HPP
+#define SHELFPACKER_HPP
+
+// allocates rectangles of a texture atlas
+// rectangles are put side by side on shelves stacked from the top. a shelf
+// keeps its height while it holds any rectangle and reuses freed space by
+// first fit. an empty shelf is split when a lower rectangle takes it and
+// merged with empty neighbors, so captions of varying heights coming and
+// going do not fragment the area for long.
+
+class ShelfPacker {
+public:
+    ShelfPacker(const QSize &size = QSize()) { reset(size); }
+    // releases every rectangle
+    auto reset(const QSize &size) -> void;
+    auto size() const -> QSize { return m_size; }
+    // null if it does not fit
+    auto allocate(const QSize &size) -> QRect;
+    // rect should be one returned by allocate()
+    auto release(const QRect &rect) -> void;
+private:
+    struct Shelf {
+        int y, height;
+        std::vector<std::pair<int, int>> spans; // [begin, end) sorted
+    };
+    auto gap(const Shelf &shelf, int width) const -> int;
+    QSize m_size;
+    std::vector<Shelf> m_shelves;
+};
+
+#endif // SHELFPACKER_HPP
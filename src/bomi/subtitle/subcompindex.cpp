@@ -0,0 +1,154 @@
+#include "subcompindex.hpp"
+
+struct SubCompIndex::Data {
+    QVector<const SubComp*> comps;
+    QVector<SubCompIndex> parts; // indexes of each component if merged
+    std::vector<Entry> entries;
+    std::vector<int> words; // times of captions which have words
+    double fps = 0.0;
+};
+
+SIA upperBound(const std::vector<SubCompIndex::Entry> &entries, int time) -> int
+{
+    using Entry = SubCompIndex::Entry;
+    const auto it = std::upper_bound(entries.begin(), entries.end(), time,
+        [] (int time, const Entry &e) { return time < e.time; });
+    return it - entries.begin();
+}
+
+SubCompIndex::SubCompIndex(const SubComp *comp, double fps)
+{
+    auto d = new Data;
+    d->fps = fps;
+    d->comps.push_back(comp);
+    if (!comp->isBasedOnFrame() || fps > 0.0) {
+        d->entries.reserve(comp->map().size());
+        for (auto it = comp->begin(); it != comp->end(); ++it) {
+            const int time = comp->toTime(it.key(), fps);
+            // frames can be rounded to same msec; later one is shown
+            if (!d->entries.empty() && d->entries.back().time == time) {
+                d->entries.pop_back();
+                if (!d->words.empty() && d->words.back() == time)
+                    d->words.pop_back();
+            }
+            d->entries.push_back({ time, 0, it });
+            if (it->hasWords())
+                d->words.push_back(time);
+        }
+    }
+    this->d.reset(d);
+}
+
+SubCompIndex::SubCompIndex(const QVector<SubCompIndex> &indexes)
+{
+    auto d = new Data;
+    auto byTime = [] (const Entry &lhs, const Entry &rhs)
+        { return lhs.time < rhs.time; };
+    for (auto &index : indexes) {
+        if (!index.d)
+            continue;
+        const int offset = d->comps.size();
+        const auto mid = d->entries.size(), wmid = d->words.size();
+        d->fps = index.d->fps;
+        d->comps += index.d->comps;
+        d->parts.push_back(index);
+        for (auto e : index.d->entries) {
+            e.component += offset;
+            d->entries.push_back(e);
+        }
+        std::inplace_merge(d->entries.begin(), d->entries.begin() + mid,
+                           d->entries.end(), byTime);
+        d->words.insert(d->words.end(), index.d->words.begin(), index.d->words.end());
+        std::inplace_merge(d->words.begin(), d->words.begin() + wmid, d->words.end());
+    }
+    this->d.reset(d);
+}
+
+auto SubCompIndex::size() const -> int
+{
+    return d ? d->entries.size() : 0;
+}
+
+auto SubCompIndex::at(int i) const -> const Entry&
+{
+    return d->entries[i];
+}
+
+auto SubCompIndex::fps() const -> double
+{
+    return d ? d->fps : 0.0;
+}
+
+auto SubCompIndex::components() const -> const QVector<const SubComp*>&
+{
+    static const QVector<const SubComp*> null;
+    return d ? d->comps : null;
+}
+
+auto SubCompIndex::find(int time) const -> int
+{
+    return d ? upperBound(d->entries, time) - 1 : -1;
+}
+
+auto SubCompIndex::active(int time) const -> QVector<Entry>
+{
+    QVector<Entry> entries;
+    if (!d)
+        return entries;
+    if (d->parts.isEmpty()) {
+        const int i = find(time);
+        if (i >= 0)
+            entries.push_back(d->entries[i]);
+        return entries;
+    }
+    int offset = 0;
+    for (auto &part : d->parts) {
+        for (auto e : part.active(time)) {
+            e.component += offset;
+            entries.push_back(e);
+        }
+        offset += part.components().size();
+    }
+    return entries;
+}
+
+auto SubCompIndex::start(int time) const -> int
+{
+    const int i = find(time);
+    return i < 0 ? -1 : d->entries[i].time;
+}
+
+auto SubCompIndex::finish(int time) const -> int
+{
+    if (!d)
+        return -1;
+    const int i = upperBound(d->entries, time);
+    return i < size() ? d->entries[i].time : -1;
+}
+
+auto SubCompIndex::current(int time) const -> int
+{
+    int ret = -1;
+    for (auto &e : active(time)) {
+        if (e.caption().hasWords())
+            ret = qMax(ret, e.time);
+    }
+    return ret;
+}
+
+auto SubCompIndex::previous(int time) const -> int
+{
+    const int start = this->start(time);
+    if (start < 0)
+        return -1;
+    const auto it = std::lower_bound(d->words.begin(), d->words.end(), start);
+    return it == d->words.begin() ? -1 : *(it - 1);
+}
+
+auto SubCompIndex::next(int time) const -> int
+{
+    if (!d || find(time) < 0)
+        return -1;
+    const auto it = std::upper_bound(d->words.begin(), d->words.end(), time);
+    return it == d->words.end() ? -1 : *it;
+}
@@ -0,0 +1,46 @@
+#ifndef SUBCOMPINDEX_HPP
+#define SUBCOMPINDEX_HPP
+
+#include "subtitle.hpp"
+
+// sorted start times of captions in msec for a frame rate
+// index is built once for a component and fps and never changes; copies
+// share entries. merged index refers to captions of each component in place,
+// so component must outlive index and be rebuilt after its captions change.
+// lookups are binary searches in flat arrays.
+
+class SubCompIndex {
+public:
+    struct Entry {
+        int time;         // msec
+        int component;    // position in components()
+        SubComp::ConstIt it;
+        auto caption() const -> const SubCapt& { return *it; }
+    };
+    SubCompIndex() = default;
+    SubCompIndex(const SubComp *comp, double fps);
+    // entries of indexes are merged but captions are not copied
+    SubCompIndex(const QVector<SubCompIndex> &indexes);
+    auto isEmpty() const -> bool { return !size(); }
+    auto size() const -> int;
+    auto at(int i) const -> const Entry&;
+    auto fps() const -> double;
+    auto components() const -> const QVector<const SubComp*>&;
+    // position of latest caption which begins until time or -1 if none
+    auto find(int time) const -> int;
+    // caption shown at time for each component which has begun
+    auto active(int time) const -> QVector<Entry>;
+    // boundaries of captions shown at time; -1 if none
+    auto start(int time) const -> int;
+    auto finish(int time) const -> int;
+    // latest beginning of captions which have words and are shown at time
+    auto current(int time) const -> int;
+    // captions which have words and begin around those shown at time
+    auto previous(int time) const -> int;
+    auto next(int time) const -> int;
+private:
+    struct Data;
+    QSharedPointer<const Data> d;
+};
+
+#endif // SUBCOMPINDEX_HPP
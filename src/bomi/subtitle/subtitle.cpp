@@ -45,6 +45,18 @@ auto SubComp::united(const SubComp &other, double frameRate) const -> SubComp
     return SubComp(*this).unite(other, frameRate);
 }
 
+auto SubComp::merge(const SubComp &rhs) -> SubComp&
+{
+    if (this == &rhs)
+        return *this;
+    for (auto it = rhs.begin(); it != rhs.end(); ++it)
+        m_capts[it.key()] += *it;
+    auto it = m_capts.begin();
+    for (int idx = 0; it != m_capts.end(); ++idx, ++it)
+        it->index = idx;
+    return *this;
+}
+
 auto SubComp::start(int time, double frameRate) const -> const_iterator
 {
     if (isEmpty() || time < 0)
@@ -143,6 +155,18 @@ auto Subtitle::parse(const QString &file, const EncodingInfo &enc) -> Subtitle
     return SubtitleParser::parse(file, enc);
 }
 
+auto Subtitle::merge(const Subtitle &rhs) -> void
+{
+    for (auto &comp : rhs.m_comp) {
+        auto it = std::find_if(m_comp.begin(), m_comp.end(),
+                               [&] (const SubComp &c) { return c.id() == comp.id(); });
+        if (it != m_comp.end())
+            it->merge(comp);
+        else
+            m_comp.append(comp);
+    }
+}
+
 auto Subtitle::isEmpty() const -> bool
 {
     if (m_comp.isEmpty())
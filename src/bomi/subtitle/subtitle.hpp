@@ -43,6 +43,8 @@ public:
     auto operator[] (int key) const -> SubCapt { return m_capts[key]; }
     auto unite(const SubComp &other, double frameRate) -> SubComp&;
     auto united(const SubComp &other, double frameRate) const -> SubComp;
+    // appends captions parsed later from same file
+    auto merge(const SubComp &other) -> SubComp&;
 
     auto hasWords() const -> bool
         { for (auto &c : m_capts) if (c.hasWords()) return true; return false; }
@@ -108,6 +110,8 @@ public:
     auto load(const QString &file, const EncodingInfo &enc) -> bool;
     auto clear() -> void {m_comp.clear();}
     auto append(const SubComp &comp) -> void {m_comp.append(comp);}
+    // merges components of same id; others are appended
+    auto merge(const Subtitle &other) -> void;
     static auto parse(const QString &fileName, const EncodingInfo &enc) -> Subtitle;
 private:
     friend class SubtitleParser;
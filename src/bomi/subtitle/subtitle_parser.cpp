@@ -1,6 +1,6 @@
 #include "subtitle_parser_p.hpp"
 #include "misc/log.hpp"
-#include <QTextStream>
+#include <QTextCodec>
 
 DECLARE_LOG_CONTEXT(Subtitle)
 
@@ -8,23 +8,66 @@ int SubtitleParser::msPerChar = -1;
 
 auto SubtitleParser::append(Subtitle &s, SubComp::SyncType b) -> SubComp&
 {
-    static int id = 0;
-    s.m_comp.append(SubComp(type(), m_file, m_encoding, id++, b));
+    static QAtomicInt id{0}; // streams may be parsed in other threads
+    const int next = id.fetchAndAddRelaxed(1);
+    s.m_comp.append(SubComp(type(), m_file, m_encoding, next, b));
     return s.m_comp.last();
 }
 
+auto SubtitleParser::header(const SubComp &comp) -> SubComp
+{
+    auto header = comp;
+    header.m_capts = SubComp::Map();
+    header.m_capts[0].index = 0;
+    return header;
+}
+
+auto SubtitleParser::feed(const QString &text, bool last) -> void
+{
+    m_all.remove(0, m_pos);
+    m_all += text;
+    m_pos = 0;
+    m_last = last;
+    m_end = m_all.size();
+    if (!last) {
+        while (m_end > 0 && !isNewLine(at(m_end - 1)))
+            --m_end;
+    }
+}
+
 auto SubtitleParser::parse(const QString &fileName,
                            const EncodingInfo &enc) -> Subtitle
 {
-    QFile file(fileName);
-    if (!file.open(QFile::ReadOnly) || file.size() > (1 << 20))
+    SubtitleStream stream(fileName, enc);
+    if (!stream.isOpen())
         return Subtitle();
-    QTextStream in;
-    in.setDevice(&file);
-    in.setCodec(enc.codec());
-    const QString all = in.readAll();
-    QFileInfo info(fileName);
-    Subtitle sub;
+    return stream.read(std::numeric_limits<qint64>::max());
+}
+
+/******************************************************************************/
+
+struct SubtitleStream::Data {
+    QFile file;
+    QTextDecoder *decoder = nullptr;
+    SubtitleParser *parser = nullptr;
+    QList<SubComp> headers; // components found so far without captions
+    bool fed = false;
+};
+
+SubtitleStream::SubtitleStream(const QString &fileName, const EncodingInfo &enc)
+    : d(new Data)
+{
+    d->file.setFileName(fileName);
+    if (!d->file.open(QFile::ReadOnly))
+        return;
+    const auto head = d->file.read(HeadSize);
+    auto codec = QTextCodec::codecForUtfText(head, enc.codec());
+    if (!codec)
+        codec = QTextCodec::codecForLocale();
+    d->decoder = codec->makeDecoder();
+    const auto text = d->decoder->toUnicode(head);
+    const bool last = d->file.atEnd();
+    const QFileInfo info(fileName);
 
     auto name = [] (SubType type) -> QString {
         switch (type) {
@@ -41,22 +84,80 @@ auto SubtitleParser::parse(const QString &fileName,
         }
     };
     auto tryIt = [&] (SubtitleParser *p) {
-        p->m_all = all;
         p->m_file = info;
         p->m_encoding = enc;
+        p->feed(text, last);
         const bool parsable = p->isParsable();
         _Info("Trying (parser: %%, encoding: %%, file: %%): %%",
-               name(p->type()), enc.name(), file.fileName(), parsable);
-        if (parsable)
-            p->_parse(sub);
-        delete p;
+               name(p->type()), enc.name(), fileName, parsable);
+        if (parsable) {
+            p->seekTo(0);
+            d->parser = p;
+            d->fed = true;
+        } else
+            delete p;
         return parsable;
     };
 
     if (tryIt(new SamiParser) || tryIt(new SubRipParser)
             || tryIt(new MicroDVDParser) || tryIt(new TMPlayerParser))
+        return;
+    d->file.close();
+}
+
+SubtitleStream::~SubtitleStream()
+{
+    delete d->parser;
+    delete d->decoder;
+    delete d;
+}
+
+auto SubtitleStream::isOpen() const -> bool
+{
+    return d->parser != nullptr;
+}
+
+auto SubtitleStream::type() const -> SubType
+{
+    return d->parser ? d->parser->type() : SubType::Unknown;
+}
+
+auto SubtitleStream::file() const -> QString
+{
+    return d->file.fileName();
+}
+
+auto SubtitleStream::atEnd() const -> bool
+{
+    return !d->parser || (d->parser->isLast() && !d->fed);
+}
+
+auto SubtitleStream::read(qint64 bytes) -> Subtitle
+{
+    Subtitle sub;
+    if (atEnd())
         return sub;
-    return Subtitle();
+    auto p = d->parser;
+    auto &comps = SubtitleParser::components(sub);
+    comps = d->headers;
+    for (qint64 done = 0;;) {
+        if (d->fed) {
+            p->_parse(sub);
+            d->fed = false;
+        }
+        if (p->isLast() || done >= bytes)
+            break;
+        const auto chunk = d->file.read(ChunkSize);
+        done += chunk.size();
+        p->feed(d->decoder->toUnicode(chunk), chunk.isEmpty() || d->file.atEnd());
+        d->fed = true;
+    }
+    d->headers.clear();
+    for (auto &comp : comps)
+        d->headers.push_back(SubtitleParser::header(comp));
+    if (p->isLast())
+        d->file.close();
+    return sub;
 }
 
 auto SubtitleParser::processLine(int &idx, const QString &texts) -> QStringRef
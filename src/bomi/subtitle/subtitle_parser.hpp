@@ -11,18 +11,25 @@ public:
         { SubtitleParser::msPerChar = msPerChar; }
 protected:
     virtual bool isParsable() const = 0;
+    // parses records which are complete in all() and leaves pos() at first
+    // one which may continue in next chunk unless isLast()
     virtual void _parse(Subtitle &sub) = 0;
     virtual auto type() const -> SubType = 0;
     const QString &all() const { return m_all; }
     auto getLine() const -> QStringRef;
     auto pos() const -> int { return m_pos; }
-    auto atEnd() const -> bool { return m_pos >= m_all.size(); }
+    // end of complete lines
+    auto atEnd() const -> bool { return m_pos >= m_end; }
+    auto isLast() const -> bool { return m_last; }
     auto at(int i) const -> ushort { return m_all.at(i).unicode(); }
     auto seekTo(int pos) const -> void { m_pos = pos; }
     auto skipSeparators() const -> bool
         { return RichTextHelper::skipSeparator(m_pos, m_all); }
     auto file() const -> const QFileInfo& { return m_file; }
     auto append(Subtitle &s, SubComp::SyncType b = SubComp::Time) -> SubComp&;
+    // first component which has been appended in previous chunk or new one
+    auto component(Subtitle &s, SubComp::SyncType b = SubComp::Time) -> SubComp&
+        { return s.m_comp.isEmpty() ? append(s, b) : s.m_comp.first(); }
     static auto predictEndTime(const SubComp::const_iterator &it) -> int;
     static auto predictEndTime(int start, const QString &text) -> int;
     static auto predictEndTime(int start, const QStringRef &text) -> int;
@@ -37,11 +44,44 @@ protected:
     static auto append(SubComp &c, const QString &t, int start, int end) -> void
         { append(c, t, start); c[end]; }
 private:
+    friend class SubtitleStream;
+    // drops consumed text and appends next chunk
+    auto feed(const QString &text, bool last) -> void;
+    // component without captions to collect those of next chunk
+    static auto header(const SubComp &comp) -> SubComp;
     static int msPerChar;
     QString m_all;
     EncodingInfo m_encoding;
     QFileInfo m_file;
     mutable int m_pos = 0;
+    int m_end = 0;
+    bool m_last = false;
+};
+
+// reads subtitle file in chunks without size limit
+// format is sniffed from head of file. decoded text is dropped as soon as
+// parser consumes its records, so memory is bounded by caption data. each
+// read() gives captions of new records in components whose ids are same as
+// in previous reads; merge them by Subtitle::merge().
+
+class SubtitleStream {
+public:
+    static constexpr int HeadSize = 16 << 10;
+    static constexpr int ChunkSize = 64 << 10;
+    SubtitleStream(const QString &file, const EncodingInfo &enc);
+    SubtitleStream(const SubtitleStream &) = delete;
+    SubtitleStream &operator = (const SubtitleStream &) = delete;
+    ~SubtitleStream();
+    // false if file cannot be read or its format is unknown
+    auto isOpen() const -> bool;
+    auto type() const -> SubType;
+    auto file() const -> QString;
+    auto atEnd() const -> bool;
+    // parses at least bytes of file unless it ends
+    auto read(qint64 bytes = ChunkSize) -> Subtitle;
+private:
+    struct Data;
+    Data *d;
 };
 
 #endif // SUBTITLE_PARSER_HPP
@@ -13,23 +13,41 @@ auto SamiParser::isParsable() const -> bool
 auto SamiParser::_parse(Subtitle &sub) -> void
 {
     const QString &text = this->all();
-    sub.clear();
-    int pos = 0;
-    while (pos < text.size()) {
-        const QChar c = text.at(pos);
-        if (c.unicode() != '<') {
-            ++pos;
-            continue;
+    int pos = this->pos();
+    if (!m_body) {
+        while (pos < text.size()) {
+            const QChar c = text.at(pos);
+            if (c.unicode() != '<') {
+                ++pos;
+                continue;
+            }
+            Tag tag = parseTag(text, pos);
+            if (_Same(tag.name, "body")) {
+                m_body = true;
+                break;
+            }
+            if (_Same(tag.name, "sync")) {
+                m_body = true;
+                pos = tag.pos;
+                break;
+            }
         }
-        Tag tag = parseTag(text, pos);
-        if (_Same(tag.name, "body"))
-            break;
-        if (_Same(tag.name, "sync")) {
-            pos = tag.pos;
-            break;
+        if (!m_body && !isLast()) {
+            // header is dropped but tag at boundary may be cut
+            seekTo(qMax(this->pos(), text.size() - 256));
+            return;
+        }
+    }
+    // sync block is complete when next one begins
+    int end = text.size();
+    if (!isLast()) {
+        end = text.lastIndexOf(m_rxSync);
+        if (end <= pos) {
+            seekTo(pos);
+            return;
         }
     }
-    RichTextBlockParser parser(text.midRef(pos));
+    RichTextBlockParser parser(text.midRef(pos, end - pos));
     auto &comps = components(sub);
     while (!parser.atEnd()) {
         Tag tag;
@@ -59,6 +77,7 @@ auto SamiParser::_parse(Subtitle &sub) -> void
             (*comp)[sync] += it.value();
         }
     }
+    seekTo(end);
 }
 
 
@@ -70,19 +89,26 @@ auto SubRipParser::isParsable() const -> bool
 
 auto SubRipParser::_parse(Subtitle &sub) -> void
 {
-    sub.clear();
-    auto &comp = append(sub);
+    auto &comp = component(sub);
     const auto &all = this->all();
-    auto prev = rx.match(all);
-    if (!prev.hasMatch())
+    auto prev = rx.match(all, pos());
+    if (!prev.hasMatch()) {
+        // no timing line can be longer than this
+        seekTo(isLast() ? all.size() : qMax(pos(), all.size() - 256));
         return;
+    }
 
     for(;;) {
         const auto m = rx.match(all, prev.capturedEnd());
+        // text of last caption may continue in next chunk
+        if (!m.hasMatch() && !isLast()) {
+            seekTo(prev.capturedStart());
+            return;
+        }
         const int begin = prev.capturedEnd();
         const int end = m.hasMatch() ? m.capturedStart() : all.size();
         auto caption = all.midRef(begin, end - begin).trimmed().toString();
-        caption.replace(QRegEx(uR"((\r\n|\n|\r|\\N))"_q), u"<br>"_q);
+        caption.replace(m_rxBreak, u"<br>"_q);
         caption.replace("\\h"_a, u"&nbsp;"_q);
         if (caption.isEmpty())
             caption = u"<br>"_q;
@@ -95,6 +121,7 @@ auto SubRipParser::_parse(Subtitle &sub) -> void
             break;
         prev = m;
     }
+    seekTo(all.size());
 }
 
 /******************************************************************************/
@@ -113,19 +140,17 @@ auto LineParser::isParsable() const -> bool
 
 auto TMPlayerParser::_parse(Subtitle &sub) -> void
 {
-    sub.clear();
-    auto &comp = append(sub);
-    int predictedEnd = -1;
+    auto &comp = component(sub);
     while (!atEnd()) {
         auto m = match(getLine().toString());
         if (!m.hasMatch())
             continue;
         auto toInt = [&] (int nth) { return m.capturedRef(nth).toInt(); };
         const int time = _TimeToMSec(toInt(1), toInt(2), toInt(3));
-        if (predictedEnd > 0 && time > predictedEnd)
-            comp[predictedEnd];
+        if (m_predictedEnd > 0 && time > m_predictedEnd)
+            comp[m_predictedEnd];
         auto text = m.capturedRef(4);
-        predictedEnd = predictEndTime(time, text);
+        m_predictedEnd = predictEndTime(time, text);
         append(comp, "<p>"_a % encodeEntity(trim(text)) % "</p>"_a, time);
     }
 }
@@ -133,19 +158,24 @@ auto TMPlayerParser::_parse(Subtitle &sub) -> void
 auto MicroDVDParser::_parse(Subtitle &sub) -> void
 {
     QRegExMatch m;
-    while (!atEnd()) {
-        m = match(trim(getLine()).toString());
-        if (m.hasMatch())
-            break;
+    if (components(sub).isEmpty()) {
+        // text of first line may tell frame rate
+        const int from = pos();
+        while (!atEnd()) {
+            m = match(trim(getLine()).toString());
+            if (m.hasMatch())
+                break;
+        }
+        if (!m.hasMatch()) {
+            seekTo(isLast() ? all().size() : from);
+            return;
+        }
+        m_fps = m.capturedRef(3).toDouble(&m_timed);
+        seekTo(from);
+        append(sub, m_timed ? SubComp::Time : SubComp::Frame);
     }
-    if (!m.hasMatch())
-        return;
-    bool ok = false;
-    const double fps = m.capturedRef(3).toDouble(&ok);
-    auto getKey = [ok, fps] (int frame)
-        { return ok ? qRound((frame/fps)*1000.0) : frame; };
-    seekTo(0);
-    append(sub, ok ? SubComp::Time : SubComp::Frame);
+    auto getKey = [this] (int frame)
+        { return m_timed ? qRound((frame/m_fps)*1000.0) : frame; };
 
     QRegEx rxAttr(uR"(\{([^\}]+):([^\}]+)\})"_q);
     SubComp &comp = components(sub).front();
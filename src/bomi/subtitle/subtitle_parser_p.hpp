@@ -11,6 +11,9 @@ public:
     auto _parse(Subtitle &sub) -> void;
     auto isParsable() const -> bool;
     auto type() const -> SubType { return SubType::SAMI; }
+private:
+    QRegEx m_rxSync{uR"(<\s*sync)"_q, QRegEx::CaseInsensitiveOption};
+    bool m_body = false;
 };
 
 class SubRipParser : public SubtitleParser {
@@ -22,7 +25,7 @@ public:
     auto isParsable() const -> bool;
     auto type() const -> SubType { return SubType::SubRip; }
 private:
-    QRegEx rx;
+    QRegEx rx, m_rxBreak{uR"((\r\n|\n|\r|\\N))"_q};
 };
 
 class LineParser : public SubtitleParser {
@@ -42,6 +45,8 @@ public:
     { }
     auto _parse(Subtitle &sub) -> void;
     auto type() const -> SubType { return SubType::TMPlayer; }
+private:
+    int m_predictedEnd = -1;
 };
 
 class MicroDVDParser : public LineParser {
@@ -49,6 +54,9 @@ public:
     MicroDVDParser(): LineParser(uR"(^\{(\d+)\}\{(\d+)\}(.*)$)"_q) { }
     auto _parse(Subtitle &sub) -> void;
     auto type() const -> SubType { return SubType::MicroDVD; }
+private:
+    double m_fps = 0.0;
+    bool m_timed = false;
 };
 
 #endif // SUBTITLE_PARSER_P_HPP
@@ -0,0 +1,248 @@
+#include "subtitledrawer.hpp"
+#include "subcompindex.hpp"
+#include "misc/benchmark.hpp"
+
+// shadow of SubtitleDrawer::draw() and FastAlphaBlur before vectorization
+namespace Reference {
+
+static auto shadow(QImage &bg, const QImage &image, const QPoint &soffset,
+                   const QColor &color) -> void
+{
+    bg = QImage(image.size(), QImage::Format_ARGB32_Premultiplied);
+    auto dest = bg.bits();
+    const quint32 sr = color.red();
+    const quint32 sg = color.green();
+    const quint32 sb = color.blue();
+    const quint32 sa = color.alpha();
+    for (int y=0; y<bg.height(); ++y) {
+        const int ys = y - soffset.y();
+        if (ys < 0) {
+            memset(dest, 0, bg.bytesPerLine());
+            dest += bg.bytesPerLine();
+        } else {
+            auto src = image.bits() + image.bytesPerLine() * ys;
+            for (int x=0; x<bg.width(); ++x) {
+                const int xs = x-soffset.x();
+                if (xs < 0) {
+                    *dest++ = 0;
+                    *dest++ = 0;
+                    *dest++ = 0;
+                    *dest++ = 0;
+                } else {
+                    *dest++ = sb*sa*src[3] >> 16;
+                    *dest++ = sg*sa*src[3] >> 16;
+                    *dest++ = sr*sa*src[3] >> 16;
+                    *dest++ = sa*   src[3] >> 8;
+                    src += 4;
+                }
+            }
+        }
+    }
+}
+
+static auto blur(QImage &mask, const QColor &color, int radius) -> void
+{
+    const int w = mask.width();
+    const int h = mask.height();
+    QVector<uchar> valpha(w*h), vinv(((radius << 1) + 1) << 8);
+    QVector<int> vmin(qMax(w, h)), vmax(vmin.size());
+    for (int i=0; i<vinv.size(); ++i)
+        vinv[i] = i/((radius << 1) + 1);
+
+    uchar *a = valpha.data();
+    const uchar *inv = vinv.constData();
+    int *min = vmin.data();
+    int *max = vmax.data();
+
+    const int xmax = mask.width()-1;
+    for (int x=0; x<w; ++x) {
+        min[x] = qMin(x + radius + 1, xmax);
+        max[x] = qMax(x - radius, 0);
+    }
+
+    const uchar *c_bits = mask.constBits()+3;
+    uchar *it = a;
+    for (int y=0; y<h; ++y, c_bits += (mask.width() << 2)) {
+        int sum = 0;
+        for(int i=-radius; i<=radius; ++i)
+            sum += c_bits[qBound(0, i, xmax) << 2];
+        for (int x=0; x<w; ++x, ++it) {
+            sum += c_bits[min[x] << 2];
+            sum -= c_bits[max[x] << 2];
+            *it = inv[sum];
+        }
+    }
+
+    const int ymax = mask.height()-1;
+    for (int y=0; y<h; ++y){
+        min[y] = qMin(y + radius + 1, ymax)*w;
+        max[y] = qMax(y - radius, 0)*w;
+    }
+
+    uchar *bits = mask.bits();
+    const double r = color.redF();
+    const double g = color.greenF();
+    const double b = color.blueF();
+    const uchar *c_it = a;
+    for (int x=0; x<w; ++x, ++c_it){
+        int sum = 0;
+        int yp = -radius*w;
+        for(int i=-radius; i<=radius; ++i, yp += w)
+            sum += c_it[qMax(0, yp)];
+        uchar *p = bits + (x << 2);
+        for (int y=0; y<h; ++y, p += (xmax << 2)){
+            const uchar a = inv[sum];
+            if (p[3] < 255) {
+                *p++ = a*b;
+                *p++ = a*g;
+                *p++ = a*r;
+                *p++ = a;
+            } else {
+                p += 4;
+            }
+            sum += c_it[min[y]];
+            sum -= c_it[max[y]];
+        }
+    }
+}
+
+}
+
+// two lines of white text with outline over the width of screen
+// strokes are as thick as glyphs of font at 5% of screen height
+static auto makeCaption(int w, int h) -> QImage
+{
+    QImage image(w * 9 / 10, h * 3 / 20, QImage::Format_ARGB32_Premultiplied);
+    const int stroke = qMax(1, h / 200);
+    for (int y = 0; y < image.height(); ++y) {
+        auto line = (quint32*)image.scanLine(y);
+        for (int x = 0; x < image.width(); ++x) {
+            const int v = (x / stroke * 5 + y / stroke * 3) % 16;
+            const quint32 a = v < 5 ? 255 : v < 7 ? (7 - v) * 100 : 0;
+            line[x] = a << 24 | a << 16 | a << 8 | a;
+        }
+    }
+    return image;
+}
+
+static auto checksum(const QImage &image) -> quint64
+{
+    quint64 hash = 0xcbf29ce484222325ull;
+    for (int y = 0; y < image.height(); ++y)
+        hash = Benchmark::checksum(image.constScanLine(y), image.width() * 4, hash);
+    return hash;
+}
+
+auto benchmarkSubtitleShadow() -> void
+{
+    Benchmark bm(u"subtitle-shadow"_q);
+    const struct { const char *name; int w, h; } sizes[] = {
+        { "720p", 1280, 720 }, { "1080p", 1920, 1080 },
+        { "1440p", 2560, 1440 }, { "2160p", 3840, 2160 }
+    };
+    const QColor color(0, 0, 0, 200);
+    FastAlphaBlur single, multi;
+    single.setThreaded(false);
+    for (auto &s : sizes) {
+        const QString size = _L(s.name);
+        const auto caption = makeCaption(s.w, s.h);
+        const QPoint offset(s.h / 300, s.h / 300);
+        // blur of SubtitleDrawer is 1% of font height
+        const int radius = qMax(1, s.h / 200);
+        QImage old, bg;
+        Reference::shadow(old, caption, offset, color);
+        single.shadow(bg, caption, offset, color);
+        bm.check(size % " shadow"_a, checksum(bg));
+        if (checksum(bg) != checksum(old))
+            qDebug().nospace().noquote() << "  " << size << ": shadow differs";
+        auto nsec = Benchmark::measure([&] () { Reference::shadow(old, caption, offset, color); });
+        bm.report(size % " shadow old"_a, nsec, caption.width() * caption.height(), u"px"_q);
+        nsec = Benchmark::measure([&] () { single.shadow(bg, caption, offset, color); });
+        bm.report(size % " shadow new"_a, nsec, caption.width() * caption.height(), u"px"_q);
+        nsec = Benchmark::measure([&] () { multi.shadow(bg, caption, offset, color); });
+        bm.report(size % " shadow new+threads"_a, nsec, caption.width() * caption.height(), u"px"_q);
+
+        const struct { const char *name; int passes; } blurs[] = {
+            { "box", 1 }, { "gaussian", 3 }
+        };
+        for (auto &b : blurs) {
+            const QString name = size % ' '_q % _L(b.name);
+            auto one = bg, all = bg;
+            single.applyTo(one, color, radius, b.passes);
+            multi.applyTo(all, color, radius, b.passes);
+            bm.check(name, checksum(one));
+            if (checksum(one) != checksum(all))
+                qDebug().nospace().noquote() << "  " << name << ": slices differ";
+            // blur modifies image, so each call takes a fresh copy of shadow
+            QImage mask;
+            if (b.passes == 1) {
+                nsec = Benchmark::measure([&] () {
+                    mask = bg.copy();
+                    Reference::blur(mask, color, radius);
+                });
+                bm.report(name % " old"_a, nsec, bg.width() * bg.height(), u"px"_q);
+            }
+            nsec = Benchmark::measure([&] () {
+                mask = bg.copy();
+                single.applyTo(mask, color, radius, b.passes);
+            });
+            bm.report(name % " new"_a, nsec, bg.width() * bg.height(), u"px"_q);
+            nsec = Benchmark::measure([&] () {
+                mask = bg.copy();
+                multi.applyTo(mask, color, radius, b.passes);
+            });
+            bm.report(name % " new+threads"_a, nsec, bg.width() * bg.height(), u"px"_q);
+        }
+    }
+}
+
+static auto caption(const char *text) -> SubCapt
+{
+    SubCapt capt;
+    capt += RichTextDocument(_L(text));
+    return capt;
+}
+
+// previous() and next() over two components which interleave
+// next is the nearest caption of any component, not the furthest of each
+auto benchmarkSubtitleIndex() -> void
+{
+    Benchmark bm(u"subtitle-index"_q);
+    SubComp a, b;
+    a.insert(1000, caption("a1"));
+    a.insert(3000, SubCapt());
+    a.insert(5000, caption("a2"));
+    a.insert(9000, caption("a3"));
+    b.insert(2000, caption("b1"));
+    b.insert(4000, caption("b2"));
+    b.insert(7000, SubCapt());
+    const SubCompIndex index({ SubCompIndex(&a, 0.0), SubCompIndex(&b, 0.0) });
+    const struct { int time, previous, next; } cases[] = {
+        { 500, -1, 1000 }, { 2500, 1000, 4000 },
+        { 4500, 2000, 5000 }, { 9500, 5000, -1 }
+    };
+    quint64 hash = 0xcbf29ce484222325ull;
+    for (auto &c : cases) {
+        const int found[] = { index.previous(c.time), index.next(c.time) };
+        hash = Benchmark::checksum(found, sizeof(found), hash);
+        if (found[0] != c.previous || found[1] != c.next)
+            qDebug().nospace() << "  at " << c.time << ": previous/next are "
+                << found[0] << '/' << found[1] << " instead of "
+                << c.previous << '/' << c.next;
+    }
+    bm.check(u"previous/next"_q, hash);
+
+    // an hour of captions every 2 seconds in each of two components
+    SubComp long1, long2;
+    for (int t = 0; t < 3600 * 1000; t += 2000) {
+        long1.insert(t, caption("words"));
+        long2.insert(t + 700, caption("words"));
+    }
+    const SubCompIndex merged({ SubCompIndex(&long1, 0.0), SubCompIndex(&long2, 0.0) });
+    int time = 0, sum = 0;
+    const auto nsec = Benchmark::measure([&] () {
+        time = (time + 7919) % (3600 * 1000);
+        sum += merged.previous(time) + merged.next(time);
+    });
+    bm.report(u"1h previous+next"_q, nsec, 1, u"lookup"_q);
+}
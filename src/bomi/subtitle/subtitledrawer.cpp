@@ -1,4 +1,6 @@
 #include "subtitledrawer.hpp"
+#include "misc/simd.hpp"
+#include "misc/slicepool.hpp"
 
 SubCompImage::SubCompImage(const SubComp *comp, Iterator it, void *creator)
     : m_comp(comp)
@@ -79,7 +81,9 @@ auto SubtitleDrawer::draw(QImage &image, int &gap, const RichTextDocument &text,
     if (m_style.shadow.enabled)
         soffset = (fscale*m_style.shadow.offset).toPoint();
     QPoint offset(0, 0);
-    const int blur = m_style.shadow.blur ? qRound(fscale*0.01) : 0;
+    // shadow is padded by the radius which applyTo() really uses
+    const int blur = m_style.shadow.blur
+            ? qMin(qRound(fscale*0.01), FastAlphaBlur::MaxRadius) : 0;
     const auto nsize = front.naturalSize()*scale;
     QSize imageSize(nsize.width() + 1, nsize.height() + 1);
     QPoint pad = soffset;
@@ -108,37 +112,8 @@ auto SubtitleDrawer::draw(QImage &image, int &gap, const RichTextDocument &text,
         front.draw(&painter, QPointF(0, 0));
         painter.end();
         if (m_style.shadow.enabled) {
-            QImage bg(image.size(), QImage::Format_ARGB32_Premultiplied);
-            bg.setDevicePixelRatio(dpr);
-            auto dest = bg.bits();
-            const quint32 sr = m_style.shadow.color.red();
-            const quint32 sg = m_style.shadow.color.green();
-            const quint32 sb = m_style.shadow.color.blue();
-            const quint32 sa = m_style.shadow.color.alpha();
-            for (int y=0; y<bg.height(); ++y) {
-                const int ys = y - soffset.y();
-                if (ys < 0) {
-                    memset(dest, 0, bg.bytesPerLine());
-                    dest += bg.bytesPerLine();
-                } else {
-                    auto src = image.bits() + image.bytesPerLine() * ys;
-                    for (int x=0; x<bg.width(); ++x) {
-                        const int xs = x-soffset.x();
-                        if (xs < 0) {
-                            *dest++ = 0;
-                            *dest++ = 0;
-                            *dest++ = 0;
-                            *dest++ = 0;
-                        } else {
-                            *dest++ = sb*sa*src[3] >> 16;
-                            *dest++ = sg*sa*src[3] >> 16;
-                            *dest++ = sr*sa*src[3] >> 16;
-                            *dest++ = sa*   src[3] >> 8;
-                            src += 4;
-                        }
-                    }
-                }
-            }
+            QImage bg;
+            m_blur.shadow(bg, image, soffset, m_style.shadow.color);
             if (blur)
                 m_blur.applyTo(bg, m_style.shadow.color, blur);
             painter.begin(&bg);
@@ -161,3 +136,375 @@ auto SubtitleDrawer::draw(QImage &image, int &gap, const RichTextDocument &text,
     }
     return bboxes;
 }
+
+/******************************************************************************/
+
+// Pixels are 0xAARRGGBB words. Shadow is (color * alpha * a) >> 16 in integers
+// as before. Box sums stay below 2^16 for radius up to 127 and are divided by
+// multiplying with 2^16/range rounded up and saturated, so every path gives
+// same result.
+
+constexpr int FastAlphaBlur::MaxRadius;
+
+// coef is blue, green and red multiplied by alpha of color and alpha itself
+SIA shadowPel(quint32 p, const quint32 *coef) -> quint32
+{
+    const quint32 a = p >> 24;
+    return (a * coef[0] >> 16) | (a * coef[1] >> 16) << 8
+            | (a * coef[2] >> 16) << 16 | (a * coef[3] >> 8) << 24;
+}
+
+// round(a * c / 255) for a and c in [0, 255]
+SIA premultiply(quint32 a, quint32 c) -> quint32
+{
+    const auto t = a * c + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+// opaque pixels of shadow are not blurred
+SIA composePel(quint32 p, quint32 a, const quint32 *color) -> quint32
+{
+    if ((p >> 24) == 255)
+        return p;
+    return premultiply(a, color[0]) | premultiply(a, color[1]) << 8
+            | premultiply(a, color[2]) << 16 | a << 24;
+}
+
+SIA quotient(quint32 sum, quint32 half, quint32 m) -> uchar
+    { return qMin<quint32>((sum + half) * m >> 16, 255); }
+
+#ifdef SIMD_HAS_SSE2
+// 4 pixels in 32-bit lanes and 8 sums in 16-bit lanes
+// products of 8-bit values are taken in low words while high words are zero
+struct Alpha128 {
+    using V = __m128i;
+    SCA Pixels = 4;
+    SCA Samples = 8;
+    SIA load(const void *p) -> V { return _mm_loadu_si128((const V*)p); }
+    SIA store(void *p, V v) -> void { _mm_storeu_si128((V*)p, v); }
+    SIA bytes(const uchar *p) -> V
+        { return _mm_unpacklo_epi8(_mm_loadl_epi64((const V*)p), _mm_setzero_si128()); }
+    SIA shadow(quint32 *dst, const quint32 *src, const quint32 *coef) -> void
+    {
+        const auto a = _mm_srli_epi32(load(src), 24);
+        const auto b = _mm_mulhi_epu16(a, _mm_set1_epi32(coef[0]));
+        const auto g = _mm_mulhi_epu16(a, _mm_set1_epi32(coef[1]));
+        const auto r = _mm_mulhi_epu16(a, _mm_set1_epi32(coef[2]));
+        const auto o = _mm_srli_epi32(_mm_mullo_epi16(a, _mm_set1_epi32(coef[3])), 8);
+        store(dst, _mm_or_si128(_mm_or_si128(b, _mm_slli_epi32(g, 8)),
+                                _mm_or_si128(_mm_slli_epi32(r, 16), _mm_slli_epi32(o, 24))));
+    }
+    SIA alpha(uchar *dst, const quint32 *src) -> void
+    {
+        const auto a = _mm_srli_epi32(load(src), 24);
+        const auto w = _mm_packs_epi32(a, a);
+        const int v = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+        memcpy(dst, &v, 4);
+    }
+    SIA add(quint16 *sum, const uchar *row) -> void
+        { store(sum, _mm_add_epi16(load(sum), bytes(row))); }
+    SIA column(uchar *dst, quint16 *sum, const uchar *add, const uchar *sub,
+               int half, int m) -> void
+    {
+        auto s = load(sum);
+        const auto q = _mm_mulhi_epu16(_mm_add_epi16(s, _mm_set1_epi16(half)),
+                                       _mm_set1_epi16(m));
+        _mm_storel_epi64((V*)dst, _mm_packus_epi16(q, q));
+        s = _mm_sub_epi16(_mm_add_epi16(s, bytes(add)), bytes(sub));
+        store(sum, s);
+    }
+    SIA premultiply(V a, quint32 c) -> V
+    {
+        const auto t = _mm_add_epi16(_mm_mullo_epi16(a, _mm_set1_epi32(c)),
+                                     _mm_set1_epi32(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+    SIA compose(quint32 *dst, const uchar *alpha, const quint32 *color) -> void
+    {
+        int v;
+        memcpy(&v, alpha, 4);
+        const auto z = _mm_setzero_si128();
+        const auto a = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), z), z);
+        auto p = _mm_or_si128(premultiply(a, color[0]),
+                              _mm_slli_epi32(premultiply(a, color[1]), 8));
+        p = _mm_or_si128(p, _mm_slli_epi32(premultiply(a, color[2]), 16));
+        p = _mm_or_si128(p, _mm_slli_epi32(a, 24));
+        const auto old = load(dst);
+        const auto keep = _mm_cmpeq_epi32(_mm_srli_epi32(old, 24), _mm_set1_epi32(255));
+        store(dst, _mm_or_si128(_mm_and_si128(keep, old), _mm_andnot_si128(keep, p)));
+    }
+};
+#endif
+
+#ifdef SIMD_HAS_AVX2
+// pack works within 128-bit lanes, so packed halves are gathered by permute
+struct Alpha256 {
+    using V = __m256i;
+    SCA Pixels = 8;
+    SCA Samples = 16;
+    SIMD_AVX2 SIA load(const void *p) -> V { return _mm256_loadu_si256((const V*)p); }
+    SIMD_AVX2 SIA store(void *p, V v) -> void { _mm256_storeu_si256((V*)p, v); }
+    SIMD_AVX2 SIA bytes(const uchar *p) -> V
+        { return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p)); }
+    SIMD_AVX2 SIA shadow(quint32 *dst, const quint32 *src, const quint32 *coef) -> void
+    {
+        const auto a = _mm256_srli_epi32(load(src), 24);
+        const auto b = _mm256_mulhi_epu16(a, _mm256_set1_epi32(coef[0]));
+        const auto g = _mm256_mulhi_epu16(a, _mm256_set1_epi32(coef[1]));
+        const auto r = _mm256_mulhi_epu16(a, _mm256_set1_epi32(coef[2]));
+        const auto o = _mm256_srli_epi32(_mm256_mullo_epi16(a, _mm256_set1_epi32(coef[3])), 8);
+        store(dst, _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(g, 8)),
+                                   _mm256_or_si256(_mm256_slli_epi32(r, 16),
+                                                   _mm256_slli_epi32(o, 24))));
+    }
+    SIMD_AVX2 SIA alpha(uchar *dst, const quint32 *src) -> void
+    {
+        const auto a = _mm256_srli_epi32(load(src), 24);
+        const auto w = _mm256_packus_epi32(a, a);
+        const auto b = _mm256_packus_epi16(w, w);
+        _mm_storel_epi64((__m128i*)dst, _mm_unpacklo_epi32(_mm256_castsi256_si128(b),
+                                                           _mm256_extracti128_si256(b, 1)));
+    }
+    SIMD_AVX2 SIA add(quint16 *sum, const uchar *row) -> void
+        { store(sum, _mm256_add_epi16(load(sum), bytes(row))); }
+    SIMD_AVX2 SIA column(uchar *dst, quint16 *sum, const uchar *add, const uchar *sub,
+                         int half, int m) -> void
+    {
+        auto s = load(sum);
+        const auto q = _mm256_mulhi_epu16(_mm256_add_epi16(s, _mm256_set1_epi16(half)),
+                                          _mm256_set1_epi16(m));
+        const auto p = _mm256_permute4x64_epi64(_mm256_packus_epi16(q, q), 0xd8);
+        _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(p));
+        s = _mm256_sub_epi16(_mm256_add_epi16(s, bytes(add)), bytes(sub));
+        store(sum, s);
+    }
+    SIMD_AVX2 SIA premultiply(V a, quint32 c) -> V
+    {
+        const auto t = _mm256_add_epi16(_mm256_mullo_epi16(a, _mm256_set1_epi32(c)),
+                                        _mm256_set1_epi32(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+    SIMD_AVX2 SIA compose(quint32 *dst, const uchar *alpha, const quint32 *color) -> void
+    {
+        const auto a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)alpha));
+        auto p = _mm256_or_si256(premultiply(a, color[0]),
+                                 _mm256_slli_epi32(premultiply(a, color[1]), 8));
+        p = _mm256_or_si256(p, _mm256_slli_epi32(premultiply(a, color[2]), 16));
+        p = _mm256_or_si256(p, _mm256_slli_epi32(a, 24));
+        const auto old = load(dst);
+        const auto keep = _mm256_cmpeq_epi32(_mm256_srli_epi32(old, 24),
+                                             _mm256_set1_epi32(255));
+        store(dst, _mm256_blendv_epi8(p, old, keep));
+    }
+};
+#endif
+
+struct AlphaPel { }; // no vector part
+
+template<class A>
+static auto shadow(quint32 *dst, const quint32 *src, int n, const quint32 *coef) -> void
+{
+    int i = 0;
+#ifdef SIMD_HAS_SSE2
+    for (; i + A::Pixels <= n; i += A::Pixels)
+        A::shadow(dst + i, src + i, coef);
+#endif
+    for (; i < n; ++i)
+        dst[i] = shadowPel(src[i], coef);
+}
+
+template<class A>
+static auto alpha(uchar *dst, const quint32 *src, int n) -> void
+{
+    int i = 0;
+#ifdef SIMD_HAS_SSE2
+    for (; i + A::Pixels <= n; i += A::Pixels)
+        A::alpha(dst + i, src + i);
+#endif
+    for (; i < n; ++i)
+        dst[i] = src[i] >> 24;
+}
+
+template<class A>
+static auto add(quint16 *sum, const uchar *row, int n) -> void
+{
+    int i = 0;
+#ifdef SIMD_HAS_SSE2
+    for (; i + A::Samples <= n; i += A::Samples)
+        A::add(sum + i, row + i);
+#endif
+    for (; i < n; ++i)
+        sum[i] += row[i];
+}
+
+// writes quotients of sums and slides them down by a row
+template<class A>
+static auto column(uchar *dst, quint16 *sum, const uchar *add, const uchar *sub,
+                   int n, int half, int m) -> void
+{
+    int i = 0;
+#ifdef SIMD_HAS_SSE2
+    for (; i + A::Samples <= n; i += A::Samples)
+        A::column(dst + i, sum + i, add + i, sub + i, half, m);
+#endif
+    for (; i < n; ++i) {
+        dst[i] = quotient(sum[i], half, m);
+        sum[i] += add[i] - sub[i];
+    }
+}
+
+template<class A>
+static auto compose(quint32 *dst, const uchar *alpha, int n, const quint32 *color) -> void
+{
+    int i = 0;
+#ifdef SIMD_HAS_SSE2
+    for (; i + A::Pixels <= n; i += A::Pixels)
+        A::compose(dst + i, alpha + i, color);
+#endif
+    for (; i < n; ++i)
+        dst[i] = composePel(dst[i], alpha[i], color);
+}
+
+// a sum runs along the row, so this pass has no vector part
+static auto boxRow(uchar *dst, const uchar *src, int n, int radius, int half, int m) -> void
+{
+    const int last = n - 1;
+    int sum = src[0] * (radius + 1);
+    for (int i = 1; i <= radius; ++i)
+        sum += src[qMin(i, last)];
+    for (int x = 0; x < n; ++x) {
+        dst[x] = quotient(sum, half, m);
+        sum += src[qMin(x + radius + 1, last)] - src[qMax(x - radius, 0)];
+    }
+}
+
+// n is in pixels for shadow, alpha and compose and in samples for the others
+struct AlphaKernels {
+    auto (*shadow)(quint32 *dst, const quint32 *src, int n, const quint32 *coef) -> void;
+    auto (*alpha)(uchar *dst, const quint32 *src, int n) -> void;
+    auto (*add)(quint16 *sum, const uchar *row, int n) -> void;
+    auto (*column)(uchar *dst, quint16 *sum, const uchar *add, const uchar *sub,
+                   int n, int half, int m) -> void;
+    auto (*compose)(quint32 *dst, const uchar *alpha, int n, const quint32 *color) -> void;
+};
+
+#ifdef SIMD_HAS_AVX2
+SIMD_AVX2_ENTRY static auto shadowAvx2(quint32 *dst, const quint32 *src, int n,
+                                       const quint32 *coef) -> void
+    { shadow<Alpha256>(dst, src, n, coef); }
+SIMD_AVX2_ENTRY static auto alphaAvx2(uchar *dst, const quint32 *src, int n) -> void
+    { alpha<Alpha256>(dst, src, n); }
+SIMD_AVX2_ENTRY static auto addAvx2(quint16 *sum, const uchar *row, int n) -> void
+    { add<Alpha256>(sum, row, n); }
+SIMD_AVX2_ENTRY static auto columnAvx2(uchar *dst, quint16 *sum, const uchar *add,
+                                       const uchar *sub, int n, int half, int m) -> void
+    { column<Alpha256>(dst, sum, add, sub, n, half, m); }
+SIMD_AVX2_ENTRY static auto composeAvx2(quint32 *dst, const uchar *alpha, int n,
+                                        const quint32 *color) -> void
+    { compose<Alpha256>(dst, alpha, n, color); }
+#endif
+
+static auto alphaKernels() -> const AlphaKernels&
+{
+    static const AlphaKernels k = [] () {
+#ifdef SIMD_HAS_SSE2
+        using A = Alpha128;
+#else
+        using A = AlphaPel;
+#endif
+        AlphaKernels k = { shadow<A>, alpha<A>, add<A>, column<A>, compose<A> };
+#ifdef SIMD_HAS_AVX2
+        if (Simd::isa() == Simd::Avx2)
+            k = { shadowAvx2, alphaAvx2, addAvx2, columnAvx2, composeAvx2 };
+#endif
+        return k;
+    }();
+    return k;
+}
+
+// slices have about 64K pixels at least
+static auto slice(bool threaded, int rows, int width,
+                  const std::function<void(int from, int to)> &func) -> void
+{
+    if (threaded)
+        SlicePool::instance().run(rows, 1, qMax(8, (1 << 16) / qMax(1, width)), func);
+    else
+        func(0, rows);
+}
+
+auto FastAlphaBlur::shadow(QImage &dst, const QImage &src, const QPoint &offset,
+                           const QColor &color) const -> void
+{
+    dst = QImage(src.size(), QImage::Format_ARGB32_Premultiplied);
+    dst.setDevicePixelRatio(src.devicePixelRatio());
+    if (dst.isNull())
+        return;
+    const quint32 sa = color.alpha();
+    const quint32 coef[] = { color.blue() * sa, color.green() * sa,
+                             color.red() * sa, sa };
+    const int w = dst.width(), dx = qBound(0, offset.x(), w);
+    const auto &k = alphaKernels();
+    // scanLine() of non-const image is not thread-safe
+    const auto bits = dst.bits();
+    slice(m_threaded, dst.height(), w, [&] (int from, int to) {
+        for (int y = from; y < to; ++y) {
+            auto line = (quint32*)(bits + y * dst.bytesPerLine());
+            const int ys = y - offset.y();
+            if (ys < 0) {
+                memset(line, 0, w * 4);
+                continue;
+            }
+            memset(line, 0, dx * 4);
+            k.shadow(line + dx, (const quint32*)src.constScanLine(ys), w - dx, coef);
+        }
+    });
+}
+
+auto FastAlphaBlur::applyTo(QImage &mask, const QColor &color, int radius,
+                            int passes) -> void
+{
+    if (radius < 1 || passes < 1 || mask.isNull())
+        return;
+    radius = qMin(radius, MaxRadius);
+    const int w = mask.width(), h = mask.height(), range = radius * 2 + 1;
+    const int half = range / 2, m = ((1 << 16) + range - 1) / range;
+    const quint32 rgb[] = { quint32(color.blue()), quint32(color.green()),
+                            quint32(color.red()) };
+    const auto &k = alphaKernels();
+    m_planes.resize(w * h * 2);
+    const auto bits = mask.bits();
+    uchar *planes[] = { m_planes.data(), m_planes.data() + w * h };
+
+    // horizontal passes of a row ping-pong between planes and end up in first
+    slice(m_threaded, h, w, [&] (int from, int to) {
+        for (int y = from; y < to; ++y) {
+            auto a = planes[0] + y * w, b = planes[1] + y * w;
+            k.alpha(a, (const quint32*)(bits + y * mask.bytesPerLine()), w);
+            for (int i = 0; i < passes; ++i) {
+                boxRow(b, a, w, radius, half, m);
+                std::swap(a, b);
+            }
+            if (a != planes[0] + y * w)
+                memcpy(planes[0] + y * w, a, w);
+        }
+    });
+    // vertical passes need every row of previous one
+    for (int i = 0; i < passes; ++i) {
+        const uchar *in = planes[0];
+        uchar *out = planes[1];
+        const bool last = i + 1 == passes;
+        slice(m_threaded, h, w, [&] (int from, int to) {
+            std::vector<quint16> sum(w, 0);
+            auto line = [&] (int y) { return in + qBound(0, y, h - 1) * w; };
+            for (int y = from - radius; y <= from + radius; ++y)
+                k.add(sum.data(), line(y), w);
+            for (int y = from; y < to; ++y) {
+                k.column(out + y * w, sum.data(), line(y + radius + 1),
+                         line(y - radius), w, half, m);
+                if (last)
+                    k.compose((quint32*)(bits + y * mask.bytesPerLine()), out + y * w, w, rgb);
+            }
+        });
+        std::swap(planes[0], planes[1]);
+    }
+}
@@ -9,103 +9,29 @@ struct Margin {
     Margin(const QPointF &tl, const QPointF &br)
         : top(tl.y()), right(br.x()), bottom(br.y()), left(tl.x()) {}
     double top = 0.0, right = 0.0, bottom = 0.0, left = 0.0;
+    DECL_EQ(Margin, &T::top, &T::right, &T::bottom, &T::left)
 };
 
+// drop shadow of caption and blur of it in ARGB32 premultiplied images
+// pixels are processed with vector instructions. a box pass slides sums along
+// rows and then down columns in 8-bit planes, and repeated passes come close
+// to Gaussian. rows of large images are split into slices on a shared pool.
 class FastAlphaBlur {
 public:
-    FastAlphaBlur(): radius(-1) {}
-    // copied from openframeworks superfast blur and modified
-    auto applyTo(QImage &mask, const QColor &color, int radius) -> void {
-        if (radius < 1 || mask.isNull())
-            return;
-        setSize(mask.size());
-        setRadius(radius);
-        const int w = s.width();
-        const int h = s.height();
-
-        uchar *a = valpha.data();
-        const uchar *inv = vinv.constData();
-        int *min = vmin.data();
-        int *max = vmax.data();
-
-        const int xmax = mask.width()-1;
-        for (int x=0; x<w; ++x) {
-            min[x] = qMin(x + radius + 1, xmax);
-            max[x] = qMax(x - radius, 0);
-        }
-
-        const uchar *c_bits = mask.constBits()+3;
-        uchar *it = a;
-        for (int y=0; y<h; ++y, c_bits += (mask.width() << 2)) {
-            int sum = 0;
-            for(int i=-radius; i<=radius; ++i)
-                sum += c_bits[qBound(0, i, xmax) << 2];
-            for (int x=0; x<w; ++x, ++it) {
-                sum += c_bits[min[x] << 2];
-                sum -= c_bits[max[x] << 2];
-                *it = inv[sum];
-            }
-        }
-
-        const int ymax = mask.height()-1;
-        for (int y=0; y<h; ++y){
-            min[y] = qMin(y + radius + 1, ymax)*w;
-            max[y] = qMax(y - radius, 0)*w;
-        }
-
-        uchar *bits = mask.bits();
-        const double r = color.redF();
-        const double g = color.greenF();
-        const double b = color.blueF();
-        const uchar *c_it = a;
-        for (int x=0; x<w; ++x, ++c_it){
-            int sum = 0;
-            int yp = -radius*w;
-            for(int i=-radius; i<=radius; ++i, yp += w)
-                sum += c_it[qMax(0, yp)];
-            uchar *p = bits + (x << 2);
-            for (int y=0; y<h; ++y, p += (xmax << 2)){
-                const uchar a = inv[sum];
-                if (p[3] < 255) {
-                    *p++ = a*b;
-                    *p++ = a*g;
-                    *p++ = a*r;
-                    *p++ = a;
-                } else {
-                    p += 4;
-                }
-                sum += c_it[min[y]];
-                sum -= c_it[max[y]];
-            }
-        }
-    }
-
+    // box sums of alpha have to fit in 16 bits
+    static constexpr int MaxRadius = 127;
+    // alpha of src moved by non-negative offset and painted in color
+    auto shadow(QImage &dst, const QImage &src, const QPoint &offset,
+                const QColor &color) const -> void;
+    // blurs alpha of mask and paints it in color except opaque pixels
+    // radius is clamped to MaxRadius
+    auto applyTo(QImage &mask, const QColor &color, int radius,
+                 int passes = 1) -> void;
+    // false to run in calling thread only
+    auto setThreaded(bool threaded) -> void { m_threaded = threaded; }
 private:
-    auto setSize(const QSize &size) -> void {
-        if (size != s) {
-            s = size;
-            if (!s.isEmpty()) {
-                vmin.resize(qMax(s.width(), s.height()));
-                vmax.resize(vmin.size());
-                valpha.resize(s.width()*s.height());
-            }
-        }
-    }
-    auto setRadius(const int radius) -> void {
-        if (this->radius != radius) {
-            this->radius = radius;
-            if (radius > 0) {
-                const int range = (radius << 1) + 1;
-                vinv.resize(range << 8);
-                for (int i=0; i<vinv.size(); ++i)
-                    vinv[i] = i/range;
-            }
-        }
-    }
-    int radius;
-    QSize s;
-    QVector<int> vmin, vmax;
-    QVector<uchar> valpha, vinv;
+    QVector<uchar> m_planes;
+    bool m_threaded = true;
 };
 
 class SubCompImage : public QImage {
@@ -133,6 +59,12 @@ private:
 
 class SubtitleDrawer {
 public:
+    // same style of drawing
+    auto operator == (const SubtitleDrawer &rhs) const -> bool
+        { return m_style == rhs.m_style && m_margin == rhs.m_margin
+                 && m_alignment == rhs.m_alignment; }
+    auto operator != (const SubtitleDrawer &rhs) const -> bool
+        { return !operator == (rhs); }
     auto setStyle(const OsdStyle &style) -> void;
     auto setAlignment(Qt::Alignment alignment) -> void;
     auto setMargin(const Margin &margin) -> void { m_margin = margin; }
@@ -0,0 +1,75 @@
+#include "subtitleloader.hpp"
+#include "subtitle_parser.hpp"
+#include "misc/log.hpp"
+#include <QThreadPool>
+
+DECLARE_LOG_CONTEXT(Subtitle)
+
+class StreamRunnable : public QRunnable {
+public:
+    StreamRunnable(SubtitleLoader *loader, SubtitleStream *stream,
+                   const QAtomicInt *generation)
+        : m_loader(loader), m_stream(stream), m_generation(generation)
+        , m_started(generation->load()) { }
+    ~StreamRunnable() { delete m_stream; }
+private:
+    auto isCanceled() const -> bool { return m_generation->load() != m_started; }
+    auto run() -> void final;
+    SubtitleLoader *m_loader;
+    SubtitleStream *m_stream;
+    const QAtomicInt *m_generation;
+    int m_started = 0;
+};
+
+auto StreamRunnable::run() -> void
+{
+    while (!m_stream->atEnd() && !isCanceled()) {
+        const auto sub = m_stream->read(SubtitleLoader::BatchSize);
+        if (isCanceled())
+            return;
+        emit m_loader->parsed(sub.components().toVector());
+    }
+    if (isCanceled())
+        return;
+    _Info("Finished to load %%", m_stream->file());
+    emit m_loader->finished(QFileInfo(m_stream->file()).absoluteFilePath());
+}
+
+struct SubtitleLoader::Data {
+    QThreadPool pool;
+    QAtomicInt generation{0};
+};
+
+SubtitleLoader::SubtitleLoader(QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    qRegisterMetaType<QVector<SubComp>>();
+    d->pool.setMaxThreadCount(1);
+}
+
+SubtitleLoader::~SubtitleLoader()
+{
+    cancel();
+    d->pool.waitForDone();
+    delete d;
+}
+
+auto SubtitleLoader::load(const QString &file, const EncodingInfo &enc) -> Subtitle
+{
+    auto stream = new SubtitleStream(file, enc);
+    Subtitle sub;
+    // long header may hide first caption
+    while (sub.isEmpty() && !stream->atEnd())
+        sub.merge(stream->read(HeadSize));
+    if (stream->atEnd())
+        delete stream;
+    else
+        d->pool.start(new StreamRunnable(this, stream, &d->generation));
+    _Info("Load %% with %%: %%", file, enc.name(), sub.isEmpty() ? "failed" : "succeeded");
+    return sub;
+}
+
+auto SubtitleLoader::cancel() -> void
+{
+    d->generation.ref();
+}
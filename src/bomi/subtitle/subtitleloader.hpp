@@ -0,0 +1,33 @@
+#ifndef SUBTITLELOADER_HPP
+#define SUBTITLELOADER_HPP
+
+#include "subtitle.hpp"
+
+Q_DECLARE_METATYPE(QVector<SubComp>)
+
+// loads subtitle files without waiting for whole of them
+// head of file is parsed at once and playback can start with its captions.
+// rest is parsed in background and delivered by parsed() in batches of
+// captions which should be merged into components of same id.
+
+class SubtitleLoader : public QObject {
+    Q_OBJECT
+public:
+    static constexpr qint64 HeadSize = 1 << 20;
+    static constexpr qint64 BatchSize = 1 << 20;
+    SubtitleLoader(QObject *parent = nullptr);
+    ~SubtitleLoader();
+    // thread-safe; empty if format is unknown
+    auto load(const QString &file, const EncodingInfo &enc) -> Subtitle;
+    // stops files in progress; thread-safe
+    auto cancel() -> void;
+signals:
+    void parsed(const QVector<SubComp> &captions);
+    // absolute path of file after its last parsed() unless canceled
+    void finished(const QString &file);
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // SUBTITLELOADER_HPP
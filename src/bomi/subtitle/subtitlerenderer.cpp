@@ -1,10 +1,14 @@
 #include "subtitlerenderer.hpp"
 #include "subtitlerenderingthread.hpp"
+#include "shelfpacker.hpp"
 #include "misc/dataevent.hpp"
+#include "misc/log.hpp"
 #include "enum/autoselectmode.hpp"
 #include "opengl/opengltexture2d.hpp"
 #include "opengl/opengltexturebinder.hpp"
 
+DECLARE_LOG_CONTEXT(Subtitle)
+
 struct SubtitleShaderData : public SubtitleRenderer::ShaderData {
     const OpenGLTexture2D *texture, *bbox;
     QColor bboxColor;
@@ -58,6 +62,9 @@ struct SubtitleRenderer::Data {
     Data(SubtitleRenderer *p): p(p) {}
     SubtitleRenderer *p = nullptr;
     QList<SubComp*> loaded;
+    QVector<SubComp> pending; // captions of components not loaded yet
+    SubCompIndex index; // of selection
+    bool reindex = true;
     QSize imageSize{0, 0};
     SubtitleDrawer drawer;
     int delay = 0, msec = 0, lastTime = -1;
@@ -75,6 +82,16 @@ struct SubtitleRenderer::Data {
     QVector<quint32> zeros, bboxData;
     SubCompSelection selection{p};
     OpenGLTexture2D bbox;
+    // captions stay in atlas while they are shown and are found by cache key
+    // of image. pixels left by released slots are cleared only where a new
+    // slot overlaps them.
+    struct Slot { qint64 key; QRect rect; }; // rect has 1px transparent border
+    struct Quad { QRectF frame, tex; };      // frame is in pixels of imageSize
+    QSize atlas{0, 0};
+    ShelfPacker packer;
+    QVector<Slot> slots;
+    QVector<Quad> quads;
+    QRegion stale, staleBoxes;
 
     auto find(int id) const -> SubComp*
     {
@@ -85,12 +102,36 @@ struct SubtitleRenderer::Data {
         return nullptr;
     }
 
+    auto claim(SubComp *comp) -> void
+    {
+        for (int i = 0; i < pending.size(); ) {
+            if (pending[i].id() == comp->id()) {
+                comp->merge(pending[i]);
+                pending.remove(i);
+            } else
+                ++i;
+        }
+    }
+
+    auto indexed() -> const SubCompIndex&
+    {
+        if (reindex) {
+            QVector<SubCompIndex> indexes;
+            selection.forComponents([&] (const SubComp &comp)
+                                    { indexes.push_back({ &comp, fps() }); });
+            index = SubCompIndex(indexes);
+            reindex = false;
+        }
+        return index;
+    }
+
     double fps() const { return selection.fps(); }
     void updateDrawer() {
         selection.setDrawer(drawer);
         p->reserve(UpdateGeometry);
     }
     void sort() {
+        reindex = true;
         selection.sort([this] (const SubComp &lhs, const SubComp &rhs) {
             return language_priority(lhs) > language_priority(rhs);
         });
@@ -100,6 +141,7 @@ struct SubtitleRenderer::Data {
         p->reserve(UpdateGeometry);
     }
     void applySelection() {
+        reindex = true;
         empty = selection.isEmpty();
         emit p->selectionChanged();
         if (!empty)
@@ -115,8 +157,123 @@ struct SubtitleRenderer::Data {
     void updateVisible() {
         p->setVisible(!hidden && !empty && !imageSize.isEmpty());
     }
+    auto resetAtlas(const QSize &size) -> void
+    {
+        atlas = size;
+        packer.reset(size);
+        slots.clear();
+        stale = staleBoxes = QRegion(QRect({0, 0}, size));
+    }
+    auto findSlot(qint64 key) const -> int
+    {
+        for (int i = 0; i < slots.size(); ++i) {
+            if (slots[i].key == key)
+                return i;
+        }
+        return -1;
+    }
+    auto clear(OpenGLTexture2D *texture, const QRegion &region) -> void
+    {
+        for (auto &rect : region.rects()) {
+            _Expand(zeros, rect.width() * rect.height());
+            texture->upload(rect, zeros.data());
+        }
+    }
+    auto upload(OpenGLTexture2D *texture, const Slot &slot,
+                const SubCompImage &image) -> void;
+    auto place(OpenGLTexture2D *texture, const QVector<const SubCompImage*> &images) -> void;
 };
 
+auto SubtitleRenderer::Data::upload(OpenGLTexture2D *texture, const Slot &slot,
+                                    const SubCompImage &image) -> void
+{
+    const auto inner = slot.rect.adjusted(1, 1, -1, -1);
+    OpenGLTextureBinder<OGL::Target2D> binder;
+    binder.bind(texture);
+    clear(texture, (stale & slot.rect) - inner);
+    texture->upload(inner, image.bits());
+    stale -= slot.rect;
+    stale += inner;
+    binder.bind(&bbox);
+    clear(&bbox, staleBoxes & slot.rect);
+    staleBoxes -= slot.rect;
+    for (auto &box : image.boundingBoxes()) {
+        const auto rect = box.toRect().translated(inner.topLeft()) & inner;
+        if (rect.isEmpty())
+            continue;
+        if (_Expand(bboxData, rect.width()*rect.height()))
+            bboxData.fill(_Max<quint32>());
+        bbox.upload(rect, bboxData.data());
+        staleBoxes += rect;
+    }
+}
+
+// captions which are not in atlas yet get slots and are uploaded
+// atlas is repacked from scratch when it is too fragmented and grows when it
+// is too small even then.
+auto SubtitleRenderer::Data::place(OpenGLTexture2D *texture,
+                                   const QVector<const SubCompImage*> &images) -> void
+{
+    QVector<Slot> kept;
+    for (auto image : images) {
+        const int i = findSlot(image->cacheKey());
+        if (i >= 0) {
+            kept.push_back(slots[i]);
+            slots.remove(i);
+        }
+    }
+    for (auto &slot : slots)
+        packer.release(slot.rect);
+    slots = kept;
+
+    auto allocate = [&] () {
+        const int from = slots.size();
+        for (auto image : images) {
+            if (findSlot(image->cacheKey()) >= 0)
+                continue;
+            const auto rect = packer.allocate(image->size() + QSize(2, 2));
+            if (rect.isNull())
+                return false;
+            slots.push_back({ image->cacheKey(), rect });
+        }
+        for (int i = from; i < slots.size(); ++i) {
+            const auto key = slots[i].key;
+            upload(texture, slots[i], **std::find_if(images.begin(), images.end(),
+                [&] (const SubCompImage *image) { return image->cacheKey() == key; }));
+        }
+        return true;
+    };
+    if (allocate())
+        return;
+    GLint max = 0;
+    func()->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max);
+    QSize need(0, 0);
+    for (auto image : images) {
+        need.rwidth() = qMax(need.width(), image->width() + 2);
+        need.rheight() += image->height() + 2;
+    }
+    auto align = [&] (int v) { return qMin(max, (v + 255) & ~255); };
+    auto size = atlas;
+    for (;;) {
+        if (size != atlas) {
+            OpenGLTextureBinder<OGL::Target2D> binder;
+            binder.bind(texture);
+            texture->initialize(size);
+            binder.bind(&bbox);
+            bbox.initialize(size);
+        }
+        resetAtlas(size);
+        if (allocate())
+            return;
+        const QSize grown(align(qMax(size.width(), need.width())),
+                          align(qMax(size.height(), need.height()) * 2));
+        if (grown == size)
+            break;
+        size = grown;
+    }
+    _Error("Atlas of %%x%% cannot hold all of captions.", size.width(), size.height());
+}
+
 SubtitleRenderer::SubtitleRenderer(QQuickItem *parent)
     : SimpleTextureItem(parent)
     , d(new Data(this))
@@ -156,6 +313,7 @@ auto SubtitleRenderer::initializeGL() -> void
     SimpleTextureItem::initializeGL();
     texture().create();
     d->bbox.create();
+    d->resetAtlas({0, 0});
 }
 
 auto SubtitleRenderer::finalizeGL() -> void
@@ -163,6 +321,7 @@ auto SubtitleRenderer::finalizeGL() -> void
     SimpleTextureItem::finalizeGL();
     d->bbox.destroy();
     texture().destroy();
+    d->resetAtlas({0, 0});
 }
 
 auto SubtitleRenderer::text() const -> const RichTextDocument&
@@ -262,6 +421,7 @@ auto SubtitleRenderer::style() const -> const OsdStyle&
 auto SubtitleRenderer::unload() -> void
 {
     d->selection.clear();
+    d->reindex = true;
     qDeleteAll(d->loaded);
     d->loaded.clear();
     setVisible(false);
@@ -273,9 +433,18 @@ auto SubtitleRenderer::unload() -> void
 auto SubtitleRenderer::updateVertex(Vertex *vertex) -> void
 {
     const auto dpr = devicePixelRatio();
-    const QRectF r(d->drawer. pos(d->imageSize/dpr, rect()), d->imageSize/dpr);
-    OGL::CoordAttr::fillTriangleStrip(vertex, &Vertex::position,
-                                      r.topLeft(), r.bottomRight());
+    const auto pos = d->drawer.pos(d->imageSize/dpr, rect());
+    if (d->quads.isEmpty())
+        Vertex::fillAsTriangles(vertex, {0, 0}, {0, 0}, {0, 0}, {0, 0});
+    for (auto &q : d->quads)
+        vertex = Vertex::fillAsTriangles(vertex, pos + q.frame.topLeft()/dpr,
+                                         pos + q.frame.bottomRight()/dpr,
+                                         q.tex.topLeft(), q.tex.bottomRight());
+}
+
+auto SubtitleRenderer::vertexCount() const -> int
+{
+    return 6 * qMax(1, d->quads.size());
 }
 
 auto SubtitleRenderer::createData() const -> ShaderData*
@@ -300,35 +469,31 @@ auto SubtitleRenderer::updateTexture(OpenGLTexture2D *texture) -> void
             * d->drawer.scale(geometry())
             * d->drawer.style().spacing.paragraph + 0.5;
     int lastTime = -1;
+    QVector<const SubCompImage*> images;
     d->selection.forImages([&] (const SubCompImage &image) {
         if (d->imageSize.width() < image.width())
             d->imageSize.rwidth() = image.width();
         d->imageSize.rheight() += image.height() + spacing;
         if (image.isValid())
             lastTime = std::max(image.iterator().key(), lastTime);
+        if (!image.isNull())
+            images.push_back(&image);
     });
     d->imageSize.rheight() -= spacing;
     if (!d->imageSize.isEmpty()) {
-        const auto len = d->imageSize.width()*d->imageSize.height();
-        _Expand(d->zeros, len);
-        OpenGLTextureBinder<OGL::Target2D> binder;
-        binder.bind(texture);
-        texture->initialize(d->imageSize, d->zeros.data());
-        binder.bind(&d->bbox);
-        d->bbox.initialize(d->imageSize, d->zeros.data());
+        d->place(texture, images);
+        const QSizeF atlas = d->atlas;
+        d->quads.clear();
         int y = 0;
         d->selection.forImages([&] (const SubCompImage &image) {
-            const int x = (texture->width() - image.width())*0.5;
-            if (!image.isNull()) {
-                binder.bind(texture);
-                texture->upload(x, y, image.width(), image.height(), image.bits());
-                binder.bind(&d->bbox);
-                for (auto &bbox : image.boundingBoxes()) {
-                    const auto rect = bbox.toRect().translated(x, y);
-                    if (_Expand(d->bboxData, rect.width()*rect.height()))
-                        d->bboxData.fill(_Max<quint32>());
-                    d->bbox.upload(rect, d->bboxData.data());
-                }
+            const int slot = image.isNull() ? -1 : d->findSlot(image.cacheKey());
+            if (slot >= 0) {
+                const int x = (d->imageSize.width() - image.width())*0.5;
+                const QRectF inner = d->slots[slot].rect.adjusted(1, 1, -1, -1);
+                d->quads.push_back({ { QPointF(x, y), QSizeF(image.size()) },
+                                     { inner.x()/atlas.width(), inner.y()/atlas.height(),
+                                       inner.width()/atlas.width(),
+                                       inner.height()/atlas.height() } });
             }
             y += image.height() + spacing;
         });
@@ -390,6 +555,7 @@ auto SubtitleRenderer::setHidden(bool hidden) -> void
 auto SubtitleRenderer::setFPS(double fps) -> void
 {
     d->selection.setFPS(fps);
+    d->reindex = true;
 }
 
 auto SubtitleRenderer::fps() const -> double
@@ -457,77 +623,27 @@ auto SubtitleRenderer::lastUpdatedTime() const -> int
 
 auto SubtitleRenderer::start(int time) const -> int
 {
-    int ret = -1;
-    d->selection.forComponents([this, time, &ret] (const SubComp &comp) {
-        const auto it = comp.start(time - d->delay, d->fps());
-        if (it != comp.end())
-            ret = qMax(ret, comp.isBasedOnFrame() ? comp.msec(it.key(), d->fps()) : it.key());
-    });
-    return ret;
+    return d->indexed().start(time - d->delay);
 }
 
 auto SubtitleRenderer::finish(int time) const -> int
 {
-    int ret = -1;
-    d->selection.forComponents([this, time, &ret] (const SubComp &comp) {
-        const auto it = comp.finish(time - d->delay, d->fps());
-        if (it != comp.end()) {
-            const int t = comp.isBasedOnFrame() ? comp.msec(it.key(), d->fps()) : it.key();
-            ret = ret == -1 ? t : qMin(ret, t);
-        }
-    });
-    return ret;
-}
-
-static bool updateIfEarlier(SubComp::ConstIt it, int &time) {
-    if (it->hasWords()) {
-        if (time < 0)
-            time = it.key();
-        else if (it.key() > time)
-            time = it.key();
-        return true;
-    } else
-        return false;
+    return d->indexed().finish(time - d->delay);
 }
 
 auto SubtitleRenderer::current() const -> int
 {
-    int time = -1;
-    d->selection.forImages([this, &time] (const SubCompImage &imageture) {
-        if (imageture.isValid())
-            updateIfEarlier(imageture.iterator(), time);
-    });
-    return time;
+    return d->indexed().current(d->msec - d->delay);
 }
 
 auto SubtitleRenderer::previous() const -> int
 {
-    int time = -1;
-    d->selection.forImages([this, &time] (const SubCompImage &imageture) {
-        if (imageture.isValid()) {
-            auto it = imageture.iterator();
-            while (it != imageture.component()->begin()) {
-                if (updateIfEarlier(--it, time))
-                    break;
-            }
-        }
-    });
-    return time;
+    return d->indexed().previous(d->msec - d->delay);
 }
 
 auto SubtitleRenderer::next() const -> int
 {
-    int time = -1;
-    d->selection.forImages([this, &time] (const SubCompImage &imageture) {
-        if (imageture.isValid()) {
-            auto it = imageture.iterator();
-            while (++it != imageture.component()->end()) {
-                if (updateIfEarlier(it, time))
-                    break;
-            }
-        }
-    });
-    return time;
+    return d->indexed().next(d->msec - d->delay);
 }
 
 auto SubtitleRenderer::addComponents(const QVector<SubComp> &components) -> void
@@ -535,8 +651,10 @@ auto SubtitleRenderer::addComponents(const QVector<SubComp> &components) -> void
     if (components.isEmpty())
         return;
     const int idx = d->loaded.size();
-    for (auto &comp : components)
+    for (auto &comp : components) {
         d->loaded.append(new SubComp(comp));
+        d->claim(d->loaded.back());
+    }
     d->selecting = true;
     bool sort = false;
     for (int i=d->loaded.size()-1; i>=idx; --i) {
@@ -554,8 +672,11 @@ auto SubtitleRenderer::setComponents(const QVector<SubComp> &components) -> void
 {
     unload();
     d->loaded.reserve(components.size());
-    for (const auto &comp : components)
+    for (const auto &comp : components) {
         d->loaded.push_back(new SubComp(comp));
+        d->claim(d->loaded.back());
+    }
+    d->pending.clear();
     for (const auto &comp : d->loaded) {
         if (comp->selection())
             d->selection.prepend(comp);
@@ -564,6 +685,47 @@ auto SubtitleRenderer::setComponents(const QVector<SubComp> &components) -> void
     d->applySelection();
 }
 
+auto SubtitleRenderer::merge(const QVector<SubComp> &captions) -> bool
+{
+    bool reselect = false;
+    for (auto &capts : captions) {
+        const auto comp = d->find(capts.id());
+        reselect |= comp && comp->selection();
+    }
+    QList<const SubComp*> selected;
+    if (reselect) { // threads are reading captions
+        d->selection.forComponents([&] (const SubComp &comp)
+                                   { selected.push_back(&comp); });
+        d->selection.clear();
+    }
+    bool added = false;
+    for (auto &capts : captions) {
+        if (auto comp = d->find(capts.id()))
+            comp->merge(capts);
+        else if (std::any_of(d->loaded.begin(), d->loaded.end(), [&] (SubComp *c)
+                             { return c->path() == capts.path(); })) {
+            // class which appears later in file
+            d->loaded.append(new SubComp(capts));
+            added = true;
+        } else
+            d->pending.append(capts);
+    }
+    if (reselect) {
+        for (auto comp : selected)
+            d->selection.prepend(comp);
+        d->sort();
+        d->applySelection();
+    }
+    return added;
+}
+
+auto SubtitleRenderer::dropPending(const QString &file) -> void
+{
+    auto &pending = d->pending;
+    pending.erase(std::remove_if(pending.begin(), pending.end(), [&] (const SubComp &capts)
+                                 { return capts.path() == file; }), pending.end());
+}
+
 auto SubtitleRenderer::selection() const -> QVector<SubComp>
 {
     QVector<SubComp> selection;
@@ -14,6 +14,8 @@ class SubtitleRenderer : public SimpleTextureItem  {
 public:
     SubtitleRenderer(QQuickItem *parent = nullptr);
     ~SubtitleRenderer();
+    // nearest beginnings of captions with words across selected components
+    // in msec; previous is before the latest caption shown now, -1 if none
     auto previous() const -> int;
     auto next() const -> int;
     auto current() const -> int;
@@ -27,6 +29,10 @@ public:
     auto components() const -> QVector<const SubComp *>;
     auto addComponents(const QVector<SubComp> &components) -> void;
     auto setComponents(const QVector<SubComp> &components) -> void;
+    // captions parsed after components were loaded; true if new ones appear
+    auto merge(const QVector<SubComp> &captions) -> bool;
+    // drops captions of file which were not claimed by any component
+    auto dropPending(const QString &file) -> void;
     auto componentsCount() const -> int;
     auto setPriority(const QStringList &priority) -> void;
     auto setPos(double pos) -> void;
@@ -64,6 +70,9 @@ private:
     auto updateTexture(OpenGLTexture2D *texture) -> void override;
     auto updateData(ShaderData *data) -> void override;
     auto updateVertex(Vertex *vertex) -> void override;
+    // a quad for each caption in atlas
+    auto drawingMode() const -> GLenum override { return GL_TRIANGLES; }
+    auto vertexCount() const -> int override;
     struct Data; Data *d;
     friend class SubtitleRendererShader;
 };
@@ -1,19 +1,50 @@
 #include "subtitlerenderingthread.hpp"
 #include "misc/dataevent.hpp"
 
-template<>
-inline bool qMapLessThanKey(const SubCompItMapIt &lhs,
-                            const SubCompItMapIt &rhs) {
-    return lhs.key() < rhs.key();
-}
+// rendered images which are used recently within budget of bytes
+class SubCompImageCache {
+public:
+    struct Key {
+        const SubCapt *caption; int drawer; QRectF area; double dpr;
+        DECL_EQ(Key, &T::caption, &T::drawer, &T::area, &T::dpr)
+    };
+    SubCompImageCache(qint64 budget): m_budget(budget) { }
+    auto budget() const -> qint64 { return m_budget; }
+    // marks image as recently used
+    auto find(const Key &key) -> const SubCompImage*
+    {
+        for (auto it = m_lru.begin(); it != m_lru.end(); ++it) {
+            if (it->first == key) {
+                m_lru.splice(m_lru.begin(), m_lru, it);
+                return &m_lru.front().second;
+            }
+        }
+        return nullptr;
+    }
+    auto insert(const Key &key, const SubCompImage &image) -> void
+    {
+        m_lru.emplace_front(key, image);
+        m_bytes += image.byteCount();
+        while (m_bytes > m_budget && m_lru.size() > 1) {
+            m_bytes -= m_lru.back().second.byteCount();
+            m_lru.pop_back();
+        }
+    }
+private:
+    std::list<std::pair<Key, SubCompImage>> m_lru; // recent first
+    qint64 m_bytes = 0, m_budget = 0;
+};
 
 struct SubCompSelection::Thread::Data {
     Item *item = nullptr;
     int time = 0;
     const SubComp *comp = nullptr;
-    SubCompItMap its;
-    SubCompItMapIt it = its.end();
-    QMap<SubCompItMapIt, SubCompImage> pool;
+    SubCompIndex index;
+    int it = -1; // position of caption shown
+    int ahead = -1; // position of caption to render ahead
+    qint64 aheadBytes = 0;
+    SubCompImageCache cache{CacheBytes};
+    int drawerId = 0; // changed with drawer
     QObject *receiver = nullptr;
     bool quit = false;
     double fps = 1.0, dpr = 1.0, mul = 1.0;
@@ -21,11 +52,21 @@ struct SubCompSelection::Thread::Data {
     QRectF rect; SubtitleDrawer drawer;
     SubCompSelection *selection = nullptr;
 
-    SubComp::ConstIt iterator(int time) const { return comp->start(time, fps); }
-    auto newPicture(SubCompItMapIt it)
+    auto key(int it) const -> SubCompImageCache::Key
+        { return { &index.at(it).caption(), drawerId, rect, dpr }; }
+    auto newPicture(int it)
+    {
+        SubCompImage pic(comp, index.at(it).it, item);
+        drawer.draw(pic, rect, dpr);
+        return pic;
+    }
+    auto picture(int it)
     {
-        auto pic = pool.insert(it, SubCompImage(comp, *it, item));
-        drawer.draw(*pic, rect, dpr);
+        const auto key = this->key(it);
+        if (auto cached = cache.find(key))
+            return *cached;
+        const auto pic = newPicture(it);
+        cache.insert(key, pic);
         return pic;
     }
     auto update()
@@ -34,56 +75,61 @@ struct SubCompSelection::Thread::Data {
             return;
         auto post = [this] (const SubCompImage &pic)
             { _PostEvent(receiver, ImagePrepared, pic); };
-        if (it != its.end()) {
-            auto cache = pool.find(it);
-            if (cache == pool.end())
-                cache = newPicture(it);
-            post(*cache);
-        } else
+        if (it >= 0)
+            post(picture(it));
+        else
             post(comp);
     }
 
-    auto fillCache()
+    // window ahead stops short of budget not to evict what it has rendered
+    auto canRenderAhead() const -> bool
     {
-        if (it == its.end())
-            return;
-        auto iit = pool.begin();
-        while (iit != pool.end() && iit.key().key() < it.key())
-            iit = pool.erase(iit);
-        Q_ASSERT(iit.key() == it);
-        auto key = it;
-        const int size = qMin(2, pool.size()+1);
-        for (int i=0; i<size; ++i) {
-            ++iit; ++key;
-            if (key == its.end())
-                break;
-            if (iit == pool.end())
-                iit = newPicture(key);
+        return 0 <= ahead && ahead < index.size()
+                && index.at(ahead).time <= time + LookAhead
+                && aheadBytes < cache.budget() / 2;
+    }
+
+    // renders one caption in window ahead; false if window is ready
+    auto renderAhead() -> bool
+    {
+        while (!quit && canRenderAhead()) {
+            const auto key = this->key(ahead);
+            if (auto cached = cache.find(key)) {
+                aheadBytes += cached->byteCount();
+                ++ahead;
+                continue;
+            }
+            const auto pic = newPicture(ahead++);
+            aheadBytes += pic.byteCount();
+            cache.insert(key, pic);
+            return true;
         }
+        return false;
     }
 
     auto draw(bool force)
     {
-        auto iit = --its.upperBound(time);
+        const int iit = index.find(time);
         if (force || it != iit) {
-            if (it == its.end() || ++it != iit) {
-                pool.clear();
-                it = iit;
-                update();
-            } else {
-                update();
-                fillCache();
-            }
+            it = iit;
+            ahead = it + 1;
+            aheadBytes = 0;
+            update();
+        }
+    }
+
+    auto setDrawer(const SubtitleDrawer &drawer)
+    {
+        if (this->drawer != drawer) {
+            this->drawer = drawer;
+            ++drawerId;
         }
     }
 
     auto rebuild()
     {
-        pool.clear();
-        its.clear();
-        it = its.end();
-        for (auto iit = comp->begin(); iit != comp->end(); ++iit)
-            its.insert(comp->toTime(iit.key(), fps), iit);
+        index = SubCompIndex(comp, fps);
+        it = ahead = -1;
     }
 };
 
@@ -128,7 +174,7 @@ auto SubCompSelection::Thread::run() -> void
     int flags = 0;
     while (!d->quit) {
         QMutexLocker locker(d->mutex);
-        if (!(this->flags & ForceUpdate))
+        if (!(this->flags & ForceUpdate) && !d->canRenderAhead())
             d->wait->wait(d->mutex);
         if (d->quit)
             break;
@@ -138,7 +184,7 @@ auto SubCompSelection::Thread::run() -> void
         d->fps = fps;
         if (flags & NewOption) {
             if (flags & NewDrawer)
-                d->drawer = drawer;
+                d->setDrawer(drawer);
             if (flags & NewArea) {
                 d->rect = rect;
                 d->dpr = dpr;
@@ -149,12 +195,12 @@ auto SubCompSelection::Thread::run() -> void
             break;
         if (flags & Rebuild)
             d->rebuild();
-        if (flags & NewOption)
-            d->pool.clear();
         if (d->quit)
             break;
-        if (d->time > 0 && d->fps > 0.0 && !d->its.isEmpty())
+        if (d->time > 0 && d->fps > 0.0 && !d->index.isEmpty())
             d->draw(flags & ForceUpdate);
+        // one at a time to answer new time first
+        d->renderAhead();
     }
 }
 
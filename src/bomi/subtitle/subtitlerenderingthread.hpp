@@ -2,9 +2,7 @@
 #define SUBTITLERENDERINGTHREAD_HPP
 
 #include "subtitledrawer.hpp"
-
-using SubCompItMap = QMap<int, SubComp::ConstIt>;
-using SubCompItMapIt = SubCompItMap::const_iterator;
+#include "subcompindex.hpp"
 
 class SubCompSelection {
 public:
@@ -12,6 +10,10 @@ public:
     enum Flag {
         NewDrawer = 1, NewArea = 2, Rebuild = 4, Rerender = 8, Tick = 16
     };
+    // captions are rendered in advance within time window and kept in
+    // cache of each component until budget so that seek does not wait
+    static constexpr int LookAhead = 10000; // msec
+    static constexpr qint64 CacheBytes = 32 << 20;
 private:
     struct Item;
     class Thread : public QThread {
@@ -3,23 +3,29 @@
 #include "misc/json.hpp"
 
 #define JSON_CLASS DeintOption
-static const auto jioOpt = JIO(JE(method), JE(processor), JE(doubler));
+static const auto jioOpt = JIO(JE(method), JE(processor), JE(doubler),
+                          JE(threads), JE(queue));
 JSON_DECLARE_FROM_TO_FUNCTIONS_IO(jioOpt)
 
 auto DeintOption::toString() const -> QString
 {
-    return _EnumName(method) % '|'_q % _N(doubler) % '|'_q % _EnumName(processor);
+    return _EnumName(method) % '|'_q % _N(doubler) % '|'_q % _EnumName(processor)
+            % '|'_q % _N(threads) % '|'_q % _N(queue);
 }
 
 auto DeintOption::fromString(const QString &string) -> DeintOption
 {
     QStringList tokens = string.split('|'_q, QString::SkipEmptyParts);
-    if (tokens.size() != 3)
+    if (tokens.size() != 3 && tokens.size() != 5)
         return DeintOption();
     DeintOption opt;
     opt.method = _EnumFrom(tokens[0], opt.method);
     opt.doubler = tokens[1].toInt();
     opt.processor = _EnumFrom(tokens[2], opt.processor);
+    if (tokens.size() == 5) {
+        opt.threads = qMax(0, tokens[3].toInt());
+        opt.queue = qMax(0, tokens[4].toInt());
+    }
     return opt;
 }
 
@@ -8,7 +8,8 @@ struct DeintOption {
     DeintOption() = default;
     DeintOption(DeintMethod method, Processor proc, bool doubler)
         : method(method), processor(proc), doubler(doubler) { }
-    DECL_EQ(DeintOption, &T::method, &T::processor, &T::doubler);
+    DECL_EQ(DeintOption, &T::method, &T::processor, &T::doubler,
+            &T::threads, &T::queue);
     auto toJson() const -> QJsonObject;
     auto setFromJson(const QJsonObject &json) -> bool;
     auto toString() const -> QString;
@@ -17,6 +18,9 @@ struct DeintOption {
     DeintMethod method = DeintMethod::None;
     Processor processor = Processor::None;
     bool doubler = false;
+    // for filter graph of CPU; zero threads for cpu count
+    // frames queued to worker thread; zero to run on caller
+    int threads = 0, queue = 0;
 };
 
 Q_DECLARE_METATYPE(DeintOption)
@@ -1,5 +1,7 @@
 #include "ffmpegfilters.hpp"
 #include "global.hpp"
+#include "misc/simd.hpp"
+#include "misc/slicepool.hpp"
 extern "C" {
 #include <libavfilter/buffersink.h>
 #include <libavfilter/buffersrc.h>
@@ -14,21 +16,127 @@ static auto null_mp_image(void *arg, void(*free)(void*)) -> mp_image*
 
 auto query_video_format(quint32 format) -> int;
 
+static QAtomicInt s_allocations{0};
+
+// Frames cross the graph in both directions without copy. An input image is
+// lent as one read-only buffer per plane. The first one holds the single
+// reference and each of the others keeps a reference to the first one, and
+// an output frame is lent in an AVFrame shell. Lent slots
+// and shells return to free lists when released, from any thread, and the
+// bridge outlives its graph until the last of them comes back.
+
+struct FFmpegFilterGraph::Bridge {
+    struct Lent { Bridge *bridge; AVFrame *frame; MpImage image; };
+    QMutex mutex;
+    std::vector<Lent*> free;
+    int lent = 0;
+    bool orphan = false;
+    AVFrame *in = nullptr;
+    Bridge() { in = av_frame_alloc(); s_allocations.ref(); }
+    ~Bridge()
+    {
+        for (auto l : free) {
+            av_frame_free(&l->frame);
+            delete l;
+        }
+        av_frame_free(&in);
+    }
+    auto take(bool frame) -> Lent*
+    {
+        QMutexLocker locker(&mutex);
+        ++lent;
+        Lent *l = nullptr;
+        if (free.empty()) {
+            l = new Lent{this, nullptr, MpImage()};
+            free.reserve(free.size() + lent);
+            s_allocations.ref();
+        } else {
+            l = free.back();
+            free.pop_back();
+        }
+        locker.unlock();
+        if (frame && !l->frame) {
+            l->frame = av_frame_alloc();
+            s_allocations.ref();
+        }
+        return l;
+    }
+    static auto give(Lent *l) -> void
+    {
+        if (l->frame)
+            av_frame_unref(l->frame);
+        l->image.release();
+        auto b = l->bridge;
+        QMutexLocker locker(&b->mutex);
+        b->free.push_back(l);
+        if (--b->lent || !b->orphan)
+            return;
+        locker.unlock();
+        delete b;
+    }
+    // deleted by owner or by the last lent one
+    auto abandon() -> void
+    {
+        QMutexLocker locker(&mutex);
+        orphan = true;
+        if (lent)
+            return;
+        locker.unlock();
+        delete this;
+    }
+};
+
+FFmpegFilterGraph::FFmpegFilterGraph()
+    : m_bridge(new Bridge)
+{
+    static const bool registered = (avfilter_register_all(), true);
+    Q_UNUSED(registered);
+}
+
+FFmpegFilterGraph::~FFmpegFilterGraph()
+{
+    release();
+    m_bridge->abandon();
+}
+
+auto FFmpegFilterGraph::allocations() -> int
+{
+    return s_allocations.load();
+}
+
 auto FFmpegFilterGraph::push(const MpImage &in) -> bool
 {
     Q_ASSERT(m_imgfmt == in->imgfmt && m_size == QSize(in->w, in->h));
     if (!m_graph)
         return false;
     auto src = m_src->outputs[0];
-    auto frame = av_frame_alloc();
-    mp_image_copy_fields_to_av_frame(frame, const_cast<mp_image*>(in.data()));
-    int flags = AV_BUFFER_FLAG_READONLY;
-    auto freeMpImage = [](void *in, uint8_t*) { delete static_cast<MpImage*>(in); };
-    for (int n = 0; n < in->num_planes; ++n) {
-        auto plane = new MpImage(in);
-        const size_t size = in->stride[n] * in->h;
-        frame->buf[n] = av_buffer_create(in->planes[n], size,
-                                         freeMpImage, plane, flags);
+    auto frame = m_bridge->in;
+    auto mpi = const_cast<mp_image*>(in.data());
+    mp_image_copy_fields_to_av_frame(frame, mpi);
+    auto lent = m_bridge->take(false);
+    lent->image = in;
+    auto give = [] (void *lent, uint8_t*)
+        { Bridge::give(static_cast<Bridge::Lent*>(lent)); };
+    auto unref = [] (void *buf, uint8_t*)
+        { auto ref = static_cast<AVBufferRef*>(buf); av_buffer_unref(&ref); };
+    for (int i = 0; i < in->num_planes; ++i) {
+        // extent of plane in memory even if stride is negative
+        const int h = mp_image_plane_h(mpi, i), stride = in->stride[i];
+        auto data = in->planes[i] + (stride < 0 ? stride * (h - 1) : 0);
+        const int size = qAbs(stride) * h;
+        if (i == 0)
+            frame->buf[0] = av_buffer_create(data, size, give, lent, AV_BUFFER_FLAG_READONLY);
+        else if (auto first = av_buffer_ref(frame->buf[0])) {
+            frame->buf[i] = av_buffer_create(data, size, unref, first, AV_BUFFER_FLAG_READONLY);
+            if (!frame->buf[i])
+                av_buffer_unref(&first);
+        }
+        if (!frame->buf[i]) {
+            if (i == 0)
+                Bridge::give(lent);
+            av_frame_unref(frame);
+            return false;
+        }
     }
     if (in->pts == MP_NOPTS_VALUE)
         frame->pts = AV_NOPTS_VALUE;
@@ -36,7 +144,7 @@ auto FFmpegFilterGraph::push(const MpImage &in) -> bool
         frame->pts = in->pts * av_q2d(av_inv_q(src->time_base));
     frame->sample_aspect_ratio = src->sample_aspect_ratio;
     const bool ok = (av_buffersrc_add_frame(m_src, frame) >= 0);
-    av_frame_free(&frame);
+    av_frame_unref(frame);
     return ok;
 }
 
@@ -44,15 +152,14 @@ auto FFmpegFilterGraph::pull() -> MpImage
 {
     if (!m_graph)
         return MpImage();
-    auto frame = av_frame_alloc();
-    const auto err = av_buffersink_get_frame(m_sink, frame);
-    if (err < 0) {
-        av_frame_free(&frame);
+    auto lent = m_bridge->take(true);
+    if (av_buffersink_get_frame(m_sink, lent->frame) < 0) {
+        Bridge::give(lent);
         return MpImage();
     }
-    auto freeAvFrame = [](void *frame) { av_frame_free((AVFrame**)&frame); };
-    auto mpi = null_mp_image(frame, freeAvFrame);
-    mp_image_copy_fields_from_av_frame(mpi, frame);
+    auto give = [] (void *lent) { Bridge::give(static_cast<Bridge::Lent*>(lent)); };
+    auto mpi = null_mp_image(lent, give);
+    mp_image_copy_fields_from_av_frame(mpi, lent->frame);
     return MpImage::wrap(mpi);
 }
 
@@ -111,7 +218,6 @@ auto FFmpegFilterGraph::linkGraph(AVFilterInOut *&in,
 auto FFmpegFilterGraph::initialize(const QString &option, const QSize &size,
                                    mp_imgfmt imgfmt) -> bool
 {
-    avfilter_register_all();
     if (option == m_option && m_size == size && m_imgfmt == imgfmt)
         return m_graph;
     m_option = option; m_size = size; m_imgfmt = imgfmt;
@@ -122,6 +228,10 @@ auto FFmpegFilterGraph::initialize(const QString &option, const QSize &size,
     auto out = avfilter_inout_alloc();
     auto in = avfilter_inout_alloc();
     m_graph = avfilter_graph_alloc();
+    if (m_graph) {
+        m_graph->nb_threads = m_threads;
+        m_graph->thread_type = AVFILTER_THREAD_SLICE;
+    }
     if (!linkGraph(in, out))
         release();
     avfilter_inout_free(&out);
@@ -129,6 +239,14 @@ auto FFmpegFilterGraph::initialize(const QString &option, const QSize &size,
     return m_graph;
 }
 
+auto FFmpegFilterGraph::setThreads(int threads) -> void
+{
+    if (_Change(m_threads, qMax(0, threads))) {
+        m_option.clear();
+        release();
+    }
+}
+
 auto FFmpegFilterGraph::release() -> void
 {
     avfilter_graph_free(&m_graph);
@@ -137,6 +255,259 @@ auto FFmpegFilterGraph::release() -> void
 
 /******************************************************************************/
 
+
+// Missing lines of a field are made from the lines of same parity in every
+// plane, so chroma is deinterlaced as well. Components of 9-16 bits are
+// handled as 16-bit words. Rows are independent of each other, so a frame is
+// split into slices of rows which run on the shared SlicePool.
+
+// cubic is (-p0 + 9*p1 + 9*p2 - p3)/16 which is Catmull-Rom at the midpoint
+template<class T>
+static auto cubicPel(int p0, int p1, int p2, int p3, int max) -> T
+    { return qBound(0, (9 * (p1 + p2) - p0 - p3) >> 4, max); }
+
+#ifdef SIMD_HAS_SSE2
+struct Lines128 {
+    using V = __m128i;
+    SIA load(const void *p) -> V { return _mm_loadu_si128((const V*)p); }
+    SIA store(void *p, V v) -> void { _mm_storeu_si128((V*)p, v); }
+    // (a + b) >> 1 which pavg rounds up
+    SIA average(V a, V b, quint8) -> V
+    {
+        const auto odd = _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1));
+        return _mm_sub_epi8(_mm_avg_epu8(a, b), odd);
+    }
+    SIA average(V a, V b, quint16) -> V
+    {
+        const auto odd = _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi16(1));
+        return _mm_sub_epi16(_mm_avg_epu16(a, b), odd);
+    }
+    SIA taps16(V p0, V p1, V p2, V p3) -> V
+    {
+        const auto s = _mm_add_epi16(p1, p2);
+        const auto t = _mm_sub_epi16(_mm_add_epi16(_mm_slli_epi16(s, 3), s), _mm_add_epi16(p0, p3));
+        return _mm_srai_epi16(t, 4);
+    }
+    // SSE2 has neither min/max nor packus for 32-bit, so clamp by masks
+    SIA taps32(V p0, V p1, V p2, V p3, V max) -> V
+    {
+        const auto s = _mm_add_epi32(p1, p2);
+        auto t = _mm_sub_epi32(_mm_add_epi32(_mm_slli_epi32(s, 3), s), _mm_add_epi32(p0, p3));
+        t = _mm_srai_epi32(t, 4);
+        t = _mm_andnot_si128(_mm_srai_epi32(t, 31), t);
+        const auto over = _mm_cmpgt_epi32(t, max);
+        return _mm_or_si128(_mm_and_si128(over, max), _mm_andnot_si128(over, t));
+    }
+    // 8-bit is done in 16-bit lanes and saturated by packus
+    SIA cubic(V p0, V p1, V p2, V p3, int, quint8) -> V
+    {
+        const auto z = _mm_setzero_si128();
+        const auto lo = taps16(_mm_unpacklo_epi8(p0, z), _mm_unpacklo_epi8(p1, z),
+                               _mm_unpacklo_epi8(p2, z), _mm_unpacklo_epi8(p3, z));
+        const auto hi = taps16(_mm_unpackhi_epi8(p0, z), _mm_unpackhi_epi8(p1, z),
+                               _mm_unpackhi_epi8(p2, z), _mm_unpackhi_epi8(p3, z));
+        return _mm_packus_epi16(lo, hi);
+    }
+    // 16-bit is done in 32-bit lanes and packed with bias by signed packs
+    SIA cubic(V p0, V p1, V p2, V p3, int max, quint16) -> V
+    {
+        const auto z = _mm_setzero_si128(), m = _mm_set1_epi32(max);
+        const auto bias = _mm_set1_epi32(0x8000);
+        auto half = [&] (V p0, V p1, V p2, V p3)
+            { return _mm_sub_epi32(taps32(p0, p1, p2, p3, m), bias); };
+        const auto lo = half(_mm_unpacklo_epi16(p0, z), _mm_unpacklo_epi16(p1, z),
+                             _mm_unpacklo_epi16(p2, z), _mm_unpacklo_epi16(p3, z));
+        const auto hi = half(_mm_unpackhi_epi16(p0, z), _mm_unpackhi_epi16(p1, z),
+                             _mm_unpackhi_epi16(p2, z), _mm_unpackhi_epi16(p3, z));
+        return _mm_xor_si128(_mm_packs_epi32(lo, hi), _mm_set1_epi16(-0x8000));
+    }
+};
+#endif
+
+#ifdef SIMD_HAS_AVX2
+// unpack and pack work within 128-bit lanes, so the order is kept
+struct Lines256 {
+    using V = __m256i;
+    SIMD_AVX2 SIA load(const void *p) -> V { return _mm256_loadu_si256((const V*)p); }
+    SIMD_AVX2 SIA store(void *p, V v) -> void { _mm256_storeu_si256((V*)p, v); }
+    SIMD_AVX2 SIA average(V a, V b, quint8) -> V
+    {
+        const auto odd = _mm256_and_si256(_mm256_xor_si256(a, b), _mm256_set1_epi8(1));
+        return _mm256_sub_epi8(_mm256_avg_epu8(a, b), odd);
+    }
+    SIMD_AVX2 SIA average(V a, V b, quint16) -> V
+    {
+        const auto odd = _mm256_and_si256(_mm256_xor_si256(a, b), _mm256_set1_epi16(1));
+        return _mm256_sub_epi16(_mm256_avg_epu16(a, b), odd);
+    }
+    SIMD_AVX2 SIA taps16(V p0, V p1, V p2, V p3) -> V
+    {
+        const auto s = _mm256_add_epi16(p1, p2);
+        const auto t = _mm256_sub_epi16(_mm256_add_epi16(_mm256_slli_epi16(s, 3), s),
+                                        _mm256_add_epi16(p0, p3));
+        return _mm256_srai_epi16(t, 4);
+    }
+    SIMD_AVX2 SIA taps32(V p0, V p1, V p2, V p3, V max) -> V
+    {
+        const auto s = _mm256_add_epi32(p1, p2);
+        auto t = _mm256_sub_epi32(_mm256_add_epi32(_mm256_slli_epi32(s, 3), s),
+                                  _mm256_add_epi32(p0, p3));
+        t = _mm256_srai_epi32(t, 4);
+        return _mm256_min_epi32(_mm256_max_epi32(t, _mm256_setzero_si256()), max);
+    }
+    SIMD_AVX2 SIA cubic(V p0, V p1, V p2, V p3, int, quint8) -> V
+    {
+        const auto z = _mm256_setzero_si256();
+        const auto lo = taps16(_mm256_unpacklo_epi8(p0, z), _mm256_unpacklo_epi8(p1, z),
+                               _mm256_unpacklo_epi8(p2, z), _mm256_unpacklo_epi8(p3, z));
+        const auto hi = taps16(_mm256_unpackhi_epi8(p0, z), _mm256_unpackhi_epi8(p1, z),
+                               _mm256_unpackhi_epi8(p2, z), _mm256_unpackhi_epi8(p3, z));
+        return _mm256_packus_epi16(lo, hi);
+    }
+    SIMD_AVX2 SIA cubic(V p0, V p1, V p2, V p3, int max, quint16) -> V
+    {
+        const auto z = _mm256_setzero_si256(), m = _mm256_set1_epi32(max);
+        const auto lo = taps32(_mm256_unpacklo_epi16(p0, z), _mm256_unpacklo_epi16(p1, z),
+                               _mm256_unpacklo_epi16(p2, z), _mm256_unpacklo_epi16(p3, z), m);
+        const auto hi = taps32(_mm256_unpackhi_epi16(p0, z), _mm256_unpackhi_epi16(p1, z),
+                               _mm256_unpackhi_epi16(p2, z), _mm256_unpackhi_epi16(p3, z), m);
+        return _mm256_packus_epi32(lo, hi);
+    }
+};
+#endif
+
+struct LinesPel { }; // no vector part
+
+template<class L, class T>
+static auto linear(T *dst, const T *a, const T *b, int n) -> void
+{
+    int i = 0;
+#ifdef SIMD_HAS_SSE2
+    constexpr int N = sizeof(typename L::V) / sizeof(T);
+    for (; i + N <= n; i += N)
+        L::store(dst + i, L::average(L::load(a + i), L::load(b + i), T()));
+#endif
+    for (; i < n; ++i)
+        dst[i] = (a[i] + b[i]) >> 1;
+}
+
+template<class L, class T>
+static auto cubic(T *dst, const T *const *p, int n, int max) -> void
+{
+    int i = 0;
+#ifdef SIMD_HAS_SSE2
+    constexpr int N = sizeof(typename L::V) / sizeof(T);
+    for (; i + N <= n; i += N)
+        L::store(dst + i, L::cubic(L::load(p[0] + i), L::load(p[1] + i),
+                                   L::load(p[2] + i), L::load(p[3] + i), max, T()));
+#endif
+    for (; i < n; ++i)
+        dst[i] = cubicPel<T>(p[0][i], p[1][i], p[2][i], p[3][i], max);
+}
+
+// n is in samples and max is the largest value of a component
+struct BobKernels {
+    auto (*linear8)(quint8 *dst, const quint8 *a, const quint8 *b, int n) -> void;
+    auto (*linear16)(quint16 *dst, const quint16 *a, const quint16 *b, int n) -> void;
+    auto (*cubic8)(quint8 *dst, const quint8 *const *p, int n, int max) -> void;
+    auto (*cubic16)(quint16 *dst, const quint16 *const *p, int n, int max) -> void;
+};
+
+#ifdef SIMD_HAS_AVX2
+SIMD_AVX2_ENTRY static auto linear8Avx2(quint8 *dst, const quint8 *a, const quint8 *b, int n) -> void
+    { linear<Lines256>(dst, a, b, n); }
+SIMD_AVX2_ENTRY static auto linear16Avx2(quint16 *dst, const quint16 *a, const quint16 *b, int n) -> void
+    { linear<Lines256>(dst, a, b, n); }
+SIMD_AVX2_ENTRY static auto cubic8Avx2(quint8 *dst, const quint8 *const *p, int n, int max) -> void
+    { cubic<Lines256>(dst, p, n, max); }
+SIMD_AVX2_ENTRY static auto cubic16Avx2(quint16 *dst, const quint16 *const *p, int n, int max) -> void
+    { cubic<Lines256>(dst, p, n, max); }
+#endif
+
+static auto bobKernels() -> const BobKernels&
+{
+    static const BobKernels k = [] () {
+#ifdef SIMD_HAS_SSE2
+        using L = Lines128;
+#else
+        using L = LinesPel;
+#endif
+        BobKernels k = { linear<L, quint8>, linear<L, quint16>,
+                         cubic<L, quint8>, cubic<L, quint16> };
+#ifdef SIMD_HAS_AVX2
+        if (Simd::isa() == Simd::Avx2)
+            k = { linear8Avx2, linear16Avx2, cubic8Avx2, cubic16Avx2 };
+#endif
+        return k;
+    }();
+    return k;
+}
+
+struct BobDeinterlacer::Data {
+    mp_image_pool *pool = nullptr;
+    int threads = 0; // slices on SlicePool::instance()
+    const BobKernels *k = nullptr;
+
+    struct Plane {
+        const uchar *src; uchar *dst;
+        int sstride, dstride, rows, samples, ys;
+    };
+    auto linear(quint8 *dst, const quint8 *a, const quint8 *b, int n) const -> void
+        { k->linear8(dst, a, b, n); }
+    auto linear(quint16 *dst, const quint16 *a, const quint16 *b, int n) const -> void
+        { k->linear16(dst, a, b, n); }
+    auto cubic(quint8 *dst, const quint8 *const *p, int n, int max) const -> void
+        { k->cubic8(dst, p, n, max); }
+    auto cubic(quint16 *dst, const quint16 *const *p, int n, int max) const -> void
+        { k->cubic16(dst, p, n, max); }
+    template<class T>
+    auto rows(DeintMethod method, bool top, const Plane &p,
+              int from, int to, int max) const -> void;
+};
+
+template<class T>
+auto BobDeinterlacer::Data::rows(DeintMethod method, bool top, const Plane &p,
+                                 int from, int to, int max) const -> void
+{
+    const int bytes = p.samples * sizeof(T), parity = !top;
+    auto line = [&] (int y) { return (const T*)(p.src + y * p.sstride); };
+    for (int y = from; y < to; ++y) {
+        auto out = p.dst + y * p.dstride;
+        if ((y & 1) == parity || p.rows < 2) {
+            memcpy(out, line(y), bytes);
+            continue;
+        }
+        const bool up = y > 0, down = y + 1 < p.rows;
+        if (method == DeintMethod::Bob || !up || !down) {
+            // nearest line of the field; the one above for top field
+            const bool above = up && (top || !down);
+            memcpy(out, line(above ? y - 1 : y + 1), bytes);
+        } else if (method == DeintMethod::CubicBob && y > 2 && y + 3 < p.rows) {
+            const T *taps[] = { line(y - 3), line(y - 1), line(y + 1), line(y + 3) };
+            cubic((T*)out, taps, p.samples, max);
+        } else
+            linear((T*)out, line(y - 1), line(y + 1), p.samples);
+    }
+}
+
+BobDeinterlacer::BobDeinterlacer()
+    : d(new Data)
+{
+    d->pool = MpImage::newPool(10);
+    d->k = &bobKernels();
+}
+
+BobDeinterlacer::~BobDeinterlacer()
+{
+    talloc_free(d->pool);
+    delete d;
+}
+
+auto BobDeinterlacer::setThreads(int threads) -> void
+{
+    d->threads = threads;
+}
+
 auto BobDeinterlacer::field(DeintMethod method, const MpImage &src, bool top) const -> MpImage
 {
     if (src->num_planes < 1)
@@ -146,95 +517,44 @@ auto BobDeinterlacer::field(DeintMethod method, const MpImage &src, bool top) co
         return src;
 
     MpImage dst = std::move(newImage(src));
-    const int stride = src->stride[0];
-    auto in = src->planes[0], out = dst->planes[0];
-    auto copy = [=] (int src, int dst)
-        { memcpy(out + dst * stride, in + src * stride, stride); };
-
-    switch (method) {
-    case DeintMethod::Bob: {
-        const int srcOffset = !top;
-        const int count = src->h / 2;
-        for (int i = 0; i < count ; ++i) {
-            auto src = in + srcOffset * stride;
-            memcpy(out, src, stride);
-            out += stride;
-            memcpy(out, src, stride);
-            out += stride;
-            in += 2 * stride;
-        }
-        break;
-    } case DeintMethod::LinearBob: {
-        const int count = h / 2 - 1;
-
-        if (top) {
-            copy(h - 2, h - 1);
-            copy(h - 2, h - 2);
-        } else {
-            copy(1, 0);
-            copy(h - 1, h - 1);
-            in += stride;
-            out += stride;
-        }
+    auto mpi = const_cast<mp_image*>(src.data());
+    const auto &desc = src->fmt;
+    // interpolation is meaningless for components not aligned to bytes
+    if (!(desc.flags & MP_IMGFLAG_BYTE_ALIGNED) || desc.component_bits <= 0)
+        method = DeintMethod::Bob;
+    const bool words = desc.component_bits > 8;
+    const int max = (1 << desc.component_bits) - 1;
 
-        for (int i = 0; i < count ; ++i) {
-            memcpy(out, in, stride);
-            out += stride;
-            auto in1 = in;
-            auto in2 = in += stride * 2;
-            for (int x = 0; x < stride; ++x)
-                *out++ = (*in1++ + *in2++) / 2 ;
-        }
-        break;
-    } case DeintMethod::CubicBob: {
-        const int count = h / 2 - 2;
-
-        if (top) {
-            copy(0, 0);
-            copy(0, 1);
-            copy(h - 2, h - 1);
-            copy(h - 2, h - 2);
-            in += stride * 2;
-            out += stride * 2;
-        } else {
-            copy(1, 0);
-            copy(1, 1);
-            copy(3, 2);
-            copy(h - 1, h - 1);
-            in += stride * 3;
-            out += stride * 3;
-        }
-
-        for (int i = 0; i < count ; ++i) {
-            memcpy(out, in, stride);
-            out += stride;
-            auto in0 = in - stride * 2;
-            auto in1 = in;
-            auto in2 = in += stride * 2;
-            auto in3 = in + stride * 2;
-            for (int x = 0; x < stride; ++x) {
-                const int p0 = *in0++, p1 = *in1++, p2 = *in2++, p3 = *in3++;
-                const auto a =  -p0 + 3*p1 - 3*p2 + p3;
-                const auto b = 2*p0 - 5*p1 + 4*p2 - p3;
-                const auto c =  -p0        +   p2;
-                const auto d =        2*p1;
-                *out++ = (uchar)qBound(0, (a + 2*b + 4*c + 8*d)/16, 255);
-            }
+    Data::Plane planes[MP_MAX_PLANES];
+    for (int i = 0; i < src->num_planes; ++i) {
+        auto &p = planes[i];
+        p.src = src->planes[i];
+        p.dst = dst->planes[i];
+        p.sstride = src->stride[i];
+        p.dstride = dst->stride[i];
+        p.rows = mp_image_plane_h(mpi, i);
+        p.samples = mp_image_plane_w(mpi, i) * desc.bytes[i] / (words ? 2 : 1);
+        p.ys = desc.ys[i];
+    }
+    auto slice = [&] (int from, int to) {
+        for (int i = 0; i < src->num_planes; ++i) {
+            const auto &p = planes[i];
+            const int first = from >> p.ys;
+            const int last = to >= h ? p.rows : to >> p.ys;
+            if (words)
+                d->rows<quint16>(method, top, p, first, last, max);
+            else
+                d->rows<quint8>(method, top, p, first, last, max);
         }
-        break;
-    } default:
-        memcpy(dst->planes[0], src->planes[0], src->h*src->stride[0]);
-        break;
-    }
-    for (int i = 1; i < src->num_planes; ++i)
-        memcpy(dst->planes[i], src->planes[i],
-               (src->h >> src->fmt.ys[i]) * src->stride[i]);
+    };
+    // slices are aligned to 4 luma rows to keep chroma rows whole
+    SlicePool::instance().run(d->threads, h, 4, 64, slice);
     return dst;
 }
 
 auto BobDeinterlacer::newImage(const MpImage &mpi) const -> MpImage
 {
-    auto tmp = mp_image_pool_get(m_pool, mpi->imgfmt, mpi->stride[0], mpi->h);
+    auto tmp = mp_image_pool_get(d->pool, mpi->imgfmt, mpi->stride[0], mpi->h);
     auto img = mp_image_new_ref(tmp);
     talloc_free(tmp);
     img->w = mpi->w;
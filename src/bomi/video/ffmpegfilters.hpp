@@ -18,30 +18,48 @@ extern "C" {
 
 class FFmpegFilterGraph {
 public:
-    ~FFmpegFilterGraph() { release(); }
+    FFmpegFilterGraph();
+    ~FFmpegFilterGraph();
+    FFmpegFilterGraph(const FFmpegFilterGraph &) = delete;
+    auto operator = (const FFmpegFilterGraph &) -> FFmpegFilterGraph& = delete;
+    // input is referenced, not copied, until the graph drops it
     auto push(const MpImage &mpi) -> bool;
+    // output shares buffers of the graph
     auto pull() -> MpImage;
     auto initialize(const QString &opt, const QSize &s, mp_imgfmt fmt) -> bool;
+    // slice threads of filters which support them; zero for cpu count
+    // drops current graph which is rebuilt by next initialize()
+    auto setThreads(int threads) -> void;
     auto initialize(const QString &opt, const MpImage &mpi) -> bool
         { return initialize(opt, {mpi->w, mpi->h}, mpi->imgfmt); }
+    // frame shells ever allocated by all graphs; constant once frames flow
+    static auto allocations() -> int;
 private:
+    struct Bridge;
     auto release() -> void;
     auto linkGraph(AVFilterInOut *&in, AVFilterInOut *&out) -> bool;
     QString m_option;
     mp_imgfmt m_imgfmt = IMGFMT_NONE;
     QSize m_size = {0, 0};
+    int m_threads = 0;
     AVFilterGraph *m_graph = nullptr;
     AVFilterContext *m_src = nullptr, *m_sink = nullptr;
+    Bridge *m_bridge = nullptr;
 };
 
 class BobDeinterlacer {
 public:
-    BobDeinterlacer() { m_pool = mp_image_pool_new(10); }
-    ~BobDeinterlacer() { mp_image_pool_clear(m_pool); }
+    BobDeinterlacer();
+    ~BobDeinterlacer();
+    BobDeinterlacer(const BobDeinterlacer &) = delete;
+    auto operator = (const BobDeinterlacer &) -> BobDeinterlacer& = delete;
+    // number of slices of rows run in parallel; zero for cpu count
+    auto setThreads(int threads) -> void;
     auto field(DeintMethod method, const MpImage &src, bool top) const -> MpImage;
 private:
     auto newImage(const MpImage &mpi) const -> MpImage;
-    mp_image_pool *m_pool = nullptr;
+    struct Data;
+    Data *d;
 };
 
 
@@ -0,0 +1,123 @@
+#include "frametimer.hpp"
+#include "misc/log.hpp"
+#include <QTextStream>
+
+DECLARE_LOG_CONTEXT(Video)
+
+FrameTimer::FrameTimer()
+    : m_window(Window)
+{
+    m_clock.start();
+}
+
+auto FrameTimer::finish(Stage stage) -> void
+{
+    const auto nsec = qMin<qint64>(m_clock.nsecsElapsed() - m_started[stage], _Max<qint32>());
+    auto &spent = stage == Upload ? m_current.upload : m_current.render;
+    spent = qMin<qint64>(spent + nsec, _Max<qint32>());
+}
+
+auto FrameTimer::swapped() -> void
+{
+    if (m_current.render <= 0)
+        return; // no new video frame in this swap
+    m_current.present = m_clock.nsecsElapsed();
+    m_ring.push(&m_current, 1); // dropped if consumer is not running
+    m_current = FrameTiming();
+}
+
+auto FrameTimer::update() -> void
+{
+    const bool reset = m_reset.fetchAndStoreAcquire(0);
+    if (reset) {
+        m_ring.clear();
+        m_pos = m_count = 0;
+        m_last = -1;
+        m_stats = FrameTimingStats();
+    }
+    const double vsync = m_vsync.load() * 1e-3;
+    std::array<FrameTiming, 64> buffer;
+    int popped = 0, n = 0;
+    while ((n = m_ring.pop(buffer.data(), buffer.size())) > 0) {
+        // expected cadence from mean interval rounded up to vsync
+        qint64 sum = 0; int intervals = 0;
+        for (int i = 0; i < m_count; ++i) {
+            if (m_window[i].interval >= 0) {
+                sum += m_window[i].interval;
+                ++intervals;
+            }
+        }
+        const double mean = intervals ? sum * 1e-6 / intervals : 0.0;
+        double limit = 1.5 * mean;
+        if (vsync > 0 && mean > 0)
+            limit = (std::ceil(mean / vsync - 0.01) + 0.5) * vsync;
+        for (int i = 0; i < n; ++i) {
+            auto t = buffer[i];
+            if (m_last >= 0)
+                t.interval = qMin<qint64>(t.present - m_last, _Max<qint32>());
+            m_last = t.present;
+            ++m_stats.frames;
+            if (vsync > 0 && (t.upload + t.render) * 1e-6 > vsync)
+                ++m_stats.late;
+            if (limit > 0 && t.interval * 1e-6 > limit)
+                ++m_stats.missed;
+            m_window[m_pos] = t;
+            m_pos = (m_pos + 1) % Window;
+            m_count = qMin(m_count + 1, Window);
+        }
+        popped += n;
+    }
+    if (!popped && !reset)
+        return;
+    std::vector<qint32> sorted(m_count);
+    auto percentiles = [&] (qint32 FrameTiming::*field) {
+        auto end = sorted.begin();
+        for (int i = 0; i < m_count; ++i) {
+            if (m_window[i].*field >= 0)
+                *end++ = m_window[i].*field;
+        }
+        FrameTimePercentiles p;
+        const int count = end - sorted.begin();
+        if (count <= 0)
+            return p;
+        auto at = [&] (double r) {
+            const auto it = sorted.begin() + qMin<int>(count * r, count - 1);
+            std::nth_element(sorted.begin(), it, end);
+            return *it * 1e-6;
+        };
+        p.p50 = at(0.5);
+        p.p95 = at(0.95);
+        p.p99 = at(0.99);
+        return p;
+    };
+    m_stats.interval = percentiles(&FrameTiming::interval);
+    m_stats.upload = percentiles(&FrameTiming::upload);
+    m_stats.render = percentiles(&FrameTiming::render);
+    auto &snapshot = m_snapshots.back();
+    snapshot.stats = m_stats;
+    snapshot.window = m_window;
+    snapshot.pos = m_pos;
+    snapshot.count = m_count;
+    m_snapshots.publish();
+}
+
+auto FrameTimer::dump(const QString &fileName) const -> bool
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+        _Error("Cannot open '%%' to dump frame timings.", fileName);
+        return false;
+    }
+    QTextStream out(&file);
+    out << "present_ms,interval_ms,upload_ms,render_ms\n";
+    const auto &snapshot = m_snapshots.front();
+    const int first = snapshot.count < Window ? 0 : snapshot.pos;
+    for (int i = 0; i < snapshot.count; ++i) {
+        const auto &t = snapshot.window[(first + i) % Window];
+        out << t.present * 1e-6 << ',';
+        if (t.interval >= 0)
+            out << t.interval * 1e-6;
+        out << ',' << t.upload * 1e-6 << ',' << t.render * 1e-6 << '\n';
+    }
+    return out.status() == QTextStream::Ok;
+}
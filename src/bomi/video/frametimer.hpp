@@ -0,0 +1,72 @@
+#ifndef FRAMETIMER_HPP
+#define FRAMETIMER_HPP
+
+#include "misc/spscring.hpp"
+#include "misc/triplebuffer.hpp"
+#include <QElapsedTimer>
+
+// nsec; present is time since start of timer
+// interval is from previous present and filled by consumer
+struct FrameTiming {
+    qint64 present = 0;
+    qint32 upload = 0, render = 0, interval = -1;
+};
+
+struct FrameTimePercentiles {
+    double p50 = 0, p95 = 0, p99 = 0; // msec
+};
+
+struct FrameTimingStats {
+    FrameTimePercentiles interval, upload, render;
+    // late frames took longer than a vsync period to upload and render
+    // missed presents came later than the cadence of vsync allows
+    qint64 frames = 0, late = 0, missed = 0;
+};
+
+// timestamps of video frames through upload, render and present
+// render thread marks stages of each frame and pushes a record on swap into
+// a lock-free ring. it folds records into a window of recent frames from
+// time to time and publishes a snapshot which gui thread fetches.
+
+class FrameTimer {
+public:
+    enum Stage { Upload, Render };
+    FrameTimer();
+    // in render thread
+    auto start(Stage stage) -> void { m_started[stage] = m_clock.nsecsElapsed(); }
+    auto finish(Stage stage) -> void;
+    // records current frame if it has been rendered
+    auto swapped() -> void;
+    // folds records and publishes snapshot if any or if reset is requested
+    auto update() -> void;
+    // in gui thread; vsync is refresh period in msec or zero if unknown
+    auto setVsync(double vsync) -> void { m_vsync.store(qRound(vsync * 1e3)); }
+    // cleared by render thread in next update()
+    auto reset() -> void { m_reset.store(1); }
+    // true if a new snapshot has been published since last fetch()
+    auto fetch() -> bool { return m_snapshots.update(); }
+    // of last fetched snapshot
+    auto stats() const -> const FrameTimingStats& { return m_snapshots.front().stats; }
+    // CSV of frames in window of last fetched snapshot
+    auto dump(const QString &fileName) const -> bool;
+private:
+    static constexpr int Window = 1024;
+    struct Snapshot {
+        Snapshot(): window(Window) { }
+        FrameTimingStats stats;
+        std::vector<FrameTiming> window;
+        int pos = 0, count = 0;
+    };
+    QElapsedTimer m_clock;
+    std::array<qint64, 2> m_started{{0, 0}};
+    FrameTiming m_current;
+    SpscRing<FrameTiming> m_ring{256};
+    std::vector<FrameTiming> m_window;
+    int m_pos = 0, m_count = 0;
+    qint64 m_last = -1;
+    FrameTimingStats m_stats;
+    QAtomicInt m_vsync{0}, m_reset{0}; // usec
+    TripleBuffer<Snapshot> m_snapshots;
+};
+
+#endif // FRAMETIMER_HPP
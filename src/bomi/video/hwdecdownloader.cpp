@@ -0,0 +1,264 @@
+#include "hwdecdownloader.hpp"
+#include "misc/simd.hpp"
+#include "os/os.hpp"
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QElapsedTimer>
+extern "C" {
+#include <video/mp_image_pool.h>
+}
+
+class OsHwDecSource : public HwDecSource {
+public:
+    OsHwDecSource(mp_hwdec_ctx *ctx): m_ctx(ctx) { }
+    auto map(const mp_image *surface, mp_image *view) -> void* final
+        { return OS::hwAcc()->map(m_ctx, surface, view); }
+    auto unmap(void *handle) -> void final { OS::hwAcc()->unmap(m_ctx, handle); }
+    auto download(const mp_image *surface, mp_image_pool *pool) -> mp_image* final
+        { return OS::hwAcc()->download(m_ctx, surface, pool); }
+private:
+    mp_hwdec_ctx *m_ctx = nullptr;
+};
+
+auto HwDecSource::create(mp_hwdec_ctx *ctx) -> HwDecSource*
+{
+    return new OsHwDecSource(ctx);
+}
+
+auto MockHwDecSource::map(const mp_image *surface, mp_image *view) -> void*
+{
+    *view = mp_image();
+    mp_image_setfmt(view, surface->imgfmt);
+    mp_image_set_size(view, surface->w, surface->h);
+    for (int i = 0; i < surface->num_planes; ++i) {
+        view->planes[i] = surface->planes[i];
+        view->stride[i] = surface->stride[i];
+    }
+    return view;
+}
+
+auto MockHwDecSource::download(const mp_image *surface,
+                               mp_image_pool *pool) -> mp_image*
+{
+    auto src = const_cast<mp_image*>(surface);
+    auto img = mp_image_pool_get(pool, src->imgfmt, src->w, src->h);
+    if (!img)
+        return nullptr;
+    mp_image_copy(img, src);
+    mp_image_copy_attributes(img, src);
+    return img;
+}
+
+auto MockHwDecSource::surface(mp_imgfmt imgfmt, int w, int h) const -> MpImage
+{
+    auto mpi = MpImage::wrap(mp_image_alloc(imgfmt, w, h));
+    if (!mpi.isNull())
+        mp_image_clear(mpi.data(), 0, 0, w, h);
+    return mpi;
+}
+
+/******************************************************************************/
+
+#ifdef SIMD_HAS_AVX2
+// vmovntdqa fetches a whole line of write-combining memory at once
+// while plain loads read it piece by piece without caching
+SIMD_AVX2 SIA streamLoad(const uchar *src, int i) -> __m256i
+{
+    return _mm256_stream_load_si256((__m256i*)const_cast<uchar*>(src) + i);
+}
+
+SIMD_AVX2_ENTRY static auto streamRow(uchar *dst, const uchar *src, int bytes) -> void
+{
+    const int head = qMin<int>(bytes, (32 - quintptr(src) % 32) % 32);
+    memcpy(dst, src, head);
+    src += head; dst += head; bytes -= head;
+    for (; bytes >= 128; bytes -= 128, src += 128, dst += 128) {
+        const auto a = streamLoad(src, 0), b = streamLoad(src, 1),
+                   c = streamLoad(src, 2), d = streamLoad(src, 3);
+        _mm256_storeu_si256((__m256i*)dst, a);
+        _mm256_storeu_si256((__m256i*)dst + 1, b);
+        _mm256_storeu_si256((__m256i*)dst + 2, c);
+        _mm256_storeu_si256((__m256i*)dst + 3, d);
+    }
+    for (; bytes >= 32; bytes -= 32, src += 32, dst += 32)
+        _mm256_storeu_si256((__m256i*)dst, streamLoad(src, 0));
+    memcpy(dst, src, bytes);
+}
+#endif
+
+auto HwDecDownloader::copy(mp_image *dst, const mp_image *src) -> void
+{
+#ifdef SIMD_HAS_AVX2
+    if (Simd::isa() == Simd::Avx2) {
+        _mm_mfence(); // streaming loads are weakly ordered
+        for (int i = 0; i < dst->num_planes; ++i) {
+            const int rows = mp_image_plane_h(dst, i);
+            const int bytes = mp_image_plane_w(dst, i) * dst->fmt.bytes[i];
+            for (int y = 0; y < rows; ++y)
+                streamRow(dst->planes[i] + y * dst->stride[i],
+                          src->planes[i] + y * src->stride[i], bytes);
+        }
+        return;
+    }
+#endif
+    mp_image_copy(dst, const_cast<mp_image*>(src));
+}
+
+/******************************************************************************/
+
+// pool is touched only in worker
+// jobs are reused in a ring, so the runnable must not be auto-deleted
+struct DownloadJob : public QRunnable {
+    DownloadJob(HwDecSource *source, mp_image_pool *pool)
+        : source(source), pool(pool) { setAutoDelete(false); }
+    auto run() -> void final;
+    HwDecSource *source = nullptr;
+    mp_image_pool *pool = nullptr;
+    MpImage surface, copy;
+    QSemaphore done;
+    qint64 nsec = 0;
+    bool mapped = false;
+};
+
+auto DownloadJob::run() -> void
+{
+    QElapsedTimer timer;
+    timer.start();
+    const auto mpi = surface.data();
+    mp_image view;
+    if (auto handle = source->map(mpi, &view)) {
+        auto img = mp_image_pool_get(pool, view.imgfmt, view.w, view.h);
+        if (img) {
+            HwDecDownloader::copy(img, &view);
+            mp_image_copy_attributes(img, const_cast<mp_image*>(mpi));
+            copy = MpImage::wrap(img);
+            mapped = true;
+        }
+        source->unmap(handle);
+    } else if (auto img = source->download(mpi, pool))
+        copy = MpImage::wrap(img);
+    surface.release();
+    nsec = timer.nsecsElapsed();
+    done.release();
+}
+
+struct HwDecDownloader::Data {
+    HwDecSource *source = nullptr;
+    mp_image_pool *pool = nullptr;
+    int depth = 0;
+    // ring of jobs; count of them from head are pending
+    std::vector<DownloadJob*> jobs;
+    int head = 0, count = 0;
+    QThreadPool worker;
+    mutable QMutex mutex;
+    HwDecDownloadStats sum; // total msec instead of average
+    auto job(int i) const -> DownloadJob*
+        { return jobs[(head + i) % jobs.size()]; }
+};
+
+HwDecDownloader::HwDecDownloader(HwDecSource *source)
+    : d(new Data)
+{
+    d->source = source;
+    d->worker.setMaxThreadCount(1);
+    setLatency(1);
+}
+
+HwDecDownloader::~HwDecDownloader()
+{
+    clear();
+    d->worker.waitForDone();
+    qDeleteAll(d->jobs);
+    talloc_free(d->pool);
+    delete d->source;
+    delete d;
+}
+
+auto HwDecDownloader::setLatency(int ahead, int held) -> void
+{
+    // one more for a copy in progress while caller holds others
+    if (!_Change(d->depth, ahead + held + 1) && d->pool)
+        return;
+    clear();
+    d->worker.waitForDone();
+    talloc_free(d->pool);
+    d->pool = MpImage::newPool(d->depth);
+    // frames requested ahead and the one requested before next take()
+    qDeleteAll(d->jobs);
+    d->jobs.clear();
+    for (int i = 0; i < qMax(1, ahead) + 1; ++i)
+        d->jobs.push_back(new DownloadJob(d->source, d->pool));
+}
+
+auto HwDecDownloader::request(const MpImage &surface) -> void
+{
+    if (d->count == (int)d->jobs.size()) {
+        // caller is further ahead than told; the new job becomes the tail
+        d->jobs.insert(d->jobs.begin() + d->head, new DownloadJob(d->source, d->pool));
+        ++d->head;
+    }
+    auto job = d->job(d->count++);
+    job->surface = surface;
+    job->mapped = false;
+    job->nsec = 0;
+    d->worker.start(job);
+}
+
+auto HwDecDownloader::pending() const -> int
+{
+    return d->count;
+}
+
+auto HwDecDownloader::take() -> MpImage
+{
+    if (!d->count)
+        return MpImage();
+    auto job = d->job(0);
+    d->head = (d->head + 1) % d->jobs.size();
+    --d->count;
+    QElapsedTimer timer;
+    timer.start();
+    job->done.acquire();
+    const auto wait = timer.nsecsElapsed();
+    auto img = std::move(job->copy);
+    d->mutex.lock();
+    auto &s = d->sum;
+    ++s.frames;
+    if (!img.isNull()) {
+        for (int i = 0; i < img->num_planes; ++i)
+            s.bytes += mp_image_plane_w(img.data(), i) * img->fmt.bytes[i]
+                       * mp_image_plane_h(img.data(), i);
+    }
+    s.mapped += job->mapped;
+    s.copy += job->nsec * 1e-6;
+    s.wait += wait * 1e-6;
+    d->mutex.unlock();
+    return img;
+}
+
+auto HwDecDownloader::clear() -> void
+{
+    for (int i = 0; i < d->count; ++i) {
+        auto job = d->job(i);
+        job->done.acquire();
+        job->copy.release();
+    }
+    d->head = d->count = 0;
+}
+
+auto HwDecDownloader::stats() const -> HwDecDownloadStats
+{
+    QMutexLocker locker(&d->mutex);
+    auto stats = d->sum;
+    if (stats.frames > 0) {
+        stats.copy /= stats.frames;
+        stats.wait /= stats.frames;
+    }
+    return stats;
+}
+
+auto HwDecDownloader::resetStats() -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->sum = HwDecDownloadStats();
+}
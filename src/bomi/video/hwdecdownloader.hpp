@@ -0,0 +1,68 @@
+#ifndef HWDECDOWNLOADER_HPP
+#define HWDECDOWNLOADER_HPP
+
+#include "mpimage.hpp"
+
+struct mp_hwdec_ctx;                    struct mp_image_pool;
+
+// gives access to decoded surfaces in system memory
+class HwDecSource {
+public:
+    virtual ~HwDecSource() = default;
+    // maps surface into view which may be uncached memory
+    // returns handle for unmap() or null if surface cannot be mapped
+    virtual auto map(const mp_image *surface, mp_image *view) -> void* = 0;
+    virtual auto unmap(void *handle) -> void = 0;
+    // copied by driver when surface cannot be mapped
+    virtual auto download(const mp_image *surface,
+                          mp_image_pool *pool) -> mp_image* = 0;
+    // hardware decoder of OS::hwAcc()
+    static auto create(mp_hwdec_ctx *ctx) -> HwDecSource*;
+};
+
+// surfaces in system memory for testing without GPU
+class MockHwDecSource : public HwDecSource {
+public:
+    auto map(const mp_image *surface, mp_image *view) -> void* final;
+    auto unmap(void *handle) -> void final { Q_UNUSED(handle); }
+    auto download(const mp_image *surface, mp_image_pool *pool) -> mp_image* final;
+    // black surface; fill planes to make a picture
+    auto surface(mp_imgfmt imgfmt, int w, int h) const -> MpImage;
+};
+
+struct HwDecDownloadStats {
+    qint64 frames = 0, bytes = 0;
+    qint64 mapped = 0; // frames copied by streaming loads from mapped view
+    double copy = 0;   // msec per frame spent in worker
+    double wait = 0;   // msec per frame blocked in take()
+};
+
+// copies surfaces to system memory in background
+// copy of next frame overlaps with processing of previous one: request()
+// some frames ahead of take(). copies come from a pool deep enough for frames
+// requested ahead and held by caller.
+
+class HwDecDownloader {
+public:
+    HwDecDownloader(HwDecSource *source); // takes ownership
+    HwDecDownloader(const HwDecDownloader &) = delete;
+    HwDecDownloader &operator = (const HwDecDownloader &) = delete;
+    ~HwDecDownloader();
+    // frames which caller requests ahead of take() and holds after it
+    auto setLatency(int ahead, int held = 1) -> void;
+    auto request(const MpImage &surface) -> void;
+    auto pending() const -> int;
+    // waits for oldest requested copy; null if none pending or failed
+    auto take() -> MpImage;
+    // drops pending copies
+    auto clear() -> void;
+    auto stats() const -> HwDecDownloadStats;
+    auto resetStats() -> void;
+    // copies rows from uncached memory; falls back to memcpy
+    static auto copy(mp_image *dst, const mp_image *src) -> void;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // HWDECDOWNLOADER_HPP
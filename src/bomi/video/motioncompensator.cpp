@@ -0,0 +1,394 @@
+#include "motioncompensator.hpp"
+#include "mpimage.hpp"
+#include "misc/simd.hpp"
+#include "misc/slicepool.hpp"
+extern "C" {
+#include <video/mp_image_pool.h>
+}
+
+static constexpr int Block = 8;       // in pixels of each level
+static constexpr int MaxLevels = 5;
+static constexpr int CoarseRange = 4; // full search at the coarsest level
+static constexpr int Lambda = 4;      // penalty per pixel of deviation
+static constexpr int CutCost = 24;    // mean SAD per pixel for scene change
+
+static auto sadScalar(const uchar *a, int as, const uchar *b, int bs) -> int
+{
+    int sum = 0;
+    for (int y = 0; y < Block; ++y, a += as, b += bs) {
+        for (int x = 0; x < Block; ++x)
+            sum += std::abs(a[x] - b[x]);
+    }
+    return sum;
+}
+
+#ifdef SIMD_HAS_SSE2
+static auto sadSse2(const uchar *a, int as, const uchar *b, int bs) -> int
+{
+    auto sum = _mm_setzero_si128();
+    for (int y = 0; y < Block; ++y, a += as, b += bs) {
+        const auto pa = _mm_loadl_epi64((const __m128i*)a);
+        const auto pb = _mm_loadl_epi64((const __m128i*)b);
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(pa, pb));
+    }
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+struct Motion { int x = 0, y = 0, cost = 0; };
+
+struct MotionField {
+    int w = 0, h = 0;
+    std::vector<Motion> motions;
+    auto resize(int w, int h) -> void
+        { this->w = w; this->h = h; motions.resize(w * h); }
+    auto at(int x, int y) -> Motion& { return motions[y * w + x]; }
+    auto at(int x, int y) const -> const Motion&
+        { return motions[qBound(0, y, h - 1) * w + qBound(0, x, w - 1)]; }
+};
+
+struct Level {
+    int w = 0, h = 0, stride = 0;
+    const uchar *p = nullptr;
+    std::vector<uchar> data;
+    auto line(int y) const -> const uchar* { return p + y * stride; }
+};
+
+struct Pyramid {
+    MpImage image;
+    int count = 0;
+    Level levels[MaxLevels];
+};
+
+// integer offset and fraction in 1/16
+struct Tap {
+    Tap(double v = 0) { const int f = qRound(v * 16); i = f >> 4; f16 = f & 15; }
+    int i, f16;
+};
+
+// per block of finest field and plane for a phase
+struct Warp {
+    Tap ax, ay, bx, by; // offsets in prev and next
+    int weight = 128;   // weight of next in 1/256
+};
+
+struct MotionCompensator::Data {
+    int threads = 0; // slices on SlicePool::instance()
+    mp_image_pool *pool = nullptr;
+    Pyramid pyramids[2], *prev = &pyramids[0], *next = &pyramids[1];
+    MotionField forward[MaxLevels], backward[MaxLevels];
+    int finest = 0;
+    bool cut = true;
+    std::vector<Warp> warps[4];
+    auto (*sad)(const uchar *a, int as, const uchar *b, int bs) -> int = sadScalar;
+
+    auto build(Pyramid &pyramid, const MpImage &mpi) -> void;
+    auto search(MotionField *fields, int l, const Pyramid &src, const Pyramid &ref) -> void;
+    auto plan(const mp_image *mpi, double phase) -> void;
+    auto warp(mp_image *out, int from, int to) const -> void;
+};
+
+auto MotionCompensator::Data::build(Pyramid &pyramid, const MpImage &mpi) -> void
+{
+    pyramid.image = mpi;
+    auto &base = pyramid.levels[0];
+    base.w = mpi->w;
+    base.h = mpi->h;
+    base.stride = mpi->stride[0];
+    base.p = mpi->planes[0];
+    pyramid.count = 1;
+    for (int l = 1; l < MaxLevels; ++l) {
+        const auto &src = pyramid.levels[l - 1];
+        if (src.w < 192 || src.h < 96)
+            break;
+        auto &dst = pyramid.levels[l];
+        dst.w = src.w / 2;
+        dst.h = src.h / 2;
+        dst.stride = dst.w;
+        dst.data.resize(dst.stride * dst.h);
+        dst.p = dst.data.data();
+        SlicePool::instance().run(threads, dst.h, 1, 64, [&] (int from, int to) {
+            for (int y = from; y < to; ++y) {
+                auto out = dst.data.data() + y * dst.stride;
+                auto s0 = src.line(2 * y), s1 = src.line(2 * y + 1);
+                for (int x = 0; x < dst.w; ++x, s0 += 2, s1 += 2)
+                    out[x] = (s0[0] + s0[1] + s1[0] + s1[1] + 2) >> 2;
+            }
+        });
+        ++pyramid.count;
+    }
+}
+
+// motion of blocks in src found in ref
+auto MotionCompensator::Data::search(MotionField *fields, int l, const Pyramid &src,
+                                     const Pyramid &ref) -> void
+{
+    const auto &s = src.levels[l], &r = ref.levels[l];
+    const auto *parent = l + 1 < src.count ? &fields[l + 1] : nullptr;
+    auto &field = fields[l];
+    field.resize((s.w + Block - 1) / Block, (s.h + Block - 1) / Block);
+    SlicePool::instance().run(threads, field.h, 1, 4, [&] (int from, int to) {
+        for (int by = from; by < to; ++by) {
+            const int oy = qMin(by * Block, s.h - Block);
+            for (int bx = 0; bx < field.w; ++bx) {
+                const int ox = qMin(bx * Block, s.w - Block);
+                const auto block = s.line(oy) + ox;
+                Motion pred;
+                if (parent) {
+                    pred = parent->at(bx / 2, by / 2);
+                    pred.x *= 2; pred.y *= 2;
+                }
+                Motion best;
+                best.cost = _Max<int>();
+                auto test = [&] (int x, int y) {
+                    if (ox + x < 0 || oy + y < 0 || ox + x > r.w - Block || oy + y > r.h - Block)
+                        return false;
+                    const int sad = this->sad(block, s.stride, r.line(oy + y) + ox + x, r.stride);
+                    const int cost = sad + Lambda * (std::abs(x - pred.x) + std::abs(y - pred.y));
+                    if (cost >= best.cost)
+                        return false;
+                    best.x = x; best.y = y; best.cost = cost;
+                    return true;
+                };
+                test(0, 0);
+                if (!parent) {
+                    for (int y = -CoarseRange; y <= CoarseRange; ++y)
+                        for (int x = -CoarseRange; x <= CoarseRange; ++x)
+                            test(x, y);
+                } else {
+                    for (int y = -1; y <= 1; ++y) {
+                        for (int x = -1; x <= 1; ++x) {
+                            const auto &c = parent->at(bx / 2 + x, by / 2 + y);
+                            test(c.x * 2, c.y * 2);
+                        }
+                    }
+                }
+                // refine until no neighbor is better
+                for (int i = 0; i < 4; ++i) {
+                    const int cx = best.x, cy = best.y;
+                    bool moved = false;
+                    for (int y = -1; y <= 1; ++y)
+                        for (int x = -1; x <= 1; ++x)
+                            moved |= (x || y) && test(cx + x, cy + y);
+                    if (!moved)
+                        break;
+                }
+                best.cost -= Lambda * (std::abs(best.x - pred.x) + std::abs(best.y - pred.y));
+                field.at(bx, by) = best;
+            }
+        }
+    });
+}
+
+auto MotionCompensator::Data::plan(const mp_image *mpi, double phase) -> void
+{
+    const auto &f = forward[finest], &b = backward[finest];
+    const int scale = 1 << finest;
+    auto block = [&] (int x) { return (int)std::floor(x / double(Block)); };
+    for (int i = 0; i < mpi->num_planes; ++i)
+        warps[i].resize(f.w * f.h);
+    for (int by = 0; by < f.h; ++by) {
+        for (int bx = 0; bx < f.w; ++bx) {
+            const auto &mf = f.at(bx, by), &mb = b.at(bx, by);
+            const int cx = bx * Block + Block / 2, cy = by * Block + Block / 2;
+            // consistency: following motion and coming back should meet
+            const auto &rf = b.at(block(cx + mf.x), block(cy + mf.y));
+            const auto &rb = f.at(block(cx + mb.x), block(cy + mb.y));
+            const bool okf = std::abs(mf.x + rf.x) + std::abs(mf.y + rf.y) <= 2;
+            const bool okb = std::abs(mb.x + rb.x) + std::abs(mb.y + rb.y) <= 2;
+            // motion from prev to next in luma pixels
+            double x = 0, y = 0;
+            int weight = 0;
+            if (mf.cost <= mb.cost) {
+                x = mf.x * scale; y = mf.y * scale;
+            } else {
+                x = -mb.x * scale; y = -mb.y * scale;
+            }
+            if (okf && okb)
+                weight = qRound(phase * 256);
+            else if (okf) // appears in next
+                weight = 256;
+            else if (okb) // disappears in next
+                weight = 0;
+            else {
+                x = y = 0;
+                weight = phase < 0.5 ? 0 : 256;
+            }
+            for (int i = 0; i < mpi->num_planes; ++i) {
+                const double vx = x / (1 << mpi->fmt.xs[i]), vy = y / (1 << mpi->fmt.ys[i]);
+                auto &w = warps[i][by * f.w + bx];
+                w.ax = Tap(-phase * vx); w.ay = Tap(-phase * vy);
+                w.bx = Tap((1 - phase) * vx); w.by = Tap((1 - phase) * vy);
+                w.weight = weight;
+            }
+        }
+    }
+}
+
+auto MotionCompensator::Data::warp(mp_image *out, int from, int to) const -> void
+{
+    const auto a = prev->image.data(), b = next->image.data();
+    const auto &desc = out->fmt;
+    const int size = Block << finest, cols = forward[finest].w, rows = forward[finest].h;
+    for (int i = 0; i < out->num_planes; ++i) {
+        const int xs = desc.xs[i], ys = desc.ys[i], e = desc.bytes[i];
+        const int pw = mp_image_plane_w(out, i), ph = mp_image_plane_h(out, i);
+        const int first = from >> ys, last = to >= out->h ? ph : to >> ys;
+        const int as = a->stride[i], bs = b->stride[i];
+        for (int py = first; py < last; ++py) {
+            const int by = qMin((py << ys) / size, rows - 1);
+            const auto blocks = warps[i].data() + by * cols;
+            auto dst = out->planes[i] + py * out->stride[i];
+            for (int bx = 0; bx < cols; ++bx) {
+                const int x0 = (bx * size) >> xs;
+                const int x1 = bx + 1 < cols ? qMin(pw, ((bx + 1) * size) >> xs) : pw;
+                if (x0 >= x1)
+                    continue;
+                const auto &w = blocks[bx];
+                const int wb = w.weight, wa = 256 - wb;
+                auto inside = [&] (const Tap &tx, const Tap &ty) {
+                    return py + ty.i >= 0 && py + ty.i + 1 < ph
+                        && x0 + tx.i >= 0 && x1 + tx.i < pw;
+                };
+                if (inside(w.ax, w.ay) && inside(w.bx, w.by)) {
+                    // fast path without clamping; weights of two bilinears in 1/256
+                    const auto a0 = a->planes[i] + (py + w.ay.i) * as + w.ax.i * e, a1 = a0 + as;
+                    const auto b0 = b->planes[i] + (py + w.by.i) * bs + w.bx.i * e, b1 = b0 + bs;
+                    const int a00 = (16 - w.ax.f16) * (16 - w.ay.f16), a01 = w.ax.f16 * (16 - w.ay.f16);
+                    const int a10 = (16 - w.ax.f16) * w.ay.f16, a11 = w.ax.f16 * w.ay.f16;
+                    const int b00 = (16 - w.bx.f16) * (16 - w.by.f16), b01 = w.bx.f16 * (16 - w.by.f16);
+                    const int b10 = (16 - w.bx.f16) * w.by.f16, b11 = w.bx.f16 * w.by.f16;
+                    int j = x0 * e;
+#ifdef SIMD_HAS_SSE2
+                    // all sums fit in 16 bits because weights sum to 256
+                    const auto zero = _mm_setzero_si128();
+                    auto load = [&] (const uchar *p)
+                        { return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), zero); };
+                    auto bilinear = [&] (const uchar *r0, const uchar *r1, int w00, int w01, int w10, int w11) {
+                        auto sum = _mm_mullo_epi16(load(r0), _mm_set1_epi16(w00));
+                        sum = _mm_add_epi16(sum, _mm_mullo_epi16(load(r0 + e), _mm_set1_epi16(w01)));
+                        sum = _mm_add_epi16(sum, _mm_mullo_epi16(load(r1), _mm_set1_epi16(w10)));
+                        sum = _mm_add_epi16(sum, _mm_mullo_epi16(load(r1 + e), _mm_set1_epi16(w11)));
+                        return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+                    };
+                    for (; j + 8 <= x1 * e; j += 8) {
+                        const auto pa = bilinear(a0 + j, a1 + j, a00, a01, a10, a11);
+                        const auto pb = bilinear(b0 + j, b1 + j, b00, b01, b10, b11);
+                        auto sum = _mm_add_epi16(_mm_mullo_epi16(pa, _mm_set1_epi16(wa)),
+                                                 _mm_mullo_epi16(pb, _mm_set1_epi16(wb)));
+                        sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+                        _mm_storel_epi64((__m128i*)(dst + j), _mm_packus_epi16(sum, zero));
+                    }
+#endif
+                    for (; j < x1 * e; ++j) {
+                        const int pa = (a0[j] * a00 + a0[j + e] * a01 + a1[j] * a10 + a1[j + e] * a11 + 128) >> 8;
+                        const int pb = (b0[j] * b00 + b0[j + e] * b01 + b1[j] * b10 + b1[j + e] * b11 + 128) >> 8;
+                        dst[j] = (pa * wa + pb * wb + 128) >> 8;
+                    }
+                } else {
+                    auto sample = [&] (const mp_image *img, const Tap &tx, const Tap &ty, int x, int c) {
+                        const int y0 = qBound(0, py + ty.i, ph - 1), y1 = qMin(y0 + 1, ph - 1);
+                        const int xa = qBound(0, x + tx.i, pw - 1), xb = qMin(xa + 1, pw - 1);
+                        auto r0 = img->planes[i] + y0 * img->stride[i] + c;
+                        auto r1 = img->planes[i] + y1 * img->stride[i] + c;
+                        const int top = r0[xa * e] * (16 - tx.f16) + r0[xb * e] * tx.f16;
+                        const int bottom = r1[xa * e] * (16 - tx.f16) + r1[xb * e] * tx.f16;
+                        return (top * (16 - ty.f16) + bottom * ty.f16 + 128) >> 8;
+                    };
+                    for (int x = x0; x < x1; ++x) {
+                        for (int c = 0; c < e; ++c) {
+                            const int pa = sample(a, w.ax, w.ay, x, c);
+                            const int pb = sample(b, w.bx, w.by, x, c);
+                            dst[x * e + c] = (pa * wa + pb * wb + 128) >> 8;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+MotionCompensator::MotionCompensator()
+    : d(new Data)
+{
+    d->pool = MpImage::newPool(4);
+#ifdef SIMD_HAS_SSE2
+    d->sad = sadSse2;
+#endif
+}
+
+MotionCompensator::~MotionCompensator()
+{
+    reset();
+    talloc_free(d->pool);
+    delete d;
+}
+
+auto MotionCompensator::setThreads(int threads) -> void
+{
+    d->threads = threads;
+}
+
+auto MotionCompensator::supports(const mp_image *mpi) -> bool
+{
+    const auto &desc = mpi->fmt;
+    const int flags = MP_IMGFLAG_YUV | MP_IMGFLAG_PLANAR | MP_IMGFLAG_BYTE_ALIGNED;
+    return (desc.flags & flags) == flags && !(desc.flags & MP_IMGFLAG_HWACCEL)
+            && desc.component_bits == 8 && desc.bytes[0] == 1
+            && mpi->w >= 4 * Block && mpi->h >= 4 * Block;
+}
+
+auto MotionCompensator::reset() -> void
+{
+    d->prev->image.release();
+    d->next->image.release();
+    d->cut = true;
+}
+
+auto MotionCompensator::isSceneChange() const -> bool
+{
+    return d->cut;
+}
+
+auto MotionCompensator::estimate(const MpImage &prev, const MpImage &next) -> bool
+{
+    d->cut = true;
+    if (prev.isNull() || next.isNull() || !supports(prev.data())
+            || prev->imgfmt != next->imgfmt || prev->w != next->w || prev->h != next->h)
+        return false;
+    // the pyramid of last next is reused for prev
+    if (d->next->image.isNull() || d->next->image->planes[0] != prev->planes[0])
+        d->build(*d->next, prev);
+    std::swap(d->prev, d->next);
+    d->build(*d->next, next);
+
+    const int levels = d->prev->count;
+    d->finest = levels > 2 && d->prev->levels[0].w >= 1280 ? 1 : 0;
+    for (int l = levels - 1; l >= d->finest; --l) {
+        d->search(d->forward, l, *d->prev, *d->next);
+        d->search(d->backward, l, *d->next, *d->prev);
+    }
+    const auto &f = d->forward[d->finest];
+    qint64 cost = 0;
+    for (auto &m : f.motions)
+        cost += m.cost;
+    d->cut = cost > qint64(CutCost) * Block * Block * f.motions.size();
+    return true;
+}
+
+auto MotionCompensator::synthesize(double phase) -> MpImage
+{
+    const auto &a = d->prev->image, &b = d->next->image;
+    if (a.isNull() || b.isNull())
+        return MpImage();
+    phase = qBound(0.0, phase, 1.0);
+    if (d->cut || phase <= 0.0 || phase >= 1.0)
+        return phase < 0.5 ? a : b;
+    auto out = mp_image_pool_get(d->pool, a->imgfmt, a->w, a->h);
+    if (!out)
+        return phase < 0.5 ? a : b;
+    mp_image_copy_attributes(out, const_cast<mp_image*>(a.data()));
+    d->plan(a.data(), phase);
+    SlicePool::instance().run(d->threads, out->h, 4, 32, [&] (int from, int to) { d->warp(out, from, to); });
+    return MpImage::wrap(out);
+}
@@ -0,0 +1,33 @@
+#ifndef MOTIONCOMPENSATOR_HPP
+#define MOTIONCOMPENSATOR_HPP
+
+class MpImage;                          struct mp_image;
+
+// Synthesizes frames between two source frames.
+// Motion is estimated by hierarchical block matching on a pyramid of luma in
+// both directions and intermediate frames are warped from both sides with
+// weights which follow consistency of forward and backward motion.
+
+class MotionCompensator {
+public:
+    MotionCompensator();
+    ~MotionCompensator();
+    MotionCompensator(const MotionCompensator &) = delete;
+    auto operator = (const MotionCompensator &) -> MotionCompensator& = delete;
+    // zero for cpu count
+    auto setThreads(int threads) -> void;
+    // 8-bit planar YUV in memory
+    static auto supports(const mp_image *mpi) -> bool;
+    // estimates motion from prev to next; false if they cannot be compensated
+    auto estimate(const MpImage &prev, const MpImage &next) -> bool;
+    // true if the last estimation found no usable motion like scene change
+    auto isSceneChange() const -> bool;
+    // frame at phase in [0, 1] from prev to next of last estimation
+    auto synthesize(double phase) -> MpImage;
+    auto reset() -> void;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // MOTIONCOMPENSATOR_HPP
@@ -1,4 +1,5 @@
 #include "motioninterpolator.hpp"
+#include "motioncompensator.hpp"
 #include "mpimage.hpp"
 #include "misc/log.hpp"
 #include "tmp/algorithm.hpp"
@@ -6,7 +7,9 @@
 struct MotionInterpolator::Data {
     MotionInterpolator *p = nullptr;
     std::deque<MpImage> queue;
-    bool eof = false;
+    MotionCompensator compensator;
+    MpImage prev; // last source frame with its own pts
+    bool eof = false, compensate = true;
     double dt = -1;
     auto next() const -> double
     {
@@ -50,15 +53,27 @@ auto MotionInterpolator::push(MpImage &&mpi) -> void
     d->eof = mpi.isNull();
     if (d->eof)
         return;
-    if (d->queue.empty() || d->dt < 0 || mpi->pts < d->next())
-        d->push(std::move(mpi), mpi->pts, false);
+    const double pts = mpi->pts;
+    if (d->queue.empty() || d->dt < 0 || pts < d->next())
+        d->push(MpImage(mpi), pts, false);
     else {
+        // frames on the grid between prev and mpi are warped from both
+        const double span = d->prev.isNull() ? 0.0 : pts - d->prev->pts;
+        const bool warp = d->compensate && span > 0 && span < 1.0
+                && d->compensator.estimate(d->prev, mpi);
         int additional = 0;
         do {
-            d->push(std::move(MpImage(mpi)), d->next(), additional);
+            const double next = d->next();
+            MpImage frame;
+            if (warp)
+                frame = d->compensator.synthesize((next - d->prev->pts) / span);
+            if (frame.isNull())
+                frame = mpi;
+            d->push(std::move(frame), next, additional);
             additional = MP_IMGFIELD_ADDITIONAL;
-        } while (d->next() < mpi->pts);
+        } while (d->next() < pts);
     }
+    d->prev = std::move(mpi);
 }
 
 auto MotionInterpolator::needsMore() const -> bool
@@ -76,6 +91,8 @@ auto MotionInterpolator::pop() -> MpImage
 auto MotionInterpolator::clear() -> void
 {
     d->queue.clear();
+    d->prev.release();
+    d->compensator.reset();
     d->eof = false;
 }
 
@@ -84,6 +101,12 @@ auto MotionInterpolator::setTargetFps(double fps) -> void
     d->dt = 1.0/fps;
 }
 
+auto MotionInterpolator::setMotionCompensation(bool on) -> void
+{
+    if (_Change(d->compensate, on) && !on)
+        d->compensator.reset();
+}
+
 auto MotionInterpolator::fpsManipulation() const -> double
 {
     return 1.0/d->dt;
@@ -14,6 +14,8 @@ public:
     auto clear() -> void;
     auto needsMore() const -> bool;
     auto setTargetFps(double fpsManipulation) -> void;
+    // synthesize frames between source frames instead of repeating them
+    auto setMotionCompensation(bool on) -> void;
     auto fpsManipulation() const -> double final;
 private:
     struct Data;
@@ -2,10 +2,11 @@
 #include "os/os.hpp"
 #include "misc/json.hpp"
 #include <QRadioButton>
+#include <QCheckBox>
 
 #define JSON_CLASS MotionIntrplOption
 
-static const auto jio = JIO(JE(sync_to_monitor), JE(target_fps));
+static const auto jio = JIO(JE(sync_to_monitor), JE(target_fps), JE(motion_compensation));
 
 JSON_DECLARE_FROM_TO_FUNCTIONS
 
@@ -22,6 +23,7 @@ struct MotionIntrplOptionWidget::Data {
     QButtonGroup *g = nullptr;
     QLabel *detected = nullptr;
     QDoubleSpinBox *fps = nullptr;
+    QCheckBox *compensation = nullptr;
 };
 
 MotionIntrplOptionWidget::MotionIntrplOptionWidget(QWidget *parent)
@@ -52,6 +54,9 @@ MotionIntrplOptionWidget::MotionIntrplOptionWidget(QWidget *parent)
     hbox->addItem(new QSpacerItem(0, 0, QSizePolicy::Expanding));
     vbox->addLayout(hbox);
 
+    d->compensation = new QCheckBox(tr("Synthesize intermediate frames by motion compensation"));
+    vbox->addWidget(d->compensation);
+
     setLayout(vbox);
 
     d->g->addButton(r1, Sync);
@@ -60,6 +65,7 @@ MotionIntrplOptionWidget::MotionIntrplOptionWidget(QWidget *parent)
     auto signal = &MotionIntrplOptionWidget::optionChanged;
     PLUG_CHANGED(d->g);
     PLUG_CHANGED(d->fps);
+    PLUG_CHANGED(d->compensation);
     connect(r2, &QRadioButton::toggled, d->fps, &QWidget::setEnabled);
     d->fps->setEnabled(false);
 }
@@ -74,6 +80,7 @@ auto MotionIntrplOptionWidget::option() const -> MotionIntrplOption
     MotionIntrplOption option;
     option.sync_to_monitor = d->g->checkedId() == Sync;
     option.target_fps = d->fps->value();
+    option.motion_compensation = d->compensation->isChecked();
     return option;
 }
 
@@ -84,6 +91,7 @@ auto MotionIntrplOptionWidget::setOption(const MotionIntrplOption &option) -> vo
     else
         d->g->button(Target)->setChecked(true);
     d->fps->setValue(option.target_fps);
+    d->compensation->setChecked(option.motion_compensation);
 }
 
 auto MotionIntrplOptionWidget::showEvent(QShowEvent *e) -> void
@@ -3,9 +3,11 @@
 
 struct MotionIntrplOption
 {
-    DECL_EQ(MotionIntrplOption, &T::sync_to_monitor, &T::target_fps)
+    DECL_EQ(MotionIntrplOption, &T::sync_to_monitor, &T::target_fps,
+            &T::motion_compensation)
     bool sync_to_monitor = true;
     double target_fps = 60;
+    bool motion_compensation = true;
     auto fps() const -> double;
     auto toJson() const -> QJsonObject;
     auto setFromJson(const QJsonObject &json) -> bool;
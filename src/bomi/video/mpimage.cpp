@@ -1 +1,24 @@
 #include "mpimage.hpp"
+extern "C" {
+#include <video/mp_image_pool.h>
+}
+
+static QAtomicInt s_allocations{0};
+
+static auto allocate(void *, int imgfmt, int w, int h) -> mp_image*
+{
+    s_allocations.ref();
+    return mp_image_alloc(imgfmt, w, h);
+}
+
+auto MpImage::newPool(int max) -> mp_image_pool*
+{
+    auto pool = mp_image_pool_new(max);
+    mp_image_pool_set_allocator(pool, allocate, nullptr);
+    return pool;
+}
+
+auto MpImage::allocations() -> int
+{
+    return s_allocations.load();
+}
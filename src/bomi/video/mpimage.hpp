@@ -9,6 +9,8 @@ extern "C" {
 #undef bool
 #endif
 
+struct mp_image_pool;
+
 class MpImage {
 public:
     MpImage() { }
@@ -37,6 +39,10 @@ public:
     static auto wrap(mp_image *mpi) -> MpImage { return MpImage(mpi); }
     static auto wrap(mp_image *mpi, bool ref) -> MpImage
         { return ref ? MpImage::ref(mpi) : wrap(mpi); }
+    // pool whose new images are counted by allocations()
+    static auto newPool(int max) -> mp_image_pool*;
+    // images ever allocated by pools of newPool()
+    static auto allocations() -> int;
 private:
     static auto makeRef(mp_image *m) -> mp_image*
         { return m ? mp_image_new_ref(m) : nullptr; }
@@ -0,0 +1,426 @@
+#include "scenescanner.hpp"
+#include "misc/simd.hpp"
+#include "misc/log.hpp"
+#include <QCryptographicHash>
+extern "C" {
+#include <video/mp_image.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+DECLARE_LOG_CONTEXT(Video)
+
+static constexpr int RowsPerCell = 4;
+static constexpr float BlackLuma = 0.005f; // same as VideoProcessor
+static constexpr float SceneCut = 0.12f;
+static constexpr double SceneGap = 0.5;    // minimum distance in seconds
+static constexpr int SaveInterval = 10000; // msec between saves of refinement
+static constexpr quint32 CacheMagic = 0x62736378; // "bscx"
+static constexpr quint32 CacheVersion = 1;
+
+static auto sum8(const uchar *p, int n) -> quint32
+{
+    quint32 sum = 0;
+    int i = 0;
+#ifdef SIMD_HAS_SSE2
+    const auto zero = _mm_setzero_si128();
+    auto acc = zero;
+    for (; i + 16 <= n; i += 16)
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(p + i)), zero));
+    sum = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif
+    for (; i < n; ++i)
+        sum += p[i];
+    return sum;
+}
+
+static auto sum16(const quint16 *p, int n) -> quint32
+{
+    quint32 sum = 0;
+    int i = 0;
+#ifdef SIMD_HAS_SSE2
+    const auto zero = _mm_setzero_si128();
+    auto acc = zero;
+    for (; i + 8 <= n; i += 8) {
+        const auto v = _mm_loadu_si128((const __m128i*)(p + i));
+        acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+        acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+    }
+    acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 4));
+    sum = _mm_cvtsi128_si32(acc);
+#endif
+    for (; i < n; ++i)
+        sum += p[i];
+    return sum;
+}
+
+auto LumaGrid::measure(const mp_image *mpi, bool tv) -> bool
+{
+    mean = -1;
+    const auto &desc = mpi->fmt;
+    const bool wide = desc.bytes[0] == 2 && desc.component_bits > 8;
+    if (!(desc.flags & MP_IMGFLAG_YUV) || (desc.flags & MP_IMGFLAG_HWACCEL)
+            || !(wide || (desc.bytes[0] == 1 && desc.component_bits == 8))
+            || mpi->w < Width || mpi->h < Height * RowsPerCell)
+        return false;
+    const double max = (1 << desc.component_bits) - 1;
+    double total = 0;
+    for (int gy = 0; gy < Height; ++gy) {
+        const int y0 = mpi->h * gy / Height, y1 = mpi->h * (gy + 1) / Height;
+        for (int gx = 0; gx < Width; ++gx) {
+            const int x0 = mpi->w * gx / Width, x1 = mpi->w * (gx + 1) / Width;
+            quint64 sum = 0;
+            for (int r = 0; r < RowsPerCell; ++r) {
+                const auto line = mpi->planes[0] + (y0 + (y1 - y0) * r / RowsPerCell) * mpi->stride[0];
+                if (wide)
+                    sum += sum16((const quint16*)line + x0, x1 - x0);
+                else
+                    sum += sum8(line + x0, x1 - x0);
+            }
+            const double avg = sum / (max * RowsPerCell * (x1 - x0));
+            cells[gy * Width + gx] = avg;
+            total += avg;
+        }
+    }
+    double avg = total / cells.size();
+    if (tv)
+        avg = (avg - 16.0/255)*255.0/(235.0 - 16.0);
+    mean = qMax(0.0, avg);
+    return true;
+}
+
+auto LumaGrid::distance(const LumaGrid &other) const -> float
+{
+    float sum = 0;
+    for (int i = 0; i < (int)cells.size(); ++i)
+        sum += std::abs(cells[i] - other.cells[i]);
+    return sum / cells.size();
+}
+
+static auto operator << (QDataStream &out, const SceneFrame &f) -> QDataStream&
+{
+    return out << f.pts << f.luma << f.cut;
+}
+
+static auto operator >> (QDataStream &in, SceneFrame &f) -> QDataStream&
+{
+    return in >> f.pts >> f.luma >> f.cut;
+}
+
+using SceneFrames = std::vector<SceneFrame>;
+
+// first frame after pts which satisfies pred
+template<class F>
+static auto find(const SceneFrames &frames, double pts, F &&pred) -> SceneFrames::const_iterator
+{
+    auto it = std::upper_bound(frames.begin(), frames.end(), pts,
+                               [] (double pts, const SceneFrame &f) { return pts < f.pts; });
+    return std::find_if(it, frames.end(), pred);
+}
+
+struct SceneScanner::Data {
+    SceneScanner *p = nullptr;
+    mutable QMutex mutex;
+    QString file, cache;
+    qint64 size = 0;
+    QDateTime modified;
+    SceneFrames keys;   // keyframes of whole file
+    SceneFrames frames; // every frame until refined
+    double refined = -1;
+    bool done = false;
+    QAtomicInt quit{0};
+
+    auto isBlack(const SceneFrame &f) const -> bool { return f.luma < BlackLuma; }
+    auto load() -> bool;
+    auto save() const -> void;
+    auto decode(AVFormatContext *format, int stream, bool keyframes) -> bool;
+    // lookup in frames until refined and then keys if coarse
+    template<class F>
+    auto lookup(double pts, bool coarse, F &&pred) const -> double
+    {
+        auto it = find(frames, pts, pred);
+        if (it != frames.end())
+            return it->pts;
+        if (done || !coarse)
+            return -1;
+        it = find(keys, qMax(pts, refined), pred);
+        return it != keys.end() ? it->pts : -1;
+    }
+};
+
+auto SceneScanner::Data::load() -> bool
+{
+    QFile file(cache);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    quint32 magic = 0, version = 0;
+    qint64 size = 0;
+    QDateTime modified;
+    in >> magic >> version;
+    if (magic != CacheMagic || version != CacheVersion)
+        return false;
+    in >> size >> modified;
+    if (size != this->size || modified != this->modified)
+        return false;
+    SceneFrames keys, frames;
+    bool done = false;
+    double refined = -1;
+    quint32 count = 0;
+    in >> done >> refined >> count;
+    keys.resize(count);
+    for (auto &f : keys)
+        in >> f;
+    in >> count;
+    frames.resize(count);
+    for (auto &f : frames)
+        in >> f;
+    if (in.status() != QDataStream::Ok)
+        return false;
+    QMutexLocker locker(&mutex);
+    this->keys = std::move(keys);
+    this->frames = std::move(frames);
+    this->refined = refined;
+    this->done = done;
+    return true;
+}
+
+auto SceneScanner::Data::save() const -> void
+{
+    QFile file(cache);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        _Error("Cannot write scene index: %%", cache);
+        return;
+    }
+    QDataStream out(&file);
+    QMutexLocker locker(&mutex);
+    out << CacheMagic << CacheVersion << size << modified;
+    out << done << refined << (quint32)keys.size();
+    for (auto &f : keys)
+        out << f;
+    out << (quint32)frames.size();
+    for (auto &f : frames)
+        out << f;
+}
+
+auto SceneScanner::Data::decode(AVFormatContext *format, int stream, bool keyframes) -> bool
+{
+    auto st = format->streams[stream];
+    auto codec = avcodec_find_decoder(st->codec->codec_id);
+    if (!codec)
+        return false;
+    auto ctx = avcodec_alloc_context3(codec);
+    AVDictionary *opts = nullptr;
+    av_dict_set(&opts, "threads", "auto", 0);
+    avcodec_copy_context(ctx, st->codec);
+    // pictures are only for statistics
+    ctx->skip_loop_filter = AVDISCARD_ALL;
+    ctx->skip_frame = keyframes ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    const bool opened = avcodec_open2(ctx, codec, &opts) >= 0;
+    av_dict_free(&opts);
+    if (!opened) {
+        avcodec_free_context(&ctx);
+        return false;
+    }
+    // resume from keyframe before refined and skip frames up to it
+    mutex.lock();
+    const bool resume = !keyframes && !frames.empty();
+    const double from = resume ? frames.back().pts : -_Max<double>();
+    mutex.unlock();
+    const qint64 start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    const qint64 seek = resume ? from / av_q2d(st->time_base) : start;
+    // keyframe pass reads from where the file was just opened
+    if (avformat_seek_file(format, stream, _Min<qint64>(), seek, seek, AVSEEK_FLAG_BACKWARD) < 0
+            && !keyframes) {
+        _Error("Cannot seek %% for scene index", file);
+        avcodec_free_context(&ctx);
+        return false;
+    }
+    int measured = 0;
+
+    QElapsedTimer saved;
+    saved.start();
+    auto frame = av_frame_alloc();
+    LumaGrid grid, prev;
+    AVPacket packet;
+    av_init_packet(&packet);
+    auto consume = [&] (AVPacket *packet) -> bool {
+        int got = 0;
+        if (avcodec_decode_video2(ctx, frame, &got, packet) < 0 || !got)
+            return false;
+        const auto ts = av_frame_get_best_effort_timestamp(frame);
+        mp_image mpi;
+        memset(&mpi, 0, sizeof(mpi));
+        mp_image_copy_fields_from_av_frame(&mpi, frame);
+        if (ts != AV_NOPTS_VALUE && grid.measure(&mpi, frame->color_range != AVCOL_RANGE_JPEG)) {
+            ++measured;
+            SceneFrame f;
+            f.pts = ts * av_q2d(st->time_base);
+            f.luma = grid.mean;
+            f.cut = !keyframes && prev.isValid() ? grid.distance(prev) : 0.f;
+            std::swap(grid, prev);
+            if (f.pts <= from) {
+                av_frame_unref(frame);
+                return true;
+            }
+            mutex.lock();
+            if (keyframes)
+                keys.push_back(f);
+            else {
+                frames.push_back(f);
+                refined = f.pts;
+            }
+            mutex.unlock();
+        }
+        av_frame_unref(frame);
+        return true;
+    };
+    while (!quit.load() && av_read_frame(format, &packet) >= 0) {
+        if (packet.stream_index == stream && (!keyframes || packet.flags & AV_PKT_FLAG_KEY))
+            consume(&packet);
+        av_free_packet(&packet);
+        if (!keyframes && measured > 0 && saved.hasExpired(SaveInterval)) {
+            save();
+            saved.restart();
+        }
+    }
+    packet.data = nullptr;
+    packet.size = 0;
+    while (!quit.load() && consume(&packet)) ;
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    return !quit.load() && measured > 0;
+}
+
+SceneScanner::SceneScanner(QObject *parent)
+    : QThread(parent), d(new Data)
+{
+    d->p = this;
+    av_register_all();
+}
+
+SceneScanner::~SceneScanner()
+{
+    stop();
+    delete d;
+}
+
+auto SceneScanner::stop() -> void
+{
+    d->quit.store(1);
+    wait();
+    d->quit.store(0);
+}
+
+auto SceneScanner::clear() -> void
+{
+    stop();
+    QMutexLocker locker(&d->mutex);
+    d->file.clear();
+    d->keys.clear();
+    d->frames.clear();
+    d->refined = -1;
+    d->done = false;
+}
+
+auto SceneScanner::scan(const QString &file) -> void
+{
+    stop();
+    const QFileInfo info(file);
+    d->mutex.lock();
+    d->file = info.absoluteFilePath();
+    d->size = info.size();
+    d->modified = info.lastModified();
+    d->keys.clear();
+    d->frames.clear();
+    d->refined = -1;
+    d->done = false;
+    d->mutex.unlock();
+    if (!info.isFile())
+        return;
+    const auto dir = _WritablePath(Location::Config) % "/scene-index"_a;
+    const auto hash = QCryptographicHash::hash(d->file.toUtf8(), QCryptographicHash::Md5);
+    d->cache = dir % '/'_q % _L(hash.toHex());
+    start(QThread::LowestPriority);
+}
+
+auto SceneScanner::file() const -> QString
+{
+    QMutexLocker locker(&d->mutex);
+    return d->file;
+}
+
+auto SceneScanner::isRefined() const -> bool
+{
+    QMutexLocker locker(&d->mutex);
+    return d->done;
+}
+
+auto SceneScanner::nextBlackFrame(double pts) const -> double
+{
+    QMutexLocker locker(&d->mutex);
+    // leave the black frames where pts is
+    auto isBlack = [&] (const SceneFrame &f) { return d->isBlack(f); };
+    for (auto frames : { &d->frames, &d->keys }) {
+        auto it = std::upper_bound(frames->begin(), frames->end(), pts,
+                                   [] (double pts, const SceneFrame &f) { return pts < f.pts; });
+        if (it == frames->begin() || it == frames->end() || !isBlack(*(it - 1)))
+            continue;
+        it = std::find_if_not(it, frames->end(), isBlack);
+        if (it != frames->end())
+            pts = it->pts;
+        break;
+    }
+    return d->lookup(pts, true, isBlack);
+}
+
+auto SceneScanner::nextScene(double pts) const -> double
+{
+    QMutexLocker locker(&d->mutex);
+    // cuts between keyframes may be motion over seconds, not a scene change
+    return d->lookup(pts + SceneGap, false, [] (const SceneFrame &f) { return f.cut >= SceneCut; });
+}
+
+auto SceneScanner::run() -> void
+{
+    QDir().mkpath(QFileInfo(d->cache).absolutePath());
+    if (d->load()) {
+        emit indexChanged();
+        if (d->done)
+            return;
+    }
+    AVFormatContext *format = nullptr;
+    if (avformat_open_input(&format, d->file.toUtf8().constData(), nullptr, nullptr) < 0) {
+        _Error("Cannot open %% for scene index", d->file);
+        return;
+    }
+    int stream = -1;
+    if (avformat_find_stream_info(format, nullptr) >= 0)
+        stream = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (stream >= 0) {
+        bool keys = false;
+        d->mutex.lock();
+        keys = !d->keys.empty();
+        d->mutex.unlock();
+        if (!keys) {
+            QElapsedTimer timer;
+            timer.start();
+            keys = d->decode(format, stream, true);
+            if (keys) {
+                _Debug("Keyframes indexed in %%ms", timer.elapsed());
+                d->save();
+                emit indexChanged();
+            }
+        }
+        if (keys && d->decode(format, stream, false)) {
+            d->mutex.lock();
+            d->done = true;
+            d->mutex.unlock();
+            d->save();
+            emit indexChanged();
+        } else if (keys && d->quit.load())
+            d->save(); // keep refinement so far
+    }
+    avformat_close_input(&format);
+}
@@ -0,0 +1,55 @@
+#ifndef SCENESCANNER_HPP
+#define SCENESCANNER_HPP
+
+struct mp_image;
+
+// subsampled luma of a frame on a coarse grid
+struct LumaGrid {
+    static constexpr int Width = 16, Height = 9;
+    // false if luma cannot be read from mpi
+    auto measure(const mp_image *mpi, bool tv) -> bool;
+    // mean absolute difference of cells in [0, 1]
+    auto distance(const LumaGrid &other) const -> float;
+    auto isValid() const -> bool { return mean >= 0; }
+    std::array<float, Width * Height> cells;
+    float mean = -1; // in [0, 1] with TV range expanded
+};
+
+struct SceneFrame {
+    double pts = 0;
+    // cut is distance from previous frame; zero for keyframes which can be
+    // seconds apart
+    float luma = 0, cut = 0;
+};
+
+// builds an index of luma and scene changes of a local file in background
+// a separate decoder runs at maximum speed, first over keyframes only and
+// then over every frame. the index is cached in config folder per file and
+// saved periodically so that refinement resumes where it stopped.
+
+class SceneScanner : public QThread {
+    Q_OBJECT
+public:
+    SceneScanner(QObject *parent = nullptr);
+    ~SceneScanner();
+    // stops previous scan; cached index is used if file is unchanged
+    auto scan(const QString &file) -> void;
+    auto stop() -> void;
+    // stops and forgets file so that next scan() starts again
+    auto clear() -> void;
+    auto file() const -> QString;
+    // true if every frame of whole file has been indexed
+    auto isRefined() const -> bool;
+    // pts of first black frame after the black frames at pts; -1 if unknown
+    auto nextBlackFrame(double pts) const -> double;
+    // pts of first scene change after pts; -1 if not refined there yet
+    auto nextScene(double pts) const -> double;
+signals:
+    void indexChanged();
+private:
+    auto run() -> void final;
+    struct Data;
+    Data *d;
+};
+
+#endif // SCENESCANNER_HPP
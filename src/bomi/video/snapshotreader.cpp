@@ -0,0 +1,166 @@
+#include "snapshotreader.hpp"
+#include "opengl/openglframebufferobject.hpp"
+#include "opengl/opengltexturebinder.hpp"
+#include <QOpenGLBuffer>
+#include <QThreadPool>
+
+// rendered frames to wait before mapping a buffer
+static constexpr int Latency = 2;
+
+struct Pack {
+    QOpenGLBuffer buffer{QOpenGLBuffer::PixelPackBuffer};
+    QSize size;
+    const uchar *data = nullptr;
+    auto bytes() const -> int { return size.width() * size.height() * 4; }
+    auto read(const OpenGLTexture2D &texture) -> void;
+    auto map() -> void
+    {
+        if (size.isEmpty())
+            return;
+        buffer.bind();
+        data = static_cast<const uchar*>(buffer.map(QOpenGLBuffer::ReadOnly));
+        buffer.release();
+    }
+    auto unmap() -> void
+    {
+        if (!data)
+            return;
+        buffer.bind();
+        buffer.unmap();
+        buffer.release();
+        data = nullptr;
+    }
+    auto toImage(QImage::Format format) const -> QImage
+    {
+        if (!data)
+            return QImage();
+        QImage image(size, format);
+        memcpy(image.bits(), data, bytes());
+        return image;
+    }
+};
+
+auto Pack::read(const OpenGLTexture2D &texture) -> void
+{
+    if (texture.isEmpty()) {
+        size = QSize();
+        return;
+    }
+    if (!buffer.isCreated()) {
+        buffer.create();
+        buffer.setUsagePattern(QOpenGLBuffer::StreamRead);
+    }
+    buffer.bind();
+    if (_Change(size, texture.size()))
+        buffer.allocate(bytes());
+    OpenGLTextureBinder<OGL::Target2D> binder(const_cast<OpenGLTexture2D*>(&texture));
+    glGetTexImage(texture.target(), 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+    buffer.release();
+}
+
+struct Slot {
+    enum State { Free, Reading, Copying, Copied };
+    Pack frame, osd;
+    QAtomicInt state{Free};
+    int time = 0, age = 0;
+};
+
+class CopyRunnable : public QRunnable {
+public:
+    CopyRunnable(SnapshotReader *reader, Slot *slot)
+        : m_reader(reader), m_slot(slot) { }
+private:
+    auto run() -> void final;
+    SnapshotReader *m_reader;
+    Slot *m_slot;
+};
+
+struct SnapshotReader::Data {
+    std::array<Slot, 3> ring;
+    QThreadPool pool;
+};
+
+auto CopyRunnable::run() -> void
+{
+    Snapshot ss;
+    ss.time = m_slot->time;
+    ss.frame = m_slot->frame.toImage(QImage::Format_ARGB32);
+    const auto osd = m_slot->osd.toImage(QImage::Format_ARGB32_Premultiplied);
+    ss.osd = ss.frame;
+    if (!osd.isNull() && !ss.osd.isNull()) {
+        QPainter painter(&ss.osd);
+        painter.drawImage(ss.osd.rect(), osd);
+    }
+    m_slot->state.store(Slot::Copied);
+    emit m_reader->taken(ss);
+}
+
+SnapshotReader::SnapshotReader(QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    qRegisterMetaType<Snapshot>();
+    d->pool.setMaxThreadCount(1);
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    d->pool.waitForDone();
+    delete d;
+}
+
+auto SnapshotReader::read(const Fbo *frame, const Fbo *osd, int time) -> bool
+{
+    for (auto &slot : d->ring) {
+        if (slot.state.load() != Slot::Free)
+            continue;
+        slot.frame.read(frame->texture());
+        if (osd)
+            slot.osd.read(osd->texture());
+        else
+            slot.osd.size = QSize();
+        slot.time = time;
+        slot.age = 0;
+        slot.state.store(Slot::Reading);
+        return true;
+    }
+    return false;
+}
+
+auto SnapshotReader::collect() -> bool
+{
+    bool pending = false;
+    for (auto &slot : d->ring) {
+        switch (slot.state.load()) {
+        case Slot::Reading:
+            if (++slot.age < Latency)
+                break;
+            slot.frame.map();
+            slot.osd.map();
+            slot.state.store(Slot::Copying);
+            d->pool.start(new CopyRunnable(this, &slot));
+            break;
+        case Slot::Copied:
+            slot.frame.unmap();
+            slot.osd.unmap();
+            slot.state.store(Slot::Free);
+            continue;
+        default:
+            break;
+        }
+        pending |= slot.state.load() != Slot::Free;
+    }
+    return pending;
+}
+
+auto SnapshotReader::finalize() -> void
+{
+    d->pool.waitForDone();
+    for (auto &slot : d->ring) {
+        for (auto pack : { &slot.frame, &slot.osd }) {
+            pack->unmap();
+            pack->buffer.destroy();
+            pack->size = QSize();
+        }
+        slot.state.store(Slot::Free);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef SNAPSHOTREADER_HPP
+#define SNAPSHOTREADER_HPP
+
+class OpenGLFramebufferObject;
+using Fbo = OpenGLFramebufferObject;
+
+struct Snapshot {
+    QImage frame, osd; // osd is composited over frame
+    int time = 0;
+};
+
+Q_DECLARE_METATYPE(Snapshot)
+
+// reads back rendered frames without stalling render thread
+// textures are packed into a ring of pixel buffer objects which are mapped
+// some rendered frames later when the transfer is done. mapped pixels are
+// copied and composited on a worker thread which emits taken().
+
+class SnapshotReader : public QObject {
+    Q_OBJECT
+public:
+    SnapshotReader(QObject *parent = nullptr);
+    ~SnapshotReader();
+    // functions below should be called in render thread with context current
+    // false if every buffer in ring is busy; retry on next frame
+    auto read(const Fbo *frame, const Fbo *osd, int time) -> bool;
+    // call once per rendered frame; true if any readback is still pending
+    auto collect() -> bool;
+    auto finalize() -> void;
+signals:
+    void taken(const Snapshot &snapshot);
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // SNAPSHOTREADER_HPP
@@ -2,11 +2,40 @@
 #include "deintoption.hpp"
 #include "ffmpegfilters.hpp"
 #include "mpimage.hpp"
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QElapsedTimer>
+
+// graph is touched only by worker while jobs are queued
+// jobs are reused in a ring, so the runnable must not be auto-deleted
+struct GraphJob : public QRunnable {
+    GraphJob(FFmpegFilterGraph *graph, const QString *option)
+        : graph(graph), option(option) { setAutoDelete(false); }
+    auto run() -> void final
+    {
+        ok = (input->fields & MP_IMGFIELD_INTERLACED)
+             && graph->initialize(*option, input) && graph->push(input);
+        while (ok) {
+            auto out = graph->pull();
+            if (out.isNull())
+                break;
+            output.push_back(std::move(out));
+        }
+        done.release();
+    }
+    FFmpegFilterGraph *graph = nullptr;
+    const QString *option = nullptr;
+    MpImage input;
+    std::deque<MpImage> output;
+    double pts = MP_NOPTS_VALUE, step = 0.0;
+    bool ok = false;
+    QSemaphore done;
+};
 
 struct SoftwareDeinterlacer::Data {
     SoftwareDeinterlacer *p = nullptr;
     QString option;
-    bool rebuild = true, pass = false;
+    bool rebuild = true, pass = false, eof = false;
     DeintOption deint;
     FFmpegFilterGraph graph;
     BobDeinterlacer bob;
@@ -15,7 +44,16 @@ struct SoftwareDeinterlacer::Data {
     int processed = 0, count = 1;
     mutable int i_pts = 0;
     double pts = MP_NOPTS_VALUE, prev = MP_NOPTS_VALUE;
-    std::deque<MpImage> queue;
+    // pipelined graph: input and output are of job which left queue
+    // ring of jobs; queued ones from head are pending in worker
+    QThreadPool worker;
+    std::vector<GraphJob*> jobs;
+    int head = 0, queued = 0;
+    std::deque<MpImage> output;
+    double outPts = MP_NOPTS_VALUE, outStep = 0.0;
+    QElapsedTimer clock;
+    int frames = 0;
+    double fps = 0.0;
 
     auto bobField(bool top) const -> MpImage
         { return bob.field(deint.method, input, top); }
@@ -39,16 +77,90 @@ struct SoftwareDeinterlacer::Data {
         if (prev != MP_NOPTS_VALUE && ((ptsIn < prev) || (ptsIn - prev > 0.5))) // reset
             prev = MP_NOPTS_VALUE;
     }
+    // false while queue fills or if job of input could not be filtered
+    auto enqueue() -> bool
+    {
+        auto job = jobs[(head + queued++) % jobs.size()];
+        job->input = std::move(input);
+        job->pts = pts;
+        job->step = step(count);
+        job->ok = false;
+        worker.start(job);
+        if (queued <= deint.queue)
+            return false;
+        return finish();
+    }
+    // waits for oldest job and makes it current
+    auto finish() -> bool
+    {
+        auto job = jobs[head];
+        head = (head + 1) % jobs.size();
+        --queued;
+        job->done.acquire();
+        input = std::move(job->input);
+        // swap to keep storage of both queues
+        output.swap(job->output);
+        job->output.clear();
+        outPts = job->pts;
+        outStep = job->step;
+        return job->ok;
+    }
+    // queue and one job which is pushed before the oldest is taken
+    auto resize(int size) -> void
+    {
+        qDeleteAll(jobs);
+        jobs.clear();
+        for (int i = 0; i < size; ++i)
+            jobs.push_back(new GraphJob(&graph, &option));
+    }
+    auto dequeue() -> MpImage
+    {
+        if (output.empty())
+            return MpImage();
+        auto mpi = std::move(output.front());
+        output.pop_front();
+        if (outPts != MP_NOPTS_VALUE)
+            mpi->pts = outPts + processed * outStep;
+        return mpi;
+    }
+    auto drain() -> void
+    {
+        for (int i = 0; i < queued; ++i) {
+            auto job = jobs[(head + i) % jobs.size()];
+            job->done.acquire();
+            job->input.release();
+            job->output.clear();
+        }
+        head = queued = 0;
+        output.clear();
+        eof = false;
+    }
+    // counts deinterlaced frame for fps
+    auto tick() -> void
+    {
+        if (!clock.isValid())
+            clock.start();
+        ++frames;
+        const auto elapsed = clock.elapsed();
+        if (elapsed >= 1000) {
+            fps = frames * 1000.0 / elapsed;
+            frames = 0;
+            clock.restart();
+        }
+    }
 };
 
 SoftwareDeinterlacer::SoftwareDeinterlacer()
     : d(new Data)
 {
     d->p = this;
+    d->worker.setMaxThreadCount(1);
 }
 
 SoftwareDeinterlacer::~SoftwareDeinterlacer()
 {
+    d->drain();
+    qDeleteAll(d->jobs);
     delete d;
 }
 
@@ -59,13 +171,19 @@ auto SoftwareDeinterlacer::pass() const -> bool
 
 auto SoftwareDeinterlacer::push(MpImage &&mpi) -> void
 {
-    if (mpi.isNull())
+    if (mpi.isNull()) {
+        // queued jobs are emitted by pop() in order
+        d->eof = d->queued > 0;
         return;
+    }
+    d->eof = false;
     d->setNewPts(mpi->pts);
     d->input = std::move(mpi);
     d->processed = 0;
     d->pass = true;
-    if (d->input->fields & MP_IMGFIELD_INTERLACED) {
+    if (d->type == Graph && d->deint.queue > 0)
+        d->pass = !d->enqueue();
+    else if (d->input->fields & MP_IMGFIELD_INTERLACED) {
         d->pass = false;
         switch (d->type) {
         case Mark: case Bob:
@@ -83,8 +201,15 @@ auto SoftwareDeinterlacer::push(MpImage &&mpi) -> void
 
 auto SoftwareDeinterlacer::pop() -> MpImage
 {
-    if (d->processed >= d->count || d->input.isNull())
-        return MpImage();
+    if (d->processed >= d->count || d->input.isNull()) {
+        if (!d->eof)
+            return MpImage();
+        d->processed = 0;
+        d->pass = !d->finish();
+        d->eof = d->queued > 0;
+        if (d->input.isNull())
+            return MpImage();
+    }
     MpImage ret;
     if (!d->pass) {
         switch (d->type) {
@@ -101,10 +226,12 @@ auto SoftwareDeinterlacer::pop() -> MpImage
             }
             break;
         } case Graph: {
-            ret = d->graph.pull();
+            const bool queued = d->deint.queue > 0;
+            ret = queued ? d->dequeue() : d->graph.pull();
             if (!ret.isNull()) {
                 ret->fields &= ~MP_IMGFIELD_INTERLACED;
-                ret->pts = d->nextPts();
+                if (!queued)
+                    ret->pts = d->nextPts();
             }
             break;
         } case Bob: {
@@ -114,6 +241,8 @@ auto SoftwareDeinterlacer::pop() -> MpImage
         } default:
             break;
         }
+        if (!ret.isNull())
+            d->tick();
     }
     if (ret.isNull())
         ret = std::move(d->input);
@@ -131,6 +260,9 @@ auto SoftwareDeinterlacer::setOption(const DeintOption &deint) -> void
 {
     if (!_Change(d->deint, deint))
         return;
+    d->drain();
+    d->resize(d->deint.queue + 1);
+    d->graph.setThreads(d->deint.threads);
     d->option.clear();
     if (d->deint.method == DeintMethod::None) {
         d->type = Pass;
@@ -157,7 +289,16 @@ auto SoftwareDeinterlacer::setOption(const DeintOption &deint) -> void
 
 auto SoftwareDeinterlacer::clear() -> void
 {
-    d->queue.clear();
+    d->drain();
+    d->input.release();
+    d->clock.invalidate();
+    d->frames = 0;
+    d->fps = 0.0;
+}
+
+auto SoftwareDeinterlacer::fps() const -> double
+{
+    return d->fps;
 }
 
 auto SoftwareDeinterlacer::fpsManipulation() const -> double
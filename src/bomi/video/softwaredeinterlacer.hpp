@@ -20,6 +20,8 @@ public:
     auto type() const -> Type;
     auto pass() const -> bool;
     auto fpsManipulation() const -> double final;
+    // deinterlaced frames per second measured over last second
+    auto fps() const -> double;
 private:
     struct Data;
     Data *d;
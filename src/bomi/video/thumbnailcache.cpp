@@ -0,0 +1,437 @@
+#include "thumbnailcache.hpp"
+#include "misc/jsonstorage.hpp"
+#include "misc/log.hpp"
+#include <QCryptographicHash>
+#include <QBuffer>
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+DECLARE_LOG_CONTEXT(Video)
+
+static constexpr double Interval = 10.0;    // seconds for short files
+static constexpr int MaxThumbnails = 1200;  // interval grows for long files
+static constexpr int TileWidth = 192;
+static constexpr int Columns = 8, Rows = 8; // tiles per sheet
+static constexpr int Quality = 80;
+static constexpr int DecodedSheets = 4;
+static constexpr int IdentityBytes = 64 * 1024;
+static constexpr quint32 CacheMagic = 0x6274686d; // "bthm"
+static constexpr quint32 CacheVersion = 1;
+
+struct Sheet { qint64 offset = 0; qint32 length = 0; };
+
+struct ThumbnailCache::Data {
+    ThumbnailCache *p = nullptr;
+    mutable QMutex mutex;
+    QString file, dir, cache;
+    qint64 limit = 256 * 1024 * 1024; // under mutex
+    QAtomicInt quit{0};
+
+    double duration = 0, interval = 0;
+    int count = 0;
+    QSize tile;
+    QVector<QByteArray> building;   // sheets while extracting
+    QFile mapped;
+    uchar *map = nullptr;
+    const uchar *data = nullptr;    // start of sheets in map
+    QVector<Sheet> sheets;
+    mutable QList<QPair<int, QImage>> decoded; // most recent first
+
+    auto identity() const -> QString;
+    auto open() -> bool;
+    auto close() -> void;
+    auto extract() -> bool;
+    auto write() -> bool;
+    auto touch(bool evict) -> void;
+    auto sheet(int index) const -> QImage;
+};
+
+// size, mtime and content of head and tail
+auto ThumbnailCache::Data::identity() const -> QString
+{
+    QFile in(file);
+    if (!in.open(QFile::ReadOnly))
+        return QString();
+    const QFileInfo info(file);
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    hash.addData(in.read(IdentityBytes));
+    if (in.size() > 2 * IdentityBytes && in.seek(in.size() - IdentityBytes))
+        hash.addData(in.read(IdentityBytes));
+    return _L(hash.result().toHex());
+}
+
+auto ThumbnailCache::Data::open() -> bool
+{
+    close();
+    mapped.setFileName(cache);
+    if (!mapped.open(QFile::ReadOnly))
+        return false;
+    QDataStream in(&mapped);
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != CacheMagic || version != CacheVersion)
+        return false;
+    double duration = 0, interval = 0;
+    qint32 count = 0, w = 0, h = 0, columns = 0, rows = 0, n = 0;
+    in >> duration >> interval >> count >> w >> h >> columns >> rows >> n;
+    // no thumbnails are cached for a file which cannot be extracted
+    if (columns != Columns || rows != Rows || count < 0 || n < 0
+            || (count > 0 && (w <= 0 || h <= 0)))
+        return false;
+    QVector<Sheet> sheets(n);
+    for (auto &s : sheets)
+        in >> s.offset >> s.length;
+    if (in.status() != QDataStream::Ok)
+        return false;
+    const auto start = mapped.pos();
+    for (auto &s : sheets) {
+        if (s.offset < 0 || s.length <= 0 || start + s.offset + s.length > mapped.size())
+            return false;
+    }
+    const auto map = mapped.map(0, mapped.size());
+    if (!map)
+        return false;
+    QMutexLocker locker(&mutex);
+    this->duration = duration;
+    this->interval = interval;
+    this->count = count;
+    this->sheets = sheets;
+    this->map = map;
+    tile = { w, h };
+    data = map + start;
+    building.clear();
+    decoded.clear();
+    return true;
+}
+
+auto ThumbnailCache::Data::close() -> void
+{
+    QMutexLocker locker(&mutex);
+    if (map)
+        mapped.unmap(map);
+    mapped.close();
+    map = nullptr;
+    data = nullptr;
+    sheets.clear();
+    building.clear();
+    decoded.clear();
+    count = 0;
+    duration = interval = 0;
+}
+
+auto ThumbnailCache::Data::sheet(int index) const -> QImage
+{
+    for (auto it = decoded.begin(); it != decoded.end(); ++it) {
+        if (it->first == index) {
+            decoded.move(it - decoded.begin(), 0);
+            return decoded.front().second;
+        }
+    }
+    QImage image;
+    if (index < sheets.size())
+        image.loadFromData(data + sheets[index].offset, sheets[index].length, "JPG");
+    else if (index < building.size())
+        image.loadFromData(building[index], "JPG");
+    if (image.isNull())
+        return image;
+    decoded.prepend(qMakePair(index, image));
+    while (decoded.size() > DecodedSheets)
+        decoded.removeLast();
+    return image;
+}
+
+auto ThumbnailCache::Data::extract() -> bool
+{
+    AVFormatContext *format = nullptr;
+    if (avformat_open_input(&format, file.toUtf8().constData(), nullptr, nullptr) < 0)
+        return false;
+    AVCodecContext *ctx = nullptr;
+    AVFrame *frame = nullptr;
+    SwsContext *sws = nullptr;
+    bool ok = false;
+    [&] () {
+        if (avformat_find_stream_info(format, nullptr) < 0 || format->duration <= 0)
+            return;
+        AVCodec *codec = nullptr;
+        const int stream = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+        if (stream < 0 || !codec)
+            return;
+        auto st = format->streams[stream];
+        ctx = avcodec_alloc_context3(codec);
+        avcodec_copy_context(ctx, st->codec);
+        ctx->skip_loop_filter = AVDISCARD_ALL;
+        ctx->skip_frame = AVDISCARD_NONKEY;
+        if (avcodec_open2(ctx, codec, nullptr) < 0)
+            return;
+        const double duration = format->duration / (double)AV_TIME_BASE;
+        const double start = format->start_time == AV_NOPTS_VALUE
+                ? 0.0 : format->start_time / (double)AV_TIME_BASE;
+        const double interval = qMax(Interval, duration / MaxThumbnails);
+        const int count = qMax(1, (int)(duration / interval));
+        const auto sar = av_guess_sample_aspect_ratio(format, st, nullptr);
+        double aspect = ctx->width / (double)qMax(1, ctx->height);
+        if (sar.num > 0 && sar.den > 0)
+            aspect *= av_q2d(sar);
+        const QSize tile(TileWidth, qMax(2, qRound(TileWidth / aspect) & ~1));
+        mutex.lock();
+        this->duration = duration;
+        this->interval = interval;
+        this->tile = tile;
+        mutex.unlock();
+
+        frame = av_frame_alloc();
+        QImage sheet, prev;
+        qint64 key = AV_NOPTS_VALUE;
+        AVPacket packet;
+        av_init_packet(&packet);
+        auto decode = [&] () -> QImage {
+            for (int packets = 0; packets < 1000 && !quit.load(); ) {
+                if (av_read_frame(format, &packet) < 0)
+                    return QImage();
+                if (packet.stream_index != stream) {
+                    av_free_packet(&packet);
+                    continue;
+                }
+                ++packets;
+                // same keyframe as last thumbnail in long GOP
+                if (packet.flags & AV_PKT_FLAG_KEY && packet.pts != AV_NOPTS_VALUE
+                        && packet.pts == key && !prev.isNull()) {
+                    av_free_packet(&packet);
+                    return prev;
+                }
+                if (packet.flags & AV_PKT_FLAG_KEY)
+                    key = packet.pts;
+                int got = 0;
+                avcodec_decode_video2(ctx, frame, &got, &packet);
+                av_free_packet(&packet);
+                if (!got)
+                    continue;
+                QImage image(tile, QImage::Format_RGB32);
+                sws = sws_getCachedContext(sws, frame->width, frame->height,
+                                           (AVPixelFormat)frame->format, tile.width(),
+                                           tile.height(), AV_PIX_FMT_RGB32, SWS_BILINEAR,
+                                           nullptr, nullptr, nullptr);
+                if (!sws)
+                    return QImage();
+                uint8_t *dst[4] = { image.bits(), nullptr, nullptr, nullptr };
+                int stride[4] = { image.bytesPerLine(), 0, 0, 0 };
+                sws_scale(sws, frame->data, frame->linesize, 0, frame->height, dst, stride);
+                av_frame_unref(frame);
+                return image;
+            }
+            return QImage();
+        };
+        for (int i = 0; i < count && !quit.load(); ++i) {
+            const auto ts = (start + i * interval) / av_q2d(st->time_base);
+            if (av_seek_frame(format, stream, ts, AVSEEK_FLAG_BACKWARD) < 0)
+                break;
+            avcodec_flush_buffers(ctx);
+            const auto image = decode();
+            if (image.isNull())
+                break;
+            prev = image;
+            const int at = i % (Columns * Rows);
+            if (!at) {
+                sheet = QImage(tile.width() * Columns, tile.height() * Rows, QImage::Format_RGB32);
+                sheet.fill(Qt::black);
+            }
+            QPainter painter(&sheet);
+            painter.drawImage((at % Columns) * tile.width(), (at / Columns) * tile.height(), image);
+            painter.end();
+            if (at == Columns * Rows - 1 || i == count - 1) {
+                QByteArray bytes;
+                QBuffer buffer(&bytes);
+                buffer.open(QBuffer::WriteOnly);
+                sheet.save(&buffer, "JPG", Quality);
+                mutex.lock();
+                building.push_back(bytes);
+                this->count = i + 1;
+                mutex.unlock();
+                emit p->thumbnailsChanged();
+            }
+        }
+        ok = !quit.load() && count > 0 && this->count == count;
+    }();
+    sws_freeContext(sws);
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    avformat_close_input(&format);
+    return ok;
+}
+
+auto ThumbnailCache::Data::write() -> bool
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    mutex.lock();
+    out << CacheMagic << CacheVersion << duration << interval << (qint32)count
+        << (qint32)tile.width() << (qint32)tile.height()
+        << (qint32)Columns << (qint32)Rows << (qint32)building.size();
+    qint64 offset = 0;
+    for (auto &bytes : building) {
+        out << offset << (qint32)bytes.size();
+        offset += bytes.size();
+    }
+    const auto sheets = building;
+    mutex.unlock();
+
+    QFile file(cache % ".part"_a);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+    bool ok = file.write(header) == header.size();
+    for (auto &bytes : sheets)
+        ok = ok && file.write(bytes) == bytes.size();
+    file.close();
+    QFile::remove(cache);
+    if (!ok || !file.rename(cache)) {
+        file.remove();
+        _Error("Cannot write thumbnail cache: %%", cache);
+        return false;
+    }
+    return true;
+}
+
+// marks cache as used and removes least recently used ones over limit
+auto ThumbnailCache::Data::touch(bool evict) -> void
+{
+    mutex.lock();
+    const auto limit = this->limit;
+    mutex.unlock();
+    JsonStorage storage(dir % "/index.json"_a);
+    auto index = storage.read();
+    const auto name = QFileInfo(cache).fileName();
+    index[name] = (double)QDateTime::currentMSecsSinceEpoch();
+    if (evict) {
+        auto files = QDir(dir).entryInfoList({ u"*.thumbs"_q }, QDir::Files);
+        auto used = [&] (const QFileInfo &info) {
+            const auto it = index.constFind(info.fileName());
+            return it != index.constEnd() ? (qint64)it.value().toDouble()
+                                          : info.lastModified().toMSecsSinceEpoch();
+        };
+        std::sort(files.begin(), files.end(), [&] (const QFileInfo &a, const QFileInfo &b)
+            { return used(a) < used(b); });
+        qint64 total = 0;
+        for (auto &info : files)
+            total += info.size();
+        for (auto &info : files) {
+            if (total <= limit)
+                break;
+            if (info.fileName() == name || !QFile::remove(info.absoluteFilePath()))
+                continue;
+            total -= info.size();
+            index.remove(info.fileName());
+        }
+        for (auto it = index.begin(); it != index.end(); ) {
+            if (QFile::exists(dir % '/'_q % it.key()))
+                ++it;
+            else
+                it = index.erase(it);
+        }
+    }
+    storage.write(index);
+}
+
+ThumbnailCache::ThumbnailCache(QObject *parent)
+    : QThread(parent), d(new Data)
+{
+    d->p = this;
+    d->dir = _WritablePath(Location::Cache) % "/thumbnails"_a;
+    av_register_all();
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    unload();
+    delete d;
+}
+
+auto ThumbnailCache::load(const QString &file) -> void
+{
+    unload();
+    d->file = QFileInfo(file).absoluteFilePath();
+    start(QThread::LowestPriority);
+}
+
+auto ThumbnailCache::unload() -> void
+{
+    d->quit.store(1);
+    wait();
+    d->quit.store(0);
+    d->close();
+    d->file.clear();
+}
+
+auto ThumbnailCache::file() const -> QString
+{
+    return d->file;
+}
+
+auto ThumbnailCache::setLimit(qint64 bytes) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->limit = bytes;
+}
+
+auto ThumbnailCache::limit() const -> qint64
+{
+    QMutexLocker locker(&d->mutex);
+    return d->limit;
+}
+
+auto ThumbnailCache::thumbnail(double rate) const -> QImage
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->count <= 0 || d->interval <= 0)
+        return QImage();
+    const int index = qMax(0, qRound(rate * d->duration / d->interval));
+    if (index >= d->count)
+        return QImage();
+    const int at = index % (Columns * Rows);
+    const auto sheet = d->sheet(index / (Columns * Rows));
+    if (sheet.isNull())
+        return QImage();
+    const QSize &s = d->tile;
+    return sheet.copy((at % Columns) * s.width(), (at / Columns) * s.height(), s.width(), s.height());
+}
+
+auto ThumbnailCache::run() -> void
+{
+    if (!QFileInfo(d->file).isFile())
+        return;
+    const auto id = d->identity();
+    if (id.isEmpty() || d->quit.load())
+        return;
+    QDir().mkpath(d->dir);
+    d->cache = d->dir % '/'_q % id % ".thumbs"_a;
+    if (d->open()) {
+        d->touch(false);
+        if (d->count > 0)
+            emit thumbnailsChanged();
+        return;
+    }
+    d->close();
+    QElapsedTimer timer;
+    timer.start();
+    const bool ok = d->extract();
+    if (d->quit.load())
+        return;
+    if (!ok) {
+        // negative entry so that the file is not decoded again next time
+        d->close();
+        emit thumbnailsChanged();
+        if (d->write())
+            d->touch(true);
+        return;
+    }
+    if (!d->write())
+        return;
+    _Debug("%% thumbnails extracted in %%ms", d->count, timer.elapsed());
+    d->touch(true);
+    if (d->open())
+        emit thumbnailsChanged();
+}
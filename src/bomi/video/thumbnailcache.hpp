@@ -0,0 +1,32 @@
+#ifndef THUMBNAILCACHE_HPP
+#define THUMBNAILCACHE_HPP
+
+// keyframe thumbnails of a local file at fixed interval for seek preview
+// thumbnails are extracted by a separate decoder in background and packed
+// into JPEG sprite sheets of one cache file per file identity. cache files
+// are memory-mapped and sheets are decoded on demand. a file which cannot be
+// extracted gets a cache file without sheets so that it is not decoded again.
+
+class ThumbnailCache : public QThread {
+    Q_OBJECT
+public:
+    ThumbnailCache(QObject *parent = nullptr);
+    ~ThumbnailCache();
+    // stops previous extraction and starts for file if not cached
+    auto load(const QString &file) -> void;
+    auto unload() -> void;
+    auto file() const -> QString;
+    // total size of cache folder; least recently used files are removed
+    auto setLimit(qint64 bytes) -> void;
+    auto limit() const -> qint64;
+    // thumbnail nearest to rate in [0, 1] of duration; null if not ready
+    auto thumbnail(double rate) const -> QImage;
+signals:
+    void thumbnailsChanged();
+private:
+    auto run() -> void final;
+    struct Data;
+    Data *d;
+};
+
+#endif // THUMBNAILCACHE_HPP
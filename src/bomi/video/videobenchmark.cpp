@@ -0,0 +1,438 @@
+#include "ffmpegfilters.hpp"
+#include "hwdecdownloader.hpp"
+#include "softwaredeinterlacer.hpp"
+#include "motioninterpolator.hpp"
+#include "deintoption.hpp"
+#include "videoprocessor.hpp"
+#include "misc/benchmark.hpp"
+
+// BobDeinterlacer::field() before vectorization; luma only and bytes only
+namespace Reference {
+
+static auto field(DeintMethod method, const mp_image *src, mp_image *dst, bool top) -> void
+{
+    const int h = src->h, stride = src->stride[0];
+    auto in = src->planes[0], out = dst->planes[0];
+    auto copy = [=] (int src, int dst)
+        { memcpy(out + dst * stride, in + src * stride, stride); };
+    switch (method) {
+    case DeintMethod::LinearBob: {
+        const int count = h / 2 - 1;
+        if (top) {
+            copy(h - 2, h - 1);
+            copy(h - 2, h - 2);
+        } else {
+            copy(1, 0);
+            copy(h - 1, h - 1);
+            in += stride;
+            out += stride;
+        }
+        for (int i = 0; i < count ; ++i) {
+            memcpy(out, in, stride);
+            out += stride;
+            auto in1 = in;
+            auto in2 = in += stride * 2;
+            for (int x = 0; x < stride; ++x)
+                *out++ = (*in1++ + *in2++) / 2 ;
+        }
+        break;
+    } case DeintMethod::CubicBob: {
+        const int count = h / 2 - 2;
+        if (top) {
+            copy(0, 0);
+            copy(0, 1);
+            copy(h - 2, h - 1);
+            copy(h - 2, h - 2);
+            in += stride * 2;
+            out += stride * 2;
+        } else {
+            copy(1, 0);
+            copy(1, 1);
+            copy(3, 2);
+            copy(h - 1, h - 1);
+            in += stride * 3;
+            out += stride * 3;
+        }
+        for (int i = 0; i < count ; ++i) {
+            memcpy(out, in, stride);
+            out += stride;
+            auto in0 = in - stride * 2;
+            auto in1 = in;
+            auto in2 = in += stride * 2;
+            auto in3 = in + stride * 2;
+            for (int x = 0; x < stride; ++x) {
+                const int p0 = *in0++, p1 = *in1++, p2 = *in2++, p3 = *in3++;
+                const auto a =  -p0 + 3*p1 - 3*p2 + p3;
+                const auto b = 2*p0 - 5*p1 + 4*p2 - p3;
+                const auto c =  -p0        +   p2;
+                const auto d =        2*p1;
+                *out++ = (uchar)qBound(0, (a + 2*b + 4*c + 8*d)/16, 255);
+            }
+        }
+        break;
+    } default:
+        memcpy(dst->planes[0], src->planes[0], h * stride);
+        break;
+    }
+    for (int i = 1; i < src->num_planes; ++i)
+        memcpy(dst->planes[i], src->planes[i], (h >> src->fmt.ys[i]) * src->stride[i]);
+}
+
+}
+
+// two fields which differ as in a frame of moving picture
+static auto makeFrame(mp_imgfmt imgfmt, int w, int h) -> MpImage
+{
+    auto mpi = MpImage::wrap(mp_image_alloc(imgfmt, w, h));
+    const int bits = mpi->fmt.component_bits, max = (1 << bits) - 1;
+    for (int i = 0; i < mpi->num_planes; ++i) {
+        const int rows = mp_image_plane_h(mpi.data(), i);
+        const int samples = mp_image_plane_w(mpi.data(), i) * mpi->fmt.bytes[i] / (bits > 8 ? 2 : 1);
+        for (int y = 0; y < rows; ++y) {
+            auto line = mpi->planes[i] + y * mpi->stride[i];
+            const int shift = (y & 1) * 7;
+            for (int x = 0; x < samples; ++x) {
+                const int v = (((x + shift) * 5 + y * 3 + i * 50) % 256) * max / 255;
+                if (bits > 8)
+                    ((quint16*)line)[x] = v;
+                else
+                    line[x] = v;
+            }
+        }
+    }
+    mpi->fields = MP_IMGFIELD_INTERLACED | MP_IMGFIELD_TOP_FIRST;
+    return mpi;
+}
+
+// copy of src panned by dx, dy luma pixels with wrap-around
+static auto makePanned(const MpImage &src, int dx, int dy) -> MpImage
+{
+    auto mpi = MpImage::wrap(mp_image_alloc(src->imgfmt, src->w, src->h));
+    for (int i = 0; i < mpi->num_planes; ++i) {
+        const int rows = mp_image_plane_h(mpi.data(), i);
+        const int bytes = mp_image_plane_w(mpi.data(), i) * mpi->fmt.bytes[i];
+        const int sy = (dy >> mpi->fmt.ys[i]) % rows;
+        const int sx = ((dx >> mpi->fmt.xs[i]) * mpi->fmt.bytes[i]) % bytes;
+        for (int y = 0; y < rows; ++y) {
+            auto from = src->planes[i] + ((y - sy + rows) % rows) * src->stride[i];
+            auto to = mpi->planes[i] + y * mpi->stride[i];
+            memcpy(to + sx, from, bytes - sx);
+            memcpy(to, from + bytes - sx, sx);
+        }
+    }
+    mpi->fields = src->fields;
+    return mpi;
+}
+
+static auto checksum(const MpImage &mpi, quint64 hash = 0xcbf29ce484222325ull) -> quint64
+{
+    auto img = const_cast<mp_image*>(mpi.data());
+    for (int i = 0; i < mpi->num_planes; ++i) {
+        const int rows = mp_image_plane_h(img, i);
+        const int bytes = mp_image_plane_w(img, i) * mpi->fmt.bytes[i];
+        for (int y = 0; y < rows; ++y)
+            hash = Benchmark::checksum(mpi->planes[i] + y * mpi->stride[i], bytes, hash);
+    }
+    return hash;
+}
+
+auto benchmarkBobDeinterlacer() -> void
+{
+    Benchmark bm(u"video-bob"_q);
+    const struct { const char *name; int w, h; } sizes[] = {
+        { "480i", 720, 480 }, { "1080i", 1920, 1080 }
+    };
+    const struct { const char *name; mp_imgfmt imgfmt; } formats[] = {
+        { "420p", IMGFMT_420P }, { "nv12", IMGFMT_NV12 }, { "420p10", IMGFMT_420P10 }
+    };
+    const struct { const char *name; DeintMethod method; } methods[] = {
+        { "bob", DeintMethod::Bob },
+        { "linear", DeintMethod::LinearBob },
+        { "cubic", DeintMethod::CubicBob }
+    };
+    BobDeinterlacer single, multi;
+    single.setThreads(1);
+    for (auto &s : sizes) {
+        for (auto &f : formats) {
+            const auto frame = makeFrame(f.imgfmt, s.w, s.h);
+            auto old = MpImage::wrap(mp_image_alloc(f.imgfmt, s.w, s.h));
+            for (auto &m : methods) {
+                const QString name = _L(s.name) % ' '_q % _L(f.name) % ' '_q % _L(m.name);
+                quint64 hash = 0xcbf29ce484222325ull;
+                for (bool top : { true, false }) {
+                    const auto field = single.field(m.method, frame, top);
+                    hash = checksum(field, hash);
+                    if (checksum(multi.field(m.method, frame, top)) != checksum(field))
+                        qDebug().nospace().noquote() << "  " << name << ": slices differ";
+                }
+                bm.check(name, hash);
+                if (m.method != DeintMethod::Bob) {
+                    const auto nsec = Benchmark::measure([&] () {
+                        Reference::field(m.method, frame.data(), old.data(), true);
+                    });
+                    bm.report(name % " old"_a, nsec, 1, u"field"_q);
+                }
+                const auto one = Benchmark::measure([&] () { single.field(m.method, frame, true); });
+                bm.report(name % " new"_a, one, 1, u"field"_q);
+                const auto all = Benchmark::measure([&] () { multi.field(m.method, frame, true); });
+                bm.report(name % " new+threads"_a, all, 1, u"field"_q);
+            }
+        }
+    }
+}
+
+auto benchmarkFilterGraph() -> void
+{
+    Benchmark bm(u"video-filtergraph"_q);
+    const struct { const char *name; int w, h; } sizes[] = {
+        { "480i", 720, 480 }, { "1080i", 1920, 1080 }
+    };
+    const struct { const char *name; const char *option; } graphs[] = {
+        { "yadif", "yadif" }, { "yadif-double", "yadif=mode=1" }
+    };
+    for (auto &s : sizes) {
+        auto frame = makeFrame(IMGFMT_420P, s.w, s.h);
+        for (auto &g : graphs) {
+            const QString name = _L(s.name) % ' '_q % _L(g.name);
+            FFmpegFilterGraph graph;
+            if (!graph.initialize(_L(g.option), frame)) {
+                qDebug().nospace().noquote() << "  " << name << ": no graph";
+                continue;
+            }
+            int pts = 0, out = 0;
+            quint64 hash = 0xcbf29ce484222325ull;
+            auto step = [&] (bool check) {
+                frame->pts = pts++ / 30.0;
+                graph.push(frame);
+                for (;;) {
+                    const auto mpi = graph.pull();
+                    if (mpi.isNull())
+                        break;
+                    if (check)
+                        hash = checksum(mpi, hash);
+                    ++out;
+                }
+            };
+            for (int i = 0; i < 4; ++i)
+                step(true);
+            bm.check(name, hash);
+            const int allocs = FFmpegFilterGraph::allocations();
+            const int pushed = pts, pulled = out;
+            const auto nsec = Benchmark::measure([&] () { step(false); });
+            bm.report(name, nsec, 1, u"frame"_q);
+            qDebug().nospace().noquote() << "  " << name << ": "
+                << FFmpegFilterGraph::allocations() - allocs << " shell(s) allocated for "
+                << pts - pushed << " frame(s) in and " << out - pulled << " out";
+        }
+    }
+}
+
+auto benchmarkHwDecDownload() -> void
+{
+    Benchmark bm(u"video-hwdec"_q);
+    const struct { const char *name; int w, h; } sizes[] = {
+        { "720p", 1280, 720 }, { "1080p", 1920, 1080 }
+    };
+    for (auto &s : sizes) {
+        const QString size = _L(s.name);
+        MockHwDecSource mock;
+        auto surface = mock.surface(IMGFMT_NV12, s.w, s.h);
+        mp_image_copy(surface.data(), makeFrame(IMGFMT_NV12, s.w, s.h).data());
+        auto copy = MpImage::wrap(mp_image_alloc(IMGFMT_NV12, s.w, s.h));
+        HwDecDownloader::copy(copy.data(), surface.data());
+        bm.check(size % " copy"_a, checksum(copy));
+        if (checksum(copy) != checksum(surface))
+            qDebug().nospace().noquote() << "  " << size << ": copy differs";
+        auto nsec = Benchmark::measure([&] () { mp_image_copy(copy.data(), surface.data()); });
+        bm.report(size % " memcpy"_a, nsec, 1, u"frame"_q);
+        nsec = Benchmark::measure([&] () { HwDecDownloader::copy(copy.data(), surface.data()); });
+        bm.report(size % " stream"_a, nsec, 1, u"frame"_q);
+
+        // checksum of copy stands for processing of frame such as black scan
+        HwDecDownloader downloader(new MockHwDecSource);
+        quint64 hash = 0;
+        nsec = Benchmark::measure([&] () {
+            downloader.request(surface);
+            hash = checksum(downloader.take());
+        });
+        bm.report(size % " sync"_a, nsec, 1, u"frame"_q);
+        const auto sync = downloader.stats();
+        downloader.resetStats();
+        nsec = Benchmark::measure([&] () {
+            downloader.request(surface);
+            if (downloader.pending() > 1)
+                hash = checksum(downloader.take());
+        });
+        downloader.clear();
+        bm.report(size % " async"_a, nsec, 1, u"frame"_q);
+        const auto async = downloader.stats();
+        const struct { const char *name; HwDecDownloadStats stats; } modes[] = {
+            { "sync", sync }, { "async", async }
+        };
+        for (auto &m : modes)
+            qDebug().nospace().noquote() << "  " << size << ' ' << m.name << ": "
+                << m.stats.copy << "ms copy, " << m.stats.wait << "ms wait per frame";
+        if (hash != checksum(surface))
+            qDebug().nospace().noquote() << "  " << size << ": download differs";
+    }
+}
+
+struct StreamFormat {
+    QString name;
+    int w, h;
+    mp_imgfmt imgfmt;
+};
+
+// BOMI_BENCHMARK_VIDEO lists streams like "1920x1080:nv12,720x480:420p10"
+static auto streamFormats() -> QVector<StreamFormat>
+{
+    QVector<StreamFormat> formats;
+    const auto env = QString::fromLocal8Bit(qgetenv("BOMI_BENCHMARK_VIDEO"));
+    for (auto &token : env.split(','_q, QString::SkipEmptyParts)) {
+        const auto args = token.trimmed().split(':'_q);
+        const auto size = args[0].split('x'_q);
+        const auto name = args.value(1, u"420p"_q).toLatin1();
+        const auto imgfmt = mp_imgfmt_from_name(bstr0(name.constData()), false);
+        const int w = size.value(0).toInt(), h = size.value(1).toInt();
+        if (w <= 0 || h <= 0 || imgfmt == IMGFMT_NONE) {
+            qDebug().nospace().noquote() << "  invalid stream: " << token;
+            continue;
+        }
+        formats.push_back({ token.trimmed(), w, h, (mp_imgfmt)imgfmt });
+    }
+    if (formats.isEmpty())
+        formats = { { u"720x480:420p"_q, 720, 480, IMGFMT_420P },
+                    { u"1920x1080:nv12"_q, 1920, 1080, IMGFMT_NV12 } };
+    return formats;
+}
+
+static auto allocations() -> int
+{
+    return MpImage::allocations() + FFmpegFilterGraph::allocations();
+}
+
+// pushes frames of 25fps in turn and pops every output like vf_instance does
+class FilterFeeder {
+public:
+    FilterFeeder(VideoFilter *filter, const std::vector<MpImage> &frames)
+        : m_filter(filter), m_frames(frames) { m_clock.start(); }
+    auto step(quint64 *hash = nullptr) -> void
+    {
+        MpImage in = m_frames[m_pushed % m_frames.size()];
+        in->pts = m_pushed++ / 25.0;
+        m_pushes.push_back({ in->pts, m_clock.nsecsElapsed() });
+        m_filter->push(std::move(in));
+        for (;;) {
+            auto out = m_filter->pop();
+            if (out.isNull())
+                break;
+            ++m_popped;
+            // from push of input which output belongs to by pts
+            while (m_pushes.size() > 1 && m_pushes[1].pts <= out->pts + 1e-6)
+                m_pushes.pop_front();
+            m_latency.push_back(m_clock.nsecsElapsed() - m_pushes.front().nsec);
+            if (hash)
+                *hash = checksum(out, *hash);
+        }
+    }
+    auto reset() -> void { m_pushed = m_popped = 0; m_latency.clear(); }
+    auto pushed() const -> int { return m_pushed; }
+    auto popped() const -> int { return m_popped; }
+    // msec of latency at rate in [0, 1]
+    auto latency(double rate) -> double
+    {
+        if (m_latency.empty())
+            return 0.0;
+        const auto it = m_latency.begin() + rate * (m_latency.size() - 1);
+        std::nth_element(m_latency.begin(), it, m_latency.end());
+        return *it * 1e-6;
+    }
+private:
+    struct Push { double pts; qint64 nsec; };
+    VideoFilter *m_filter;
+    std::vector<MpImage> m_frames;
+    QElapsedTimer m_clock;
+    std::deque<Push> m_pushes;
+    std::vector<qint64> m_latency;
+    int m_pushed = 0, m_popped = 0;
+};
+
+static auto benchmarkFilter(Benchmark &bm, const QString &name, VideoFilter &filter,
+                            const std::vector<MpImage> &frames) -> void
+{
+    FilterFeeder feeder(&filter, frames);
+    quint64 hash = 0xcbf29ce484222325ull;
+    for (int i = 0; i < 8; ++i)
+        feeder.step(&hash);
+    bm.check(name, hash);
+    feeder.reset();
+    const int allocs = allocations();
+    const auto nsec = Benchmark::measure([&] () { feeder.step(); });
+    const int pushed = feeder.pushed(), popped = feeder.popped();
+    if (!popped) {
+        qDebug().nospace().noquote() << "  " << name << ": no output";
+        return;
+    }
+    bm.report(name, nsec, popped / double(pushed), u"frame"_q);
+    qDebug().nospace().noquote() << "  " << name << ": "
+        << QString::number(1e9 / nsec * popped / pushed, 'f', 1) << " fps, latency "
+        << QString::number(feeder.latency(0.5), 'f', 2) << "ms p50 "
+        << QString::number(feeder.latency(1.0), 'f', 2) << "ms max, "
+        << allocations() - allocs << " allocation(s) in " << pushed << " frame(s)";
+    filter.clear();
+}
+
+auto benchmarkVideoChain() -> void
+{
+    Benchmark bm(u"video-chain"_q);
+    const struct {
+        const char *name;
+        DeintMethod method;
+        bool doubler;
+        int threads, queue;
+    } deints[] = {
+        { "bob",                  DeintMethod::Bob,       true,  0, 0 },
+        { "linear-bob",           DeintMethod::LinearBob, true,  0, 0 },
+        { "cubic-bob",            DeintMethod::CubicBob,  true,  0, 0 },
+        { "yadif",                DeintMethod::Yadif,     false, 0, 0 },
+        { "yadif-double",         DeintMethod::Yadif,     true,  0, 0 },
+        { "yadif-double 1thread", DeintMethod::Yadif,     true,  1, 0 },
+        { "yadif-double queue2",  DeintMethod::Yadif,     true,  0, 2 },
+    };
+    for (auto &f : streamFormats()) {
+        const auto interlaced = makeFrame(f.imgfmt, f.w, f.h);
+        MpImage progressive = interlaced;
+        progressive.unset(MP_IMGFIELD_INTERLACED | MP_IMGFIELD_TOP_FIRST);
+
+        PassthroughVideoFilter passthrough;
+        benchmarkFilter(bm, f.name % " pass"_a, passthrough, { progressive });
+        for (auto &d : deints) {
+            DeintOption option(d.method, Processor::CPU, d.doubler);
+            option.threads = d.threads;
+            option.queue = d.queue;
+            SoftwareDeinterlacer deinterlacer;
+            deinterlacer.setOption(option);
+            benchmarkFilter(bm, f.name % ' '_q % _L(d.name), deinterlacer, { interlaced });
+        }
+        // picture panning back and forth so that block search finds motion
+        const std::vector<MpImage> panning = { progressive, makePanned(progressive, 6, 4) };
+        for (bool mc : { false, true }) {
+            MotionInterpolator interpolator;
+            interpolator.setTargetFps(60.0);
+            interpolator.setMotionCompensation(mc);
+            benchmarkFilter(bm, f.name % (mc ? " 25>60 mc"_a : " 25>60 repeat"_a),
+                            interpolator, panning);
+        }
+
+        double luma = 0;
+        const auto nsec = Benchmark::measure([&] () {
+            luma = VideoProcessor::luminance(progressive.data());
+        });
+        if (luma < 0) {
+            qDebug().nospace().noquote() << "  " << f.name << " luma: not supported";
+            continue;
+        }
+        bm.check(f.name % " luma"_a, Benchmark::checksum(&luma, sizeof(luma)));
+        bm.report(f.name % " luma"_a, nsec, 1, u"frame"_q);
+    }
+}
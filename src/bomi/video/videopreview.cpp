@@ -1,4 +1,5 @@
 #include "videopreview.hpp"
+#include "thumbnailcache.hpp"
 #include "opengl/opengltexture2d.hpp"
 #include "opengl/openglframebufferobject.hpp"
 #include "opengl/opengltexturebinder.hpp"
@@ -19,6 +20,8 @@ struct VideoPreview::Data {
     QSize displaySize{0, 0};
     double rate = 0.0, aspect = 0, percent = 0;
     Mpv mpv;
+    ThumbnailCache thumbnails;
+    QImage thumbnail; // drawn instead of mpv if not null
     auto vo() const -> QByteArray { return "opengl-cb"_b; }
     auto hasVideo() -> bool { return id > 0 && !displaySize.isEmpty(); }
     auto sizeAspect() const -> double
@@ -67,9 +70,14 @@ VideoPreview::VideoPreview(QQuickItem *parent)
     d->mpv.setUpdateCallback([=] () { _PostEvent(this, NewFrame); });
 
     d->mpv.start();
+
+    connect(&d->thumbnails, &ThumbnailCache::thumbnailsChanged, this, [=] () {
+        d->rate = -1;
+    }, Qt::QueuedConnection);
 }
 
 VideoPreview::~VideoPreview() {
+    d->thumbnails.unload();
     d->mpv.destroy();
     delete d;
 }
@@ -96,7 +104,12 @@ auto VideoPreview::setRate(double rate) -> void
     if (!d->active || !d->video || !d->loaded)
         return;
     if (_Change(d->rate, rate)) {
-        if (_Change(d->percent, qRound(d->rate * 10000)/100.0))
+        // cached keyframes first and live seeking for misses
+        d->thumbnail = d->keyframe ? d->thumbnails.thumbnail(d->rate) : QImage();
+        if (!d->thumbnail.isNull()) {
+            d->redraw = true;
+            reserve(UpdateMaterial);
+        } else if (_Change(d->percent, qRound(d->rate * 10000)/100.0))
             d->mpv.tellAsync("seek", d->percent, d->keyframe
                              ? "absolute-percent+keyframes"_b
                              : "absolute-percent+exact"_b);
@@ -113,8 +126,10 @@ auto VideoPreview::customEvent(QEvent *event) -> void
 {
     switch (static_cast<int>(event->type())) {
     case NewFrame: {
-        d->redraw = true;
-        reserve(UpdateMaterial);
+        if (d->thumbnail.isNull()) {
+            d->redraw = true;
+            reserve(UpdateMaterial);
+        }
         break;
     } default:
         d->mpv.process(event);
@@ -151,7 +166,15 @@ auto VideoPreview::paint(OpenGLFramebufferObject *fbo) -> void
     if (d->redraw) {
         d->redraw = false;
         auto w = window();
-        if (w) {
+        if (!d->thumbnail.isNull()) {
+            // texture is bottom-up and BGRA as RGB32 in little endian
+            const auto image = d->thumbnail.scaled(fbo->size(), Qt::IgnoreAspectRatio,
+                                                   Qt::SmoothTransformation).mirrored()
+                    .convertToFormat(QImage::Format_RGB32);
+            auto texture = fbo->texture();
+            OpenGLTextureBinder<OGL::Target2D> binder(&texture);
+            texture.upload(image.constBits());
+        } else if (w) {
             w->resetOpenGLState();
             d->mpv.render(fbo, nullptr, QMargins());
             w->resetOpenGLState();
@@ -164,13 +187,21 @@ auto VideoPreview::load(const QByteArray &path) -> void
 {
     if (path.contains("bomi-yle-"_b))
         return;
-    if (d->active)
+    if (d->active) {
         d->mpv.tellAsync("loadfile", path);
+        const QFileInfo info(MpvFile::fromMpv(path).data);
+        if (info.isFile()) {
+            if (d->thumbnails.file() != info.absoluteFilePath())
+                d->thumbnails.load(info.absoluteFilePath());
+        } else
+            d->thumbnails.unload();
+    }
 }
 
 auto VideoPreview::unload() -> void
 {
     d->mpv.tellAsync("stop");
+    d->thumbnail = QImage();
 }
 
 auto VideoPreview::shutdown() -> void
@@ -188,3 +219,8 @@ auto VideoPreview::setShowKeyframe(bool keyframe) -> void
 {
     d->keyframe = keyframe;
 }
+
+auto VideoPreview::setCacheLimit(qint64 bytes) -> void
+{
+    d->thumbnails.setLimit(bytes);
+}
@@ -25,6 +25,7 @@ public:
     auto imageSize() const -> QSize final { return size().toSize(); }
     auto setActive(bool active) -> void;
     auto setShowKeyframe(bool keyframe) -> void;
+    auto setCacheLimit(qint64 bytes) -> void;
     auto hasVideo() const -> bool;
 signals:
     void rateChanged(double rate);
@@ -5,6 +5,7 @@
 #include "motioninterpolator.hpp"
 #include "motionintrploption.hpp"
 #include "deintoption.hpp"
+#include "hwdecdownloader.hpp"
 #include "player/mpv_helper.hpp"
 #include "opengl/opengloffscreencontext.hpp"
 #include "os/os.hpp"
@@ -51,24 +52,6 @@ auto create_vf_info() -> vf_info
     return info;
 }
 
-class HwDecTool {
-public:
-    HwDecTool(mp_hwdec_ctx *hwctx)
-    {
-        m_ctx = hwctx;
-        m_pool = mp_image_pool_new(2);
-    }
-    virtual ~HwDecTool() { talloc_free(m_pool); }
-    virtual auto download(const MpImage &src) -> MpImage
-    {
-        auto img = OS::hwAcc()->download(m_ctx, src.data(), m_pool);
-        return img ? MpImage::wrap(img) : MpImage();
-    }
-protected:
-    mp_hwdec_ctx *m_ctx = nullptr;
-    mp_image_pool *m_pool = nullptr;
-};
-
 vf_info vf_info_noformat = create_vf_info();
 
 struct VideoProcessor::Data {
@@ -86,9 +69,10 @@ struct VideoProcessor::Data {
     mp_csp mp_csp_out = MP_CSP_AUTO;
     mp_csp_levels mp_lv_out = MP_CSP_LEVELS_AUTO;
     int hwdecType = -10;
+    double deintFps = 0.0;
     bool deint = false, inter_i = false, inter_o = false, interpolate = false;
     bool hwacc = false;
-    HwDecTool *hwdec = nullptr;
+    HwDecDownloader *hwdec = nullptr;
     mp_image_pool *pool = nullptr;
 
     QMutex mutex; // must be locked
@@ -100,6 +84,8 @@ struct VideoProcessor::Data {
         deinterlacer.clear();
         passthrough.clear();
         interpolator.clear();
+        if (hwdec)
+            hwdec->clear();
         filter = nullptr;
     }
     auto updateDeint() -> void
@@ -118,7 +104,7 @@ VideoProcessor::VideoProcessor()
     : d(new Data)
 {
     d->p = this;
-    d->pool = mp_image_pool_new(1);
+    d->pool = MpImage::newPool(1);
 }
 
 VideoProcessor::~VideoProcessor()
@@ -161,10 +147,12 @@ auto VideoProcessor::open(vf_instance *vf) -> int
     vf->control = [] (vf_instance *vf, int request, void *data) -> int
         { return priv(vf)->control(request, data); };
 
+    d->mutex.lock();
     _Delete(d->hwdec);
     hwdec_request_api(vf->hwdec, OS::hwAcc()->name().toLatin1());
     if (vf->hwdec && vf->hwdec->hwctx)
-        d->hwdec = new HwDecTool(vf->hwdec->hwctx);
+        d->hwdec = new HwDecDownloader(HwDecSource::create(vf->hwdec->hwctx));
+    d->mutex.unlock();
     mp_image_pool_clear(d->pool);
     p->vp->stopSkipping();
     return true;
@@ -240,6 +228,7 @@ auto VideoProcessor::reconfig(mp_image_params *in, mp_image_params *out) -> int
         emit outputColorRangeChanged(d->rangeOut);
 
     d->interpolator.setTargetFps(d->intrplOption.fps());
+    d->interpolator.setMotionCompensation(d->intrplOption.motion_compensation);
     d->reset();
     d->hwdecType = -10;
     return 0;
@@ -292,7 +281,7 @@ static auto lumaYCbCrPlanar(const mp_image *mpi) -> double
     });
 }
 
-static auto luminance(const mp_image *mpi) -> double
+auto VideoProcessor::luminance(const mp_image *mpi) -> double
 {
     switch (mpi->imgfmt) {
     case IMGFMT_420P:   case IMGFMT_NV12:   case IMGFMT_NV21:
@@ -337,6 +326,12 @@ auto VideoProcessor::hwdec() const -> QString
     }
 }
 
+auto VideoProcessor::downloadStats() const -> HwDecDownloadStats
+{
+    QMutexLocker locker(&d->mutex);
+    return d->hwdec ? d->hwdec->stats() : HwDecDownloadStats();
+}
+
 auto VideoProcessor::filterIn(mp_image *_mpi) -> int
 {
     if (!_mpi) { // propagate eof
@@ -360,27 +355,29 @@ auto VideoProcessor::filterIn(mp_image *_mpi) -> int
         auto start = d->ptsSkipStart;
         auto last = d->ptsLastSkip;
         d->mutex.unlock();
+        MpImage img = mpi;
+        if (scan && IMGFMT_IS_HWACCEL(mpi->imgfmt) && d->hwdec) {
+            // scan previous frame while this one is being downloaded
+            d->hwdec->request(mpi);
+            if (d->hwdec->pending() < 2)
+                scan = false;
+            else
+                img = d->hwdec->take();
+        }
         if (scan) {
+            const auto pts = img.isNull() ? mpi->pts : img->pts;
             auto skip = [&] () {
-                if (mpi->pts == MP_NOPTS_VALUE)
+                if (pts == MP_NOPTS_VALUE)
                     return false;
                 if (start == MP_NOPTS_VALUE)
-                    start = mpi->pts;
+                    start = pts;
                 else {
-                    if (mpi->pts < start)
+                    if (pts < start)
                         return false;
-                    if (mpi->pts - start > 5*60)// 5min
+                    if (pts - start > 5*60)// 5min
                         return false;
                 }
-                MpImage img;
-                if (IMGFMT_IS_HWACCEL(mpi->imgfmt)) {
-                    Q_ASSERT(d->hwdec);
-                    if (!d->hwdec)
-                        return false;
-                    img = d->hwdec->download(mpi);
-                } else
-                    img = mpi;
-                if (img.isNull())
+                if (img.isNull() || IMGFMT_IS_HWACCEL(img->imgfmt))
                     return false;
                 const auto y = luminance(img.data());
                 if (y < 0.005)
@@ -388,17 +385,18 @@ auto VideoProcessor::filterIn(mp_image *_mpi) -> int
                 return true;
             };
             scan = skip();
-            if (scan && qAbs(last - mpi->pts) > 0.0001) {
+            if (scan && qAbs(last - pts) > 0.0001) {
                 d->mutex.lock();
-                d->ptsLastSkip = mpi->pts;
+                d->ptsLastSkip = pts;
                 d->mutex.unlock();
             } else {
                 stopSkipping();
-                if (mpi->pts != MP_NOPTS_VALUE)
-                    emit seekRequested(mpi->pts * 1000);
+                if (pts != MP_NOPTS_VALUE)
+                    emit seekRequested(pts * 1000);
             }
         }
-    }
+    } else if (d->hwdec && d->hwdec->pending())
+        d->hwdec->clear();
 
     if (!d->filter) {
         if (mpi.isInterlaced() && !d->deinterlacer.pass())
@@ -429,6 +427,8 @@ auto VideoProcessor::filterOut() -> int
         return 0;
     if (_Change(d->inter_o, d->deinterlacer.pass() ? d->inter_i : false))
         emit outputInterlacedChanged();
+    if (_Change(d->deintFps, d->deinterlacer.fps()))
+        emit deintFpsChanged(d->deintFps);
     const auto img = mpi.take();
     if (d->mp_csp_out != MP_CSP_AUTO)
         img->params.colorspace = d->mp_csp_out;
@@ -459,7 +459,9 @@ auto VideoProcessor::control(int request, void* data) -> int
 auto VideoProcessor::uninit() -> void
 {
     d->reset();
+    d->mutex.lock();
     _Delete(d->hwdec);
+    d->mutex.unlock();
 }
 
 auto query_video_format(quint32 format) -> int
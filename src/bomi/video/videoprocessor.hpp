@@ -3,7 +3,7 @@
 
 struct vf_instance;                     struct mp_image_params;
 struct vf_info;                         struct mp_image;
-struct MotionIntrplOption;
+struct MotionIntrplOption;              struct HwDecDownloadStats;
 enum class DeintMethod;                 enum class ColorSpace;
 enum class ColorRange;
 
@@ -20,6 +20,8 @@ public:
     auto stopSkipping() -> void;
     auto isSkipping() const -> bool;
     auto hwdec() const -> QString;
+    // copies of hardware surfaces to system memory since hwdec was opened
+    auto downloadStats() const -> HwDecDownloadStats;
     auto setMotionIntrplOption(const MotionIntrplOption &option) -> void;
     auto inputColorSpace() const -> ColorSpace;
     auto inputColorRange() const -> ColorRange;
@@ -27,6 +29,8 @@ public:
     auto outputColorRange() const -> ColorRange;
     auto setOutputColorSpace(ColorSpace space) -> void;
     auto setOutputColorRange(ColorRange range) -> void;
+    // average luma in [0, 1] or negative for unsupported format
+    static auto luminance(const mp_image *mpi) -> double;
 signals:
     void hwdecChanged(const QString &api);
     void inputInterlacedChanged();
@@ -35,6 +39,7 @@ signals:
     void skippingChanged(bool skipping);
     void seekRequested(int msec);
     void fpsManimulated(double fps);
+    void deintFpsChanged(double fps);
     void inputColorSpaceChanged(ColorSpace space);
     void inputColorRangeChanged(ColorRange range);
     void outputColorSpaceChanged(ColorSpace space);
@@ -6,6 +6,7 @@
 #include "opengl/opengltexturebinder.hpp"
 #include "misc/dataevent.hpp"
 #include "misc/log.hpp"
+#include "frametimer.hpp"
 #include "enum/rotation.hpp"
 #include <QQmlProperty>
 #include <QQuickWindow>
@@ -151,6 +152,7 @@ struct VideoRenderer::Data {
     QSize sourceSize{0, 1};
     QTimer sizeChecker;
     RenderFrameFunc render = nullptr;
+    FrameTimer *timer = nullptr;
 
     static auto isSameRatio(double r1, double r2) -> bool
         {return (r1 < 0.0 && r2 < 0.0) || qFuzzyCompare(r1, r2);}
@@ -277,6 +279,11 @@ auto VideoRenderer::setRenderFrameFunction(const RenderFrameFunc &func) -> void
     d->render = func;
 }
 
+auto VideoRenderer::setFrameTimer(FrameTimer *timer) -> void
+{
+    d->timer = timer;
+}
+
 auto VideoRenderer::updateForNewFrame(const QSize &displaySize) -> void
 {
     _PostEvent(Qt::HighEventPriority, this, NewFrame, displaySize);
@@ -533,8 +540,12 @@ auto VideoRenderer::updateData(ShaderData *_data) -> void
         _Trace("VideoRendererItem::updateTexture(): no queued frame");
     } else if (!d->frame.size.isEmpty()) {
         d->redraw = false;
+        if (d->timer)
+            d->timer->start(FrameTimer::Upload);
         d->frame.renew();
         d->osd.renew();
+        if (d->timer)
+            d->timer->finish(FrameTimer::Upload);
         data->redraw = true;
         data->osdMargins = d->osd.margins;
         data->osdVisible = d->osd.visible;
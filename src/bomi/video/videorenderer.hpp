@@ -7,6 +7,7 @@
 #include <functional>
 
 class OpenGLFramebufferObject;          enum class Rotation;
+class FrameTimer;
 using Fbo = OpenGLFramebufferObject;
 using RenderFrameFunc = std::function<void(Fbo*,Fbo*,const QMargins&)>;
 
@@ -53,6 +54,8 @@ public:
     auto setCropRatio(double ratio) -> void;
     auto setRotation(Rotation r) -> void;
     auto setRenderFrameFunction(const RenderFrameFunc &func) -> void;
+    // upload of every frame is timed in render thread if set
+    auto setFrameTimer(FrameTimer *timer) -> void;
     auto updateForNewFrame(const QSize &displaySize) -> void;
     auto setFramebufferObjectFormat(OGL::TextureFormat format) -> void;
     auto framebufferObjectFormat() const -> OGL::TextureFormat;
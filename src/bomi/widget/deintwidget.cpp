@@ -10,6 +10,7 @@ struct Line {
     QMap<DeintMethod, DeintCaps> caps;
     DeintMethodComboBox *combo = nullptr;
     QCheckBox *doubler = nullptr;
+    QSpinBox *threads = nullptr, *queue = nullptr; // for CPU only
 };
 
 struct DeintWidget::Data {
@@ -53,8 +54,31 @@ struct DeintWidget::Data {
         grid->addWidget(l.combo, row, 1);
         grid->addWidget(l.doubler, row, 2);
 
+        if (proc == Processor::CPU) {
+            l.threads = new QSpinBox(p);
+            l.threads->setRange(0, 32);
+            l.threads->setPrefix(tr("Threads: "));
+            l.threads->setSpecialValueText(tr("Threads: Auto"));
+            l.threads->setToolTip(tr("Number of threads which share each frame in Yadif."));
+            l.queue = new QSpinBox(p);
+            l.queue->setRange(0, 8);
+            l.queue->setPrefix(tr("Queue: "));
+            l.queue->setSpecialValueText(tr("Queue: None"));
+            l.queue->setToolTip(tr("Number of frames which Yadif filters in a separate thread\n"
+                                   "while next frames are decoded. This delays video by as many frames."));
+            grid->addWidget(l.threads, row, 3);
+            grid->addWidget(l.queue, row, 4);
+            connect(SIGNAL_VT(l.threads, valueChanged, int), p, &DeintWidget::optionsChanged);
+            connect(SIGNAL_VT(l.queue, valueChanged, int), p, &DeintWidget::optionsChanged);
+        }
+
         connect(SIGNAL_V(l.combo, currentDataChanged), p, [=, &l] (const QVariant &data) {
-            l.doubler->setEnabled(l.caps[data.value<DeintMethod>()].doubler());
+            const auto method = data.value<DeintMethod>();
+            l.doubler->setEnabled(l.caps[method].doubler());
+            if (l.threads) {
+                l.threads->setEnabled(method == DeintMethod::Yadif);
+                l.queue->setEnabled(method == DeintMethod::Yadif);
+            }
             emit p->optionsChanged();
         });
         connect(l.doubler, &QCheckBox::toggled, p, &DeintWidget::optionsChanged);
@@ -64,6 +88,10 @@ struct DeintWidget::Data {
         auto &l = line(proc);
         l.combo->setCurrentEnum(option.method);
         l.doubler->setChecked(option.doubler);
+        if (l.threads) {
+            l.threads->setValue(option.threads);
+            l.queue->setValue(option.queue);
+        }
     }
     auto option(Processor proc) -> DeintOption
     {
@@ -73,6 +101,10 @@ struct DeintWidget::Data {
         opt.processor = proc;
         opt.method = l.combo->currentEnum();
         opt.doubler = l.doubler->isEnabled() && l.doubler->isChecked();
+        if (l.threads) {
+            opt.threads = l.threads->value();
+            opt.queue = l.queue->value();
+        }
         return opt;
     }
 };